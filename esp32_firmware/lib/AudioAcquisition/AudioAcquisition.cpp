@@ -0,0 +1,187 @@
+#include "AudioAcquisition.h"
+#include <string.h>
+
+AcquisitionEngine::AcquisitionEngine()
+    : source(nullptr), sample_rate(0), fill_index(0),
+      samples_acquired(0), ticks_missed(0) {
+    memset(staging, 0, sizeof(staging));
+}
+
+bool AcquisitionEngine::begin(SampleSource* src, uint32_t rate) {
+    if (src == nullptr || rate == 0) {
+        return false;
+    }
+
+    end();
+
+    source = src;
+    sample_rate = rate;
+    fill_index = 0;
+    ring.clear();
+    reset_stats();
+
+    if (!source->start(this, sample_rate)) {
+        source = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AcquisitionEngine::end() {
+    if (source != nullptr) {
+        source->stop();
+        source = nullptr;
+    }
+}
+
+void AcquisitionEngine::on_sample(uint16_t raw_adc) {
+    staging[fill_index++] = raw_to_sample(raw_adc);
+    samples_acquired.fetch_add(1, std::memory_order_relaxed);
+
+    if (fill_index < ACQ_BLOCK_SIZE) {
+        return;
+    }
+    fill_index = 0;
+
+    // A full ring rejects the whole block and records it as an overrun
+    ring.push(staging, ACQ_BLOCK_SIZE);
+}
+
+void AcquisitionEngine::on_missed_ticks(uint32_t count) {
+    ticks_missed.fetch_add(count, std::memory_order_relaxed);
+}
+
+AcquisitionStats AcquisitionEngine::get_stats() const {
+    AcquisitionStats stats;
+    stats.samples_acquired = samples_acquired.load(std::memory_order_relaxed);
+    stats.blocks_completed = stats.samples_acquired / ACQ_BLOCK_SIZE;
+    stats.blocks_dropped = ring.get_overrun_count();
+    stats.ticks_missed = ticks_missed.load(std::memory_order_relaxed);
+    stats.ring_high_water = ring.get_high_water_mark();
+    stats.ring_capacity = ring.capacity();
+    return stats;
+}
+
+void AcquisitionEngine::reset_stats() {
+    samples_acquired.store(0);
+    ticks_missed.store(0);
+    ring.reset_stats();
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic clock source (host builds and tests)
+// ---------------------------------------------------------------------------
+
+SyntheticSampleSource::SyntheticSampleSource(Generator gen, void* ctx)
+    : generator(gen), context(ctx), engine(nullptr),
+      sample_rate(0), clock_us(0), sample_index(0) {
+}
+
+bool SyntheticSampleSource::start(AcquisitionEngine* eng, uint32_t rate) {
+    if (generator == nullptr) {
+        return false;
+    }
+    engine = eng;
+    sample_rate = rate;
+    clock_us = 0;
+    sample_index = 0;
+    return true;
+}
+
+void SyntheticSampleSource::stop() {
+    engine = nullptr;
+}
+
+void SyntheticSampleSource::advance(uint32_t elapsed_us) {
+    if (engine == nullptr) {
+        return;
+    }
+
+    clock_us += elapsed_us;
+    uint64_t due = (clock_us * sample_rate) / 1000000ULL;
+    while (sample_index < due) {
+        engine->on_sample(generator(sample_index, context));
+        sample_index++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ESP32 hardware timer source
+// ---------------------------------------------------------------------------
+
+#if defined(ARDUINO) && defined(ESP32)
+
+TimerAdcSource* TimerAdcSource::active = nullptr;
+
+TimerAdcSource::TimerAdcSource(adc1_channel_t ch, uint8_t timer_idx, BaseType_t run_core)
+    : channel(ch), timer_index(timer_idx), core(run_core),
+      timer(nullptr), task(nullptr), engine(nullptr) {
+}
+
+bool TimerAdcSource::start(AcquisitionEngine* eng, uint32_t sample_rate) {
+    if (active != nullptr || sample_rate == 0) {
+        return false;
+    }
+
+    engine = eng;
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+
+    // Highest application priority so loop() work cannot delay a conversion
+    if (xTaskCreatePinnedToCore(acquisition_task, "acq", 2048, this,
+                                configMAX_PRIORITIES - 1, &task, core) != pdPASS) {
+        engine = nullptr;
+        return false;
+    }
+    active = this;
+
+    // 80 MHz APB / 80 = 1 MHz timer tick
+    timer = timerBegin(timer_index, 80, true);
+    timerAttachInterrupt(timer, &TimerAdcSource::on_timer, true);
+    timerAlarmWrite(timer, 1000000UL / sample_rate, true);
+    timerAlarmEnable(timer);
+    return true;
+}
+
+void TimerAdcSource::stop() {
+    if (timer != nullptr) {
+        timerAlarmDisable(timer);
+        timerDetachInterrupt(timer);
+        timerEnd(timer);
+        timer = nullptr;
+    }
+    if (task != nullptr) {
+        vTaskDelete(task);
+        task = nullptr;
+    }
+    active = nullptr;
+    engine = nullptr;
+}
+
+void IRAM_ATTR TimerAdcSource::on_timer() {
+    BaseType_t woken = pdFALSE;
+    if (active != nullptr && active->task != nullptr) {
+        vTaskNotifyGiveFromISR(active->task, &woken);
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void TimerAdcSource::acquisition_task(void* arg) {
+    TimerAdcSource* self = static_cast<TimerAdcSource*>(arg);
+    for (;;) {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (pending == 0) {
+            continue;
+        }
+        // More than one pending tick means the conversion for the earlier
+        // periods never happened - record it instead of faking samples
+        if (pending > 1) {
+            self->engine->on_missed_ticks(pending - 1);
+        }
+        self->engine->on_sample((uint16_t)adc1_get_raw(self->channel));
+    }
+}
+
+#endif
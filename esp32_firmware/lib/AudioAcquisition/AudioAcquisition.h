@@ -0,0 +1,142 @@
+#ifndef AUDIO_ACQUISITION_H
+#define AUDIO_ACQUISITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "SpscRingBuffer.h"
+
+// Samples per acquisition block handed to the processing side
+#ifndef ACQ_BLOCK_SIZE
+#define ACQ_BLOCK_SIZE 64
+#endif
+
+// Blocks the sample ring can hold before the engine starts dropping
+// (ACQ_BLOCK_SIZE * ACQ_BLOCK_COUNT must be a power of two)
+#ifndef ACQ_BLOCK_COUNT
+#define ACQ_BLOCK_COUNT 8
+#endif
+
+typedef SpscRingBuffer<int16_t, ACQ_BLOCK_SIZE * ACQ_BLOCK_COUNT> SampleRing;
+
+class AcquisitionEngine;
+
+// Paces the engine. A source calls AcquisitionEngine::on_sample() exactly
+// once per sample period with a raw 12-bit ADC code. On the ESP32 that is a
+// hardware timer; on a host build it is a synthetic clock.
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+    virtual bool start(AcquisitionEngine* engine, uint32_t sample_rate) = 0;
+    virtual void stop() = 0;
+};
+
+struct AcquisitionStats {
+    uint32_t samples_acquired;
+    uint32_t blocks_completed;
+    uint32_t blocks_dropped;     // Block completed while the ring was full
+    uint32_t ticks_missed;       // Sample periods the source could not serve
+    uint32_t ring_high_water;    // Peak ring fill level in samples
+    uint32_t ring_capacity;
+};
+
+class AcquisitionEngine {
+public:
+    AcquisitionEngine();
+
+    bool begin(SampleSource* source, uint32_t sample_rate);
+    void end();
+
+    // Producer side - called by the sample source, never blocks
+    void on_sample(uint16_t raw_adc);
+    void on_missed_ticks(uint32_t count);
+
+    // Consumer side - completed blocks land here; drain with peek()/consume()
+    SampleRing& samples() { return ring; }
+
+    AcquisitionStats get_stats() const;
+    void reset_stats();
+
+    uint32_t get_sample_rate() const { return sample_rate; }
+
+    // Raw 12-bit ADC code to the signed Q15 sample used by AudioProcessor
+    // (value / 32768). Integer offset and gain equal to
+    // ((raw * 3.3 / 4095) - 1.65) * 10000, so it is safe to run from
+    // interrupt context and identical on every target.
+    static inline int16_t raw_to_sample(uint16_t raw_adc) {
+        return (int16_t)(((int32_t)raw_adc * 33000) / 4095 - 16500);
+    }
+
+private:
+    SampleSource* source;
+    uint32_t sample_rate;
+
+    SampleRing ring;
+    int16_t staging[ACQ_BLOCK_SIZE];       // Producer-owned block being filled
+    size_t fill_index;
+
+    std::atomic<uint32_t> samples_acquired;
+    std::atomic<uint32_t> ticks_missed;
+};
+
+// Host-side source driven from a synthetic microsecond clock. Each call to
+// advance() emits every sample period that elapsed, so tests can reproduce
+// exact timing (including stalls) without hardware.
+class SyntheticSampleSource : public SampleSource {
+public:
+    typedef uint16_t (*Generator)(uint32_t sample_index, void* context);
+
+    SyntheticSampleSource(Generator generator, void* context = nullptr);
+
+    bool start(AcquisitionEngine* engine, uint32_t sample_rate) override;
+    void stop() override;
+
+    // Move the synthetic clock forward and emit the samples that fell due
+    void advance(uint32_t elapsed_us);
+
+    uint32_t get_sample_index() const { return sample_index; }
+
+private:
+    Generator generator;
+    void* context;
+    AcquisitionEngine* engine;
+    uint32_t sample_rate;
+    uint64_t clock_us;
+    uint32_t sample_index;
+};
+
+#if defined(ARDUINO) && defined(ESP32)
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp32-hal-timer.h>
+#include <driver/adc.h>
+
+// ESP32 source: a hardware timer fires at the sample rate and wakes a
+// high-priority task which performs the ADC1 conversion. ADC1 reads take a
+// driver lock and cannot run inside the ISR itself, but the timer keeps the
+// period exact and missed wake-ups are counted rather than silently slipping.
+class TimerAdcSource : public SampleSource {
+public:
+    TimerAdcSource(adc1_channel_t channel, uint8_t timer_index = 0, BaseType_t core = 0);
+
+    bool start(AcquisitionEngine* engine, uint32_t sample_rate) override;
+    void stop() override;
+
+private:
+    static void IRAM_ATTR on_timer();
+    static void acquisition_task(void* arg);
+
+    static TimerAdcSource* active;
+
+    adc1_channel_t channel;
+    uint8_t timer_index;
+    BaseType_t core;
+    hw_timer_t* timer;
+    TaskHandle_t task;
+    AcquisitionEngine* engine;
+};
+
+#endif
+
+#endif
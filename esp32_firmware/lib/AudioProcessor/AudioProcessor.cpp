@@ -0,0 +1,672 @@
+#include "AudioProcessor.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+// Samples are scaled to roughly [-1, 1) before analysis
+static const float SAMPLE_SCALE = 1.0f / 32768.0f;
+
+#if AUDIO_FIXED_POINT
+// Integer sliding DFT sums are raw samples times Q15 twiddles; this takes
+// the frequency-domain Hann's 4x gain and the squared sample scale and
+// 1/sqrt(N) of the float path out of the energy. A power of two, so exact.
+static const float SDFT_ENERGY_SCALE = SAMPLE_SCALE * SAMPLE_SCALE / (16.0f * FFT_SIZE);
+#else
+// Pole radius just inside the unit circle keeps the sliding DFT from
+// accumulating float rounding error indefinitely
+static const float SDFT_DAMPING = 0.99995f;
+#endif
+
+static_assert(SPECTROGRAM_BINS <= FFT_SIZE / 2, "Spectrogram bins must lie below Nyquist");
+
+// Mantissa edges between quarter octaves, 2^(1/8), 2^(3/8), 2^(5/8) and
+// 2^(7/8): the number of edges a mantissa in [1, 2) reaches is
+// 4 * log2(mantissa) rounded to nearest
+static const float QUARTER_OCTAVE_EDGES[4] = {1.0905077f, 1.2968396f, 1.5422108f, 1.8340081f};
+static const uint32_t QUARTER_OCTAVE_EDGES_Q31[4] = {2341847524UL, 2784941738UL, 3311872529UL, 3938502376UL};
+
+static int8_t spectrogram_code(int quarter_octaves) {
+    int code = quarter_octaves + SPECTROGRAM_CODE_OFFSET;
+    return (int8_t)(code < -128 ? -128 : code > 127 ? 127 : code);
+}
+
+AudioProcessor::AudioProcessor()
+    : write_pos(0), history_count(0), samples_since_frame(0),
+      hop_size(AUDIO_HOP_SIZE), has_prev_spectrum(false), feature_mask(FEATURE_MASK_ALL),
+      spectrogram_head(0), spectrogram_count(0), spectrogram_enabled(false),
+      infrasound_start_bin(0), infrasound_end_bin(0),
+      low_band_end_bin(0), mid_band_end_bin(0),
+#if AUDIO_FIXED_POINT
+      sdft_phase(0) {
+#else
+      sdft_damping_n(1.0f) {
+#endif
+}
+
+void AudioProcessor::initialize() {
+    DspKernels::initialize(FFT_SIZE / 2);
+
+#if !AUDIO_FIXED_POINT
+    // Hann window to reduce spectral leakage. Periodic (period N), which is
+    // the window the sliding DFT's three-tap Hann applies exactly.
+    // Pre-scaled by the sample scale and by 1/sqrt(N) so |X[k]|^2 comes out
+    // as power per bin independent of frame size, and windowing is one
+    // multiply per sample.
+    const float norm = SAMPLE_SCALE / sqrtf((float)FFT_SIZE);
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        window[i] = norm * 0.5f * (1.0f - cosf(2.0f * PI * i / AUDIO_BUFFER_SIZE));
+    }
+#endif
+
+    infrasound_start_bin = hz_to_bin(INFRASOUND_LOW_HZ);
+    infrasound_end_bin = hz_to_bin(INFRASOUND_HIGH_HZ);
+    low_band_end_bin = hz_to_bin(LOW_BAND_HIGH_HZ);
+    mid_band_end_bin = hz_to_bin(MID_BAND_HIGH_HZ);
+    if (mid_band_end_bin > FFT_SIZE / 2) {
+        mid_band_end_bin = FFT_SIZE / 2;
+    }
+    for (int k = 0; k < FFT_SIZE / 2; k++) {
+        if (k >= infrasound_start_bin && k < infrasound_end_bin) {
+            bin_band[k] = BAND_INFRASOUND;
+        } else if (k >= infrasound_end_bin && k < low_band_end_bin) {
+            bin_band[k] = BAND_LOW;
+        } else if (k >= low_band_end_bin && k < mid_band_end_bin) {
+            bin_band[k] = BAND_MID;
+        } else {
+            bin_band[k] = BAND_NONE;
+        }
+    }
+
+#if AUDIO_FIXED_POINT
+    // Same constexpr sine/cosine as the FFT tables, so every target builds
+    // identical twiddles
+    for (int m = 0; m < FFT_SIZE; m++) {
+        double angle = 2.0 * realfft_detail::PI_D * m / FFT_SIZE;
+        sdft_cos[m] = realfft_detail::to_q15(realfft_detail::cos_cx(angle));
+        sdft_sin[m] = realfft_detail::to_q15(-realfft_detail::sin_cx(angle));
+    }
+#else
+    for (int k = 0; k < SDFT_BINS; k++) {
+        sdft_cos[k] = cosf(2.0f * PI * k / FFT_SIZE) * SDFT_DAMPING;
+        sdft_sin[k] = sinf(2.0f * PI * k / FFT_SIZE) * SDFT_DAMPING;
+    }
+    sdft_damping_n = powf(SDFT_DAMPING, FFT_SIZE);
+#endif
+
+#if AUDIO_FIXED_POINT
+    memset(prev_magnitude_q, 0, sizeof(prev_magnitude_q));
+#else
+    memset(prev_magnitude, 0, sizeof(prev_magnitude));
+#endif
+    has_prev_spectrum = false;
+
+    reset_buffer();
+}
+
+void AudioProcessor::add_sample(int16_t sample) {
+    add_samples(&sample, 1);
+}
+
+size_t AudioProcessor::add_samples(const int16_t* samples, size_t count) {
+    size_t space = samples_until_frame();
+    if (count > space) {
+        count = space;
+    }
+
+    // Must run before the history is overwritten: it needs the samples
+    // that are about to leave the window
+    update_sliding_dft(samples, count);
+
+    // Write in at most two runs around the end of the circular history
+    size_t first = AUDIO_BUFFER_SIZE - write_pos;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(&audio_buffer[write_pos], samples, first * sizeof(int16_t));
+    memcpy(&audio_buffer[0], samples + first, (count - first) * sizeof(int16_t));
+    write_pos = (write_pos + count) % AUDIO_BUFFER_SIZE;
+
+    history_count += count;
+    if (history_count > AUDIO_BUFFER_SIZE) {
+        history_count = AUDIO_BUFFER_SIZE;
+    }
+    samples_since_frame += count;
+    return count;
+}
+
+size_t AudioProcessor::samples_until_frame() const {
+    if (is_frame_ready()) {
+        return 0;
+    }
+    size_t to_fill = AUDIO_BUFFER_SIZE - history_count;
+    size_t to_hop = hop_size > samples_since_frame ? hop_size - samples_since_frame : 0;
+    return to_fill > to_hop ? to_fill : to_hop;
+}
+
+bool AudioProcessor::set_hop_size(size_t hop) {
+    if (hop == 0 || hop > AUDIO_BUFFER_SIZE) {
+        return false;
+    }
+    hop_size = hop;
+    return true;
+}
+
+bool AudioProcessor::extract_features(AudioFeatures& features) {
+    if (!is_frame_ready()) {
+        return false;
+    }
+
+#if AUDIO_FIXED_POINT
+    extract_features_q15(features);
+#else
+    extract_features_float(features);
+#endif
+    samples_since_frame = 0;
+    return true;
+}
+
+void AudioProcessor::set_feature_mask(FeatureMask mask) {
+    feature_mask = mask;
+    // Magnitudes kept while flux was off are stale
+    has_prev_spectrum = false;
+}
+
+void AudioProcessor::set_spectrogram_enabled(bool enabled) {
+    spectrogram_enabled = enabled;
+    spectrogram_count = 0;
+}
+
+bool AudioProcessor::copy_spectrogram(int8_t* out, size_t frames) const {
+    if (frames > spectrogram_count) {
+        return false;
+    }
+    size_t frame = (spectrogram_head + SPECTROGRAM_FRAMES - frames) % SPECTROGRAM_FRAMES;
+    for (size_t i = 0; i < frames; i++) {
+        memcpy(out + i * SPECTROGRAM_BINS, spectrogram[frame], SPECTROGRAM_BINS);
+        frame = (frame + 1) % SPECTROGRAM_FRAMES;
+    }
+    return true;
+}
+
+int8_t* AudioProcessor::next_spectrogram_frame() {
+    if (!spectrogram_enabled) {
+        return NULL;
+    }
+    int8_t* frame = spectrogram[spectrogram_head];
+    spectrogram_head = (spectrogram_head + 1) % SPECTROGRAM_FRAMES;
+    if (spectrogram_count < SPECTROGRAM_FRAMES) {
+        spectrogram_count++;
+    }
+    return frame;
+}
+
+uint32_t AudioProcessor::get_skipped_steps_per_frame() const {
+    const uint32_t samples = AUDIO_BUFFER_SIZE;
+    const uint32_t bins = FFT_SIZE / 2;
+    uint32_t skipped = 0;
+
+    if (!(feature_mask & FEATURE_RMS)) {
+        skipped += samples;
+    }
+    if (!(feature_mask & FEATURE_TEMPORAL_ENVELOPE)) {
+        skipped += samples;
+    }
+    if (!(feature_mask & FEATURE_MASK_SPECTRAL) && !spectrogram_enabled) {
+        // Window, complex butterflies, split and the power of every bin
+        skipped += samples + (bins / 2) * realfft_detail::log2_size(bins) + bins / 2 + bins;
+    }
+    if (!(feature_mask & FEATURE_MASK_BANDS)) {
+        skipped += bins;
+    }
+    if (!(feature_mask & FEATURE_SPECTRAL_CENTROID)) {
+        skipped += bins;
+    }
+    if (!(feature_mask & FEATURE_DOMINANT_FREQUENCY)) {
+        skipped += bins;
+    }
+    if (!(feature_mask & FEATURE_SPECTRAL_FLUX)) {
+        skipped += bins;
+    }
+    return skipped;
+}
+
+void AudioProcessor::reset_buffer() {
+    write_pos = 0;
+    history_count = 0;
+    samples_since_frame = 0;
+    // Nothing before the gap is adjacent to the next frame
+    has_prev_spectrum = false;
+    spectrogram_count = 0;
+    memset(sdft_real, 0, sizeof(sdft_real));
+    memset(sdft_imag, 0, sizeof(sdft_imag));
+#if AUDIO_FIXED_POINT
+    sdft_phase = 0;
+#endif
+}
+
+void AudioProcessor::skip_frame() {
+    if (is_frame_ready()) {
+        samples_since_frame = 0;
+        // The next computed frame has no adjacent spectrum to diff against
+        // or to follow in the spectrogram
+        has_prev_spectrum = false;
+        spectrogram_count = 0;
+    }
+}
+
+#if AUDIO_FIXED_POINT
+
+// x * W rounded from Q15; the same sample and twiddle always give the same
+// term, which is what lets the leaving sample cancel exactly
+static inline int32_t sdft_term(int32_t sample, int32_t twiddle) {
+    return (sample * twiddle + (1 << 14)) >> 15;
+}
+
+// a * W rounded from Q15, in 64 bits for the accumulated sums
+static inline int64_t sdft_rotate(int64_t a, int32_t twiddle) {
+    return (a * twiddle + (1 << 14)) >> 15;
+}
+
+void AudioProcessor::update_sliding_dft(const int16_t* samples, size_t count) {
+    // S_k += (x[n] - x[n-N]) W^(k n), one rounded term per sample
+    size_t pos = write_pos;
+    size_t filled = history_count;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t entering = samples[i];
+        int32_t leaving = filled >= AUDIO_BUFFER_SIZE ? audio_buffer[pos] : 0;
+
+        size_t m = 0;
+        for (int k = 0; k < SDFT_BINS; k++) {
+            int32_t c = sdft_cos[m];
+            int32_t s = sdft_sin[m];
+            sdft_real[k] += sdft_term(entering, c) - sdft_term(leaving, c);
+            sdft_imag[k] += sdft_term(entering, s) - sdft_term(leaving, s);
+            m = (m + sdft_phase) & (FFT_SIZE - 1);
+        }
+
+        sdft_phase = (sdft_phase + 1) & (FFT_SIZE - 1);
+        pos = (pos + 1) % AUDIO_BUFFER_SIZE;
+        if (filled < AUDIO_BUFFER_SIZE) {
+            filled++;
+        }
+    }
+}
+
+float AudioProcessor::sliding_band_energy(int start_bin, int end_bin) const {
+    // Relative to the window start s, X[k] = S_k W^(-k s), so with
+    // R = W^s the frequency-domain Hann becomes, up to a unit phase,
+    //   4 Y[k] = 2 S_k - (S_{k-1} R + S_{k+1} conj(R)),  S_{-1} = conj(S_1)
+    const int32_t rc = sdft_cos[sdft_phase];
+    const int32_t rs = sdft_sin[sdft_phase];
+    uint64_t energy = 0;
+    for (int k = start_bin; k < end_bin && k + 1 < SDFT_BINS; k++) {
+        int64_t prev_re = k > 0 ? sdft_real[k - 1] : sdft_real[1];
+        int64_t prev_im = k > 0 ? sdft_imag[k - 1] : -sdft_imag[1];
+        int64_t next_re = sdft_real[k + 1];
+        int64_t next_im = sdft_imag[k + 1];
+        int64_t re = 2 * (int64_t)sdft_real[k]
+                   - (sdft_rotate(prev_re, rc) - sdft_rotate(prev_im, rs))
+                   - (sdft_rotate(next_re, rc) + sdft_rotate(next_im, rs));
+        int64_t im = 2 * (int64_t)sdft_imag[k]
+                   - (sdft_rotate(prev_re, rs) + sdft_rotate(prev_im, rc))
+                   - (sdft_rotate(next_im, rc) - sdft_rotate(next_re, rs));
+        energy += (uint64_t)(re * re) + (uint64_t)(im * im);
+    }
+    return (float)energy * SDFT_ENERGY_SCALE;
+}
+
+#else
+
+void AudioProcessor::update_sliding_dft(const int16_t* samples, size_t count) {
+    // S_k <- (S_k + x[n] - r^N x[n-N]) * r e^{+i 2 pi k / N}
+    // Samples are scaled like the FFT input (sample scale and 1/sqrt(N)) so
+    // the trace is directly comparable with the frame band energies.
+    const float scale = SAMPLE_SCALE / sqrtf((float)FFT_SIZE);
+    size_t pos = write_pos;
+    size_t filled = history_count;
+
+    for (size_t i = 0; i < count; i++) {
+        float leaving = filled >= AUDIO_BUFFER_SIZE ? audio_buffer[pos] * scale * sdft_damping_n : 0.0f;
+        float delta = samples[i] * scale - leaving;
+
+        for (int k = 0; k < SDFT_BINS; k++) {
+            float re = sdft_real[k] + delta;
+            float im = sdft_imag[k];
+            sdft_real[k] = re * sdft_cos[k] - im * sdft_sin[k];
+            sdft_imag[k] = re * sdft_sin[k] + im * sdft_cos[k];
+        }
+
+        pos = (pos + 1) % AUDIO_BUFFER_SIZE;
+        if (filled < AUDIO_BUFFER_SIZE) {
+            filled++;
+        }
+    }
+}
+
+float AudioProcessor::sliding_band_energy(int start_bin, int end_bin) const {
+    // Hann window applied in the frequency domain:
+    //   Y[k] = 0.5 X[k] - 0.25 (X[k-1] + X[k+1]),  X[-1] = conj(X[1])
+    float energy = 0.0f;
+    for (int k = start_bin; k < end_bin && k + 1 < SDFT_BINS; k++) {
+        float prev_re = k > 0 ? sdft_real[k - 1] : sdft_real[1];
+        float prev_im = k > 0 ? sdft_imag[k - 1] : -sdft_imag[1];
+        float re = 0.5f * sdft_real[k] - 0.25f * (prev_re + sdft_real[k + 1]);
+        float im = 0.5f * sdft_imag[k] - 0.25f * (prev_im + sdft_imag[k + 1]);
+        energy += re * re + im * im;
+    }
+    return energy;
+}
+
+#endif
+
+float AudioProcessor::get_infrasound_trace() const {
+    return sliding_band_energy(infrasound_start_bin, infrasound_end_bin);
+}
+
+float AudioProcessor::get_low_band_trace() const {
+    return sliding_band_energy(infrasound_end_bin, low_band_end_bin);
+}
+
+#if AUDIO_FIXED_POINT
+
+// Bitwise integer square root: identical result on every target
+static uint32_t isqrt32(uint32_t value) {
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+// round(4 * log2) of a Q30 power at the block exponent, in true units:
+// X_true = X_stored * 2^exponent / 32768, and 1/N like the float window
+static int8_t spectrogram_code_q15(uint32_t power, int exponent) {
+    if (power == 0) {
+        return -128;
+    }
+    int msb = 31 - __builtin_clz(power);
+    uint32_t mantissa = power << (31 - msb);
+    int quarters = 0;
+    while (quarters < 4 && mantissa >= QUARTER_OCTAVE_EDGES_Q31[quarters]) {
+        quarters++;
+    }
+    int octaves = msb + 2 * exponent - 30 - (int)realfft_detail::log2_size(FFT_SIZE);
+    return spectrogram_code(SPECTROGRAM_STEPS_PER_OCTAVE * octaves + quarters);
+}
+
+void AudioProcessor::extract_features_q15(AudioFeatures& features) {
+    const bool want_rms = feature_mask & FEATURE_RMS;
+    const bool want_envelope = feature_mask & FEATURE_TEMPORAL_ENVELOPE;
+    const bool want_spectrum = (feature_mask & FEATURE_MASK_SPECTRAL) || spectrogram_enabled;
+
+    // Time domain: integer sum of squares and peak, windowing the history
+    // oldest-first into the Q15 FFT buffer in the same pass
+    uint64_t sum_squares = 0;
+    int32_t peak = 0;
+    int n = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        int begin = pass == 0 ? (int)write_pos : 0;
+        int end = pass == 0 ? AUDIO_BUFFER_SIZE : (int)write_pos;
+        for (int i = begin; i < end; i++, n++) {
+            int32_t x = audio_buffer[i];
+            if (want_rms) {
+                sum_squares += (uint64_t)(x * x);
+            }
+            if (want_envelope) {
+                int32_t magnitude = x < 0 ? -x : x;
+                if (magnitude > peak) {
+                    peak = magnitude;
+                }
+            }
+            if (want_spectrum) {
+                q15_buffer[n] = FFTQ15::windowed(audio_buffer[i], n);
+            }
+        }
+    }
+
+    features.rms = sqrtf((float)sum_squares / AUDIO_BUFFER_SIZE) * SAMPLE_SCALE;
+    features.temporal_envelope = peak * SAMPLE_SCALE;
+    if (!want_spectrum) {
+        clear_spectral_features(features);
+        return;
+    }
+
+    const int exponent = FFTQ15::transform(q15_buffer);
+
+    // Spectral: one pass over the bins. Powers are Q30 at the block
+    // exponent, summed in 64 bits.
+    const bool want_bands = feature_mask & FEATURE_MASK_BANDS;
+    const bool want_centroid = feature_mask & FEATURE_SPECTRAL_CENTROID;
+    const bool want_dominant = feature_mask & FEATURE_DOMINANT_FREQUENCY;
+    const bool want_flux = feature_mask & FEATURE_SPECTRAL_FLUX;
+    uint64_t band_power[BAND_SLOTS] = {0, 0, 0, 0};
+    uint64_t centroid_numerator = 0;
+    uint64_t centroid_denominator = 0;
+    uint32_t max_power = 0;
+    int dominant_bin = 0;
+    uint64_t flux = 0;
+    const int magnitude_shift = exponent + FLUX_SHIFT;
+    int8_t* spectrogram_frame = next_spectrogram_frame();
+    for (int k = 0; k < FFT_SIZE / 2; k++) {
+        uint32_t power = FFTQ15::power(q15_buffer, k);
+        if (spectrogram_frame && k < SPECTROGRAM_BINS) {
+            spectrogram_frame[k] = spectrogram_code_q15(power, exponent);
+        }
+        if (want_bands) {
+            band_power[bin_band[k]] += power;
+        }
+
+        if (want_flux) {
+            uint32_t magnitude = isqrt32(power);
+            magnitude = magnitude_shift >= 0 ? magnitude << magnitude_shift : magnitude >> -magnitude_shift;
+            if (has_prev_spectrum) {
+                flux += magnitude > prev_magnitude_q[k] ? magnitude - prev_magnitude_q[k] : prev_magnitude_q[k] - magnitude;
+            }
+            prev_magnitude_q[k] = magnitude;
+        }
+
+        // DC is left out of the centroid and the peak search
+        if (k > 0) {
+            if (want_centroid) {
+                centroid_numerator += (uint64_t)power * k;
+                centroid_denominator += power;
+            }
+            if (want_dominant && power > max_power) {
+                max_power = power;
+                dominant_bin = k;
+            }
+        }
+    }
+    has_prev_spectrum = want_flux;
+
+    // Float only from here: X_true = X_stored * 2^exponent / 32768, and the
+    // 1/N matches the float path's pre-scaled window
+    const float power_scale = ldexpf(1.0f, 2 * exponent - 30) / FFT_SIZE;
+    const float magnitude_scale = ldexpf(1.0f, -15 - FLUX_SHIFT) / sqrtf((float)FFT_SIZE);
+
+    features.infrasound_energy = band_power[BAND_INFRASOUND] * power_scale;
+    features.low_band_energy = band_power[BAND_LOW] * power_scale;
+    features.mid_band_energy = band_power[BAND_MID] * power_scale;
+    features.spectral_centroid = centroid_denominator > 0
+        ? (float)((double)centroid_numerator / (double)centroid_denominator) * SAMPLE_RATE / FFT_SIZE
+        : 0.0f;
+    features.dominant_frequency = (float)dominant_bin * SAMPLE_RATE / FFT_SIZE;
+    features.spectral_flux = flux * magnitude_scale;
+    mask_band_features(features);
+}
+
+#else
+
+// round(4 * log2(power)) from the float's exponent and mantissa
+static int8_t spectrogram_code_float(float power) {
+    if (!(power > 0.0f)) {
+        return -128;
+    }
+    int exponent;
+    float mantissa = 2.0f * frexpf(power, &exponent);
+    int quarters = 0;
+    while (quarters < 4 && mantissa >= QUARTER_OCTAVE_EDGES[quarters]) {
+        quarters++;
+    }
+    return spectrogram_code(SPECTROGRAM_STEPS_PER_OCTAVE * (exponent - 1) + quarters);
+}
+
+void AudioProcessor::extract_features_float(AudioFeatures& features) {
+    const bool want_rms = feature_mask & FEATURE_RMS;
+    const bool want_envelope = feature_mask & FEATURE_TEMPORAL_ENVELOPE;
+    const bool want_spectrum = (feature_mask & FEATURE_MASK_SPECTRAL) || spectrogram_enabled;
+
+    // Time domain: one pass over the history, oldest first, accumulating
+    // RMS and peak and copying the frame into the FFT buffer; the window is
+    // then one multiply kernel (dsps_mul_f32 with esp-dsp)
+    float sum_squares = 0.0f;
+    float peak = 0.0f;
+    int n = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        int begin = pass == 0 ? (int)write_pos : 0;
+        int end = pass == 0 ? AUDIO_BUFFER_SIZE : (int)write_pos;
+        for (int i = begin; i < end; i++, n++) {
+            float x = audio_buffer[i] * SAMPLE_SCALE;
+            if (want_rms) {
+                sum_squares += x * x;
+            }
+            if (want_envelope) {
+                float magnitude = fabsf(x);
+                if (magnitude > peak) {
+                    peak = magnitude;
+                }
+            }
+            if (want_spectrum) {
+                fft_buffer[n] = audio_buffer[i];
+            }
+        }
+    }
+
+    features.rms = sqrtf(sum_squares / AUDIO_BUFFER_SIZE);
+    features.temporal_envelope = peak;
+    if (!want_spectrum) {
+        clear_spectral_features(features);
+        return;
+    }
+
+    DspKernels::multiply(fft_buffer, window, fft_buffer, FFT_SIZE);
+    // N/2-point complex FFT plus post-twiddle, tables fixed at compile time
+    DspKernels::real_fft<FFT_SIZE>(fft_buffer);
+
+    // The bands are contiguous runs of interleaved (re, im) bins, so each
+    // is one sum-of-squares kernel (dsps_dotprod_f32 with esp-dsp)
+    if (feature_mask & FEATURE_MASK_BANDS) {
+        features.infrasound_energy = spectrum_energy(infrasound_start_bin, infrasound_end_bin);
+        features.low_band_energy = spectrum_energy(infrasound_end_bin, low_band_end_bin);
+        features.mid_band_energy = spectrum_energy(low_band_end_bin, mid_band_end_bin);
+    } else {
+        features.infrasound_energy = 0.0f;
+        features.low_band_energy = 0.0f;
+        features.mid_band_energy = 0.0f;
+    }
+
+    // Spectral: one pass over the bins computes each power and magnitude
+    // once and feeds the centroid, the peak, the flux and the spectrogram
+    const bool want_centroid = feature_mask & FEATURE_SPECTRAL_CENTROID;
+    const bool want_dominant = feature_mask & FEATURE_DOMINANT_FREQUENCY;
+    const bool want_flux = feature_mask & FEATURE_SPECTRAL_FLUX;
+    float centroid_numerator = 0.0f;
+    float centroid_denominator = 0.0f;
+    float max_power = 0.0f;
+    int dominant_bin = 0;
+    float flux = 0.0f;
+    int8_t* spectrogram_frame = next_spectrogram_frame();
+    const int bins = want_centroid || want_dominant || want_flux ? FFT_SIZE / 2
+                     : spectrogram_frame                         ? SPECTROGRAM_BINS
+                                                                 : 0;
+    for (int k = 0; k < bins; k++) {
+        float power = FFT::power(fft_buffer, k);
+        if (spectrogram_frame && k < SPECTROGRAM_BINS) {
+            spectrogram_frame[k] = spectrogram_code_float(power);
+        }
+
+        if (want_flux) {
+            float magnitude = sqrtf(power);
+            if (has_prev_spectrum) {
+                flux += fabsf(magnitude - prev_magnitude[k]);
+            }
+            prev_magnitude[k] = magnitude;
+        }
+
+        // DC is left out of the centroid and the peak search
+        if (k > 0) {
+            if (want_centroid) {
+                centroid_numerator += k * power;
+                centroid_denominator += power;
+            }
+            if (want_dominant && power > max_power) {
+                max_power = power;
+                dominant_bin = k;
+            }
+        }
+    }
+    has_prev_spectrum = want_flux;
+
+    const float bin_hz = (float)SAMPLE_RATE / FFT_SIZE;
+    features.spectral_centroid = centroid_denominator > 0.0f ? centroid_numerator / centroid_denominator * bin_hz : 0.0f;
+    features.dominant_frequency = dominant_bin * bin_hz;
+    features.spectral_flux = flux;
+    mask_band_features(features);
+}
+
+// Power of bins start_bin..end_bin-1 (end_bin <= N/2) of the packed spectrum
+float AudioProcessor::spectrum_energy(int start_bin, int end_bin) const {
+    float energy = 0.0f;
+    if (start_bin == 0) {
+        energy += FFT::power(fft_buffer, 0);  // DC is packed with Nyquist
+        start_bin = 1;
+    }
+    if (end_bin > start_bin) {
+        energy += DspKernels::sum_squares(&fft_buffer[2 * start_bin], 2 * (end_bin - start_bin));
+    }
+    return energy;
+}
+
+#endif
+
+void AudioProcessor::clear_spectral_features(AudioFeatures& features) {
+    features.infrasound_energy = 0.0f;
+    features.low_band_energy = 0.0f;
+    features.mid_band_energy = 0.0f;
+    features.spectral_centroid = 0.0f;
+    features.dominant_frequency = 0.0f;
+    features.spectral_flux = 0.0f;
+    has_prev_spectrum = false;
+}
+
+void AudioProcessor::mask_band_features(AudioFeatures& features) const {
+    // The bands share one accumulation, so unwanted ones are zeroed after it
+    if (!(feature_mask & FEATURE_INFRASOUND_ENERGY)) {
+        features.infrasound_energy = 0.0f;
+    }
+    if (!(feature_mask & FEATURE_LOW_BAND_ENERGY)) {
+        features.low_band_energy = 0.0f;
+    }
+    if (!(feature_mask & FEATURE_MID_BAND_ENERGY)) {
+        features.mid_band_energy = 0.0f;
+    }
+}
+
+int AudioProcessor::hz_to_bin(int hz) {
+    // Nearest bin: 5 Hz -> 1, 35 Hz -> 9, 80 Hz -> 20, 250 Hz -> 64 at 1 kHz / 256
+    return (hz * FFT_SIZE + SAMPLE_RATE / 2) / SAMPLE_RATE;
+}
@@ -0,0 +1,230 @@
+#ifndef AUDIO_PROCESSOR_H
+#define AUDIO_PROCESSOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "RealFFT.h"
+#include "DspKernels.h"
+#include "FixedPointFFT.h"
+
+// Build with -DAUDIO_FIXED_POINT=1 for the integer-only feature path: Q15
+// windowing and FFT with block floating point, 64-bit integer band
+// accumulators, float only when AudioFeatures is filled in. Output is
+// bit-exact between the ESP32 and host builds.
+#ifndef AUDIO_FIXED_POINT
+#define AUDIO_FIXED_POINT 0
+#endif
+
+#ifndef AUDIO_BUFFER_SIZE
+#define AUDIO_BUFFER_SIZE 256
+#endif
+
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE 1000
+#endif
+
+// Samples between successive frames. The analysis window is always
+// AUDIO_BUFFER_SIZE; a smaller hop overlaps frames (128 = 50%).
+#ifndef AUDIO_HOP_SIZE
+#define AUDIO_HOP_SIZE (AUDIO_BUFFER_SIZE / 2)
+#endif
+
+#define FFT_SIZE AUDIO_BUFFER_SIZE
+#define NUM_FEATURES 8
+
+// Rolling log-power spectrogram for the CNN engine: the latest
+// SPECTROGRAM_FRAMES frames of bins 0..SPECTROGRAM_BINS-1 (0-250 Hz at the
+// default 1 kHz / 256), one int8 code per bin
+#ifndef SPECTROGRAM_FRAMES
+#define SPECTROGRAM_FRAMES 32
+#endif
+#ifndef SPECTROGRAM_BINS
+#define SPECTROGRAM_BINS 64
+#endif
+
+// code = round(4 * log2(power)) + 96, saturating: 0.75 dB per step, a
+// full-scale tone near 112, silence at -128
+#define SPECTROGRAM_STEPS_PER_OCTAVE 4
+#define SPECTROGRAM_CODE_OFFSET 96
+
+// Feature mask bits, one per AudioFeatures field in declaration order.
+// Features outside the active mask are not computed and read as 0.
+typedef uint8_t FeatureMask;
+#define FEATURE_RMS                 (1 << 0)
+#define FEATURE_INFRASOUND_ENERGY   (1 << 1)
+#define FEATURE_LOW_BAND_ENERGY     (1 << 2)
+#define FEATURE_MID_BAND_ENERGY     (1 << 3)
+#define FEATURE_SPECTRAL_CENTROID   (1 << 4)
+#define FEATURE_DOMINANT_FREQUENCY  (1 << 5)
+#define FEATURE_SPECTRAL_FLUX       (1 << 6)
+#define FEATURE_TEMPORAL_ENVELOPE   (1 << 7)
+#define FEATURE_MASK_ALL            0xFF
+#define FEATURE_MASK_BANDS          (FEATURE_INFRASOUND_ENERGY | FEATURE_LOW_BAND_ENERGY | FEATURE_MID_BAND_ENERGY)
+#define FEATURE_MASK_SPECTRAL       (FEATURE_MASK_BANDS | FEATURE_SPECTRAL_CENTROID | FEATURE_DOMINANT_FREQUENCY | FEATURE_SPECTRAL_FLUX)
+
+// Frequency bands (Hz)
+#define INFRASOUND_LOW_HZ   5
+#define INFRASOUND_HIGH_HZ  35
+#define LOW_BAND_HIGH_HZ    80
+#define MID_BAND_HIGH_HZ    250
+
+struct AudioFeatures {
+    float rms;
+    float infrasound_energy;
+    float low_band_energy;
+    float mid_band_energy;
+    float spectral_centroid;
+    float dominant_frequency;
+    float spectral_flux;
+    float temporal_envelope;
+};
+
+class AudioProcessor {
+public:
+    AudioProcessor();
+
+    void initialize();
+
+    // Append one sample to the sliding window. Ignored while a frame is
+    // ready and not yet extracted.
+    void add_sample(int16_t sample);
+
+    // Append up to count samples in one call and return how many were taken.
+    // Stops when the next frame becomes ready so the caller can keep the
+    // remainder for the following hop.
+    size_t add_samples(const int16_t* samples, size_t count);
+
+    // A frame is ready once the window is full and a hop has elapsed
+    bool is_frame_ready() const {
+        return history_count >= AUDIO_BUFFER_SIZE && samples_since_frame >= hop_size;
+    }
+
+    // Compute all features over the latest window and start the next hop
+    bool extract_features(AudioFeatures& features);
+
+    // Frames are emitted every hop samples (1..AUDIO_BUFFER_SIZE)
+    bool set_hop_size(size_t hop);
+    size_t get_hop_size() const { return hop_size; }
+
+    // Discard the sample history, e.g. after a gap in acquisition
+    void reset_buffer();
+
+    // Consume a ready frame without running the FFT (see ProcessingCascade)
+    void skip_frame();
+
+    // Per-sample band energies from the sliding DFT, Hann-windowed over
+    // the same history as the next FFT frame. O(bins) to read. The fixed
+    // point build updates the DFT in integers and converts to float only
+    // here, so the traces are bit-exact between targets as well.
+    float get_infrasound_trace() const;
+    float get_low_band_trace() const;
+
+    // Restrict extraction to the features the classifier uses. Turning
+    // flux off drops its magnitude history; with no spectral feature left
+    // the window and FFT are skipped entirely.
+    void set_feature_mask(FeatureMask mask);
+    FeatureMask get_feature_mask() const { return feature_mask; }
+
+    // Inner-loop steps (per-sample or per-bin operations, FFT butterflies)
+    // the current mask removes from each frame relative to FEATURE_MASK_ALL
+    uint32_t get_skipped_steps_per_frame() const;
+
+    // Keep the spectrogram up to date on every extracted frame, running the
+    // FFT even when the feature mask needs no spectral feature. Off by
+    // default; turning it on or off starts an empty spectrogram.
+    void set_spectrogram_enabled(bool enabled);
+    bool get_spectrogram_enabled() const { return spectrogram_enabled; }
+
+    // Consecutive frames held, up to SPECTROGRAM_FRAMES. A skipped frame or
+    // a buffer reset breaks the sequence and starts over.
+    size_t get_spectrogram_frames() const { return spectrogram_count; }
+
+    // Copy the latest frames as [frames][SPECTROGRAM_BINS], oldest first;
+    // false if fewer are held
+    bool copy_spectrogram(int8_t* out, size_t frames) const;
+
+private:
+    // Circular sample history; write_pos is also the oldest sample once full
+    int16_t audio_buffer[AUDIO_BUFFER_SIZE];
+    size_t write_pos;
+    size_t history_count;
+    size_t samples_since_frame;
+    size_t hop_size;
+
+#if AUDIO_FIXED_POINT
+    typedef RealFFTQ15<FFT_SIZE> FFTQ15;
+
+    // Packed Q15 spectrum and the previous frame's magnitudes, stored at a
+    // fixed 2^-FLUX_SHIFT scale so frames with different block exponents
+    // can be compared
+    static const int FLUX_SHIFT = 8;
+    int16_t q15_buffer[FFT_SIZE];
+    uint32_t prev_magnitude_q[FFT_SIZE / 2];
+#else
+    typedef RealFFT<FFT_SIZE> FFT;
+
+    // FFT working arrays. The spectrum is packed in place (see RealFFT.h),
+    // so no separate imaginary buffer is needed.
+    float window[AUDIO_BUFFER_SIZE];
+    float fft_buffer[FFT_SIZE];
+    float prev_magnitude[FFT_SIZE / 2];  // For spectral flux
+#endif
+    bool has_prev_spectrum;
+    FeatureMask feature_mask;
+
+    // Spectrogram ring; spectrogram_head is the next frame to write
+    int8_t spectrogram[SPECTROGRAM_FRAMES][SPECTROGRAM_BINS];
+    size_t spectrogram_head;
+    size_t spectrogram_count;
+    bool spectrogram_enabled;
+
+    // Band limits as FFT bin indices, [start, end)
+    int infrasound_start_bin;
+    int infrasound_end_bin;
+    int low_band_end_bin;
+    int mid_band_end_bin;
+
+    // Band of each bin below Nyquist, so the spectral pass accumulates all
+    // bands with one indexed add instead of a loop per band
+    enum SpectralBand { BAND_INFRASOUND, BAND_LOW, BAND_MID, BAND_NONE, BAND_SLOTS };
+    uint8_t bin_band[FFT_SIZE / 2];
+
+    // Sliding DFT over bins 0..low_band_end_bin, updated on every sample.
+    // One extra bin above the low band feeds the frequency-domain Hann.
+    static const int SDFT_BINS = (LOW_BAND_HIGH_HZ * FFT_SIZE + SAMPLE_RATE / 2) / SAMPLE_RATE + 1;
+#if AUDIO_FIXED_POINT
+    // Integer sliding DFT: bin k sums x[m] W^(k m) with the twiddle taken at
+    // the absolute sample index m mod N, so a sample leaving the history
+    // subtracts exactly the rounded Q15 products it added. Nothing drifts
+    // and no damping is needed; the window start's phase is applied when
+    // the trace is read.
+    int32_t sdft_real[SDFT_BINS];
+    int32_t sdft_imag[SDFT_BINS];
+    int16_t sdft_cos[FFT_SIZE];     // W^m = cos + i sin, W = e^{-i 2 pi / N}
+    int16_t sdft_sin[FFT_SIZE];
+    size_t sdft_phase;              // Index of the next sample mod N
+#else
+    float sdft_real[SDFT_BINS];
+    float sdft_imag[SDFT_BINS];
+    float sdft_cos[SDFT_BINS];
+    float sdft_sin[SDFT_BINS];
+    float sdft_damping_n;           // SDFT_DAMPING^N, applied to the sample leaving
+#endif
+
+    size_t samples_until_frame() const;
+    void update_sliding_dft(const int16_t* samples, size_t count);
+    float sliding_band_energy(int start_bin, int end_bin) const;
+#if AUDIO_FIXED_POINT
+    void extract_features_q15(AudioFeatures& features);
+#else
+    void extract_features_float(AudioFeatures& features);
+    float spectrum_energy(int start_bin, int end_bin) const;
+#endif
+    void clear_spectral_features(AudioFeatures& features);
+    int8_t* next_spectrogram_frame();
+    void mask_band_features(AudioFeatures& features) const;
+
+    static int hz_to_bin(int hz);
+};
+
+#endif
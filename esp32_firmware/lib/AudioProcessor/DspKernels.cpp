@@ -0,0 +1,77 @@
+#include "DspKernels.h"
+
+#if USE_ESP_DSP
+#include <Arduino.h>
+#include "esp_dsp.h"
+#elif defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+bool DspKernels::initialize(size_t max_fft_points) {
+#if USE_ESP_DSP
+    return dsps_fft2r_init_fc32(NULL, (int)max_fft_points) == ESP_OK;
+#else
+    (void)max_fft_points;
+    return true;
+#endif
+}
+
+const char* DspKernels::backend_name() {
+#if USE_ESP_DSP
+    return "esp-dsp";
+#else
+    return "scalar";
+#endif
+}
+
+void DspKernels::multiply(const float* a, const float* b, float* out, size_t n) {
+#if USE_ESP_DSP
+    dsps_mul_f32(a, b, out, (int)n, 1, 1, 1);
+#else
+    multiply_scalar(a, b, out, n);
+#endif
+}
+
+float DspKernels::sum_squares(const float* x, size_t n) {
+#if USE_ESP_DSP
+    float result = 0.0f;
+    dsps_dotprod_f32(x, x, &result, (int)n);
+    return result;
+#else
+    return sum_squares_scalar(x, n);
+#endif
+}
+
+void DspKernels::multiply_scalar(const float* a, const float* b, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+float DspKernels::sum_squares_scalar(const float* x, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i] * x[i];
+    }
+    return sum;
+}
+
+#if USE_ESP_DSP
+void DspKernels::esp_dsp_complex_fft(float* data, size_t n) {
+    dsps_fft2r_fc32(data, (int)n);
+    dsps_bit_rev_fc32(data, (int)n);
+}
+#endif
+
+uint32_t DspKernels::cycle_count() {
+#if defined(ARDUINO) && defined(ESP32)
+    return ESP.getCycleCount();
+#elif defined(ARDUINO)
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
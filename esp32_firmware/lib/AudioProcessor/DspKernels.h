@@ -0,0 +1,111 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "RealFFT.h"
+
+// Build with -DUSE_ESP_DSP=1 to route the hot kernels through Espressif's
+// esp-dsp library (dsps_mul_f32, dsps_fft2r_fc32, dsps_dotprod_f32). Without
+// it, and on host builds, the portable scalar versions below are used.
+#ifndef USE_ESP_DSP
+#define USE_ESP_DSP 0
+#endif
+
+#if USE_ESP_DSP && !(defined(ARDUINO) && defined(ESP32))
+#error "USE_ESP_DSP requires an ESP32 build"
+#endif
+
+struct KernelTiming {
+    const char* name;
+    uint32_t scalar_cycles;
+    uint32_t backend_cycles;
+};
+
+#define DSP_KERNEL_COUNT 3
+
+class DspKernels {
+public:
+    // Prepare backend tables for complex FFTs of up to max_fft_points
+    static bool initialize(size_t max_fft_points);
+    static const char* backend_name();
+
+    // out[i] = a[i] * b[i] (out may alias a or b)
+    static void multiply(const float* a, const float* b, float* out, size_t n);
+
+    // Sum of x[i]^2; over an interleaved complex span this is sum |X[k]|^2
+    static float sum_squares(const float* x, size_t n);
+
+    // RealFFT<N>, with the N/2-point complex stage run by the backend
+    template <size_t N>
+    static void real_fft(float* data) {
+#if USE_ESP_DSP
+        esp_dsp_complex_fft(data, N / 2);
+        RealFFT<N>::split_stage(data);
+#else
+        RealFFT<N>::transform(data);
+#endif
+    }
+
+    // Portable reference versions, always built so the backend can be
+    // compared against them
+    static void multiply_scalar(const float* a, const float* b, float* out, size_t n);
+    static float sum_squares_scalar(const float* x, size_t n);
+
+    // Time each kernel at the given FFT size with both implementations.
+    // Returns the number of entries written (at most DSP_KERNEL_COUNT).
+    template <size_t N>
+    static size_t benchmark(KernelTiming* out) {
+        static float a[N];
+        static float b[N];
+        for (size_t i = 0; i < N; i++) {
+            a[i] = (float)(i % 17) * 0.01f;
+            b[i] = 1.0f - (float)(i % 13) * 0.02f;
+        }
+
+        size_t count = 0;
+        uint32_t start;
+
+        out[count].name = "window";
+        start = cycle_count();
+        multiply_scalar(a, b, a, N);
+        out[count].scalar_cycles = cycle_count() - start;
+        start = cycle_count();
+        multiply(a, b, a, N);
+        out[count].backend_cycles = cycle_count() - start;
+        count++;
+
+        out[count].name = "fft";
+        start = cycle_count();
+        RealFFT<N>::transform(a);
+        out[count].scalar_cycles = cycle_count() - start;
+        start = cycle_count();
+        real_fft<N>(b);
+        out[count].backend_cycles = cycle_count() - start;
+        count++;
+
+        volatile float sink;
+        out[count].name = "band_energy";
+        start = cycle_count();
+        sink = sum_squares_scalar(a, N);
+        out[count].scalar_cycles = cycle_count() - start;
+        start = cycle_count();
+        sink = sum_squares(a, N);
+        out[count].backend_cycles = cycle_count() - start;
+        (void)sink;
+        count++;
+
+        return count;
+    }
+
+    // CPU cycles on the ESP32; nanoseconds on host builds
+    static uint32_t cycle_count();
+
+private:
+#if USE_ESP_DSP
+    // In-place complex FFT over n interleaved (re, im) points, natural order
+    static void esp_dsp_complex_fft(float* data, size_t n);
+#endif
+};
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef FIXED_POINT_FFT_H
+#define FIXED_POINT_FFT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "RealFFT.h"
+
+// Q15 real-input FFT with block floating point.
+//
+// Same structure as RealFFT<N> (N/2-point complex FFT plus split), but on
+// int16 data with Q15 twiddles. Before each stage the block is checked
+// against a headroom limit and shifted right as needed; the shifts are
+// summed into a block exponent so that
+//
+//   X_true[k] = X_stored[k] * 2^exponent       (in units of the Q15 input)
+//
+// Quiet input is shifted left first (negative exponent) to use the full
+// int16 range. All tables are constexpr and every operation is integer, so
+// the output is bit-exact across the ESP32 and host builds.
+
+namespace realfft_detail {
+
+constexpr int16_t to_q15(double x) {
+    return (int16_t)(x * 32767.0 + (x >= 0.0 ? 0.5 : -0.5));
+}
+
+template <size_t N>
+struct TablesQ15 {
+    static const size_t HALF = N / 2;
+
+    int16_t cos_table[HALF] {};
+    int16_t sin_table[HALF] {};    // -sin, so W^k = cos + i sin_table
+    int16_t hann[N] {};
+    uint16_t bit_reverse[HALF] {};
+
+    constexpr TablesQ15() {
+        for (size_t k = 0; k < HALF; k++) {
+            cos_table[k] = to_q15(cos_cx(2.0 * PI_D * k / N));
+            sin_table[k] = to_q15(-sin_cx(2.0 * PI_D * k / N));
+        }
+        for (size_t i = 0; i < N; i++) {
+            hann[i] = to_q15(0.5 * (1.0 - cos_cx(2.0 * PI_D * i / N)));
+        }
+        const size_t bits = log2_size(HALF);
+        for (size_t i = 0; i < HALF; i++) {
+            bit_reverse[i] = (uint16_t)reverse_bits(i, bits);
+        }
+    }
+};
+
+}  // namespace realfft_detail
+
+template <size_t N>
+class RealFFTQ15 {
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "RealFFTQ15 size must be a power of two >= 4");
+
+public:
+    // A radix-2 butterfly or split step grows a component by at most
+    // (1 + sqrt(2)); below this limit the result still fits in int16.
+    static const int32_t HEADROOM_LIMIT = 13573;
+
+    // Sample i of the frame times the Q15 Hann window (periodic, matches
+    // the float path and the sliding DFT's frequency-domain Hann)
+    static inline int16_t windowed(int16_t sample, size_t i) {
+        return mul_q15(sample, tables.hann[i]);
+    }
+
+    // In-place transform of N Q15 samples to the packed spectrum (same
+    // layout as RealFFT<N>). Returns the block exponent.
+    static int transform(int16_t* data) {
+        int exponent = normalize(data);
+        complex_fft(data, exponent);
+        exponent += fit_headroom(data);
+        split(data);
+        return exponent;
+    }
+
+    // |X_stored[k]|^2 as an unsigned Q30 value, 0 <= k <= N/2
+    static inline uint32_t power(const int16_t* data, size_t k) {
+        if (k == 0) {
+            return (uint32_t)((int32_t)data[0] * data[0]);
+        }
+        if (k == N / 2) {
+            return (uint32_t)((int32_t)data[1] * data[1]);
+        }
+        int32_t re = data[2 * k];
+        int32_t im = data[2 * k + 1];
+        return (uint32_t)(re * re) + (uint32_t)(im * im);
+    }
+
+private:
+    static const size_t M = N / 2;
+    static constexpr realfft_detail::TablesQ15<N> tables {};
+
+    static inline int16_t mul_q15(int32_t a, int32_t b) {
+        return (int16_t)((a * b + (1 << 14)) >> 15);
+    }
+
+    static int32_t max_abs(const int16_t* data) {
+        int32_t peak = 0;
+        for (size_t i = 0; i < N; i++) {
+            int32_t v = data[i] < 0 ? -(int32_t)data[i] : data[i];
+            if (v > peak) {
+                peak = v;
+            }
+        }
+        return peak;
+    }
+
+    // Scale quiet input up so precision is not wasted; returns -shift
+    static int normalize(int16_t* data) {
+        int32_t peak = max_abs(data);
+        if (peak == 0) {
+            return 0;
+        }
+        if (peak >= HEADROOM_LIMIT) {
+            return fit_headroom(data);
+        }
+        int shift = 0;
+        while ((peak << (shift + 1)) < HEADROOM_LIMIT) {
+            shift++;
+        }
+        for (size_t i = 0; i < N; i++) {
+            data[i] = (int16_t)(data[i] * (1 << shift));
+        }
+        return -shift;
+    }
+
+    // Shift right until the next stage cannot overflow; returns the shift
+    static int fit_headroom(int16_t* data) {
+        int32_t peak = max_abs(data);
+        int shift = 0;
+        while ((peak >> shift) >= HEADROOM_LIMIT) {
+            shift++;
+        }
+        if (shift > 0) {
+            for (size_t i = 0; i < N; i++) {
+                data[i] = (int16_t)(data[i] >> shift);
+            }
+        }
+        return shift;
+    }
+
+    static void complex_fft(int16_t* z, int& exponent) {
+        for (size_t i = 0; i < M; i++) {
+            size_t j = tables.bit_reverse[i];
+            if (i < j) {
+                int16_t tr = z[2 * i];
+                int16_t ti = z[2 * i + 1];
+                z[2 * i] = z[2 * j];
+                z[2 * i + 1] = z[2 * j + 1];
+                z[2 * j] = tr;
+                z[2 * j + 1] = ti;
+            }
+        }
+
+        for (size_t len = 2; len <= M; len <<= 1) {
+            exponent += fit_headroom(z);
+
+            size_t half = len / 2;
+            size_t stride = 2 * (M / len);
+            for (size_t i = 0; i < M; i += len) {
+                for (size_t k = 0; k < half; k++) {
+                    int32_t wr = tables.cos_table[k * stride];
+                    int32_t wi = tables.sin_table[k * stride];
+                    size_t a = 2 * (i + k);
+                    size_t b = 2 * (i + k + half);
+                    int32_t br = z[b];
+                    int32_t bi = z[b + 1];
+                    int32_t xr = (br * wr - bi * wi + (1 << 14)) >> 15;
+                    int32_t xi = (br * wi + bi * wr + (1 << 14)) >> 15;
+                    int32_t ar = z[a];
+                    int32_t ai = z[a + 1];
+                    z[b] = (int16_t)(ar - xr);
+                    z[b + 1] = (int16_t)(ai - xi);
+                    z[a] = (int16_t)(ar + xr);
+                    z[a + 1] = (int16_t)(ai + xi);
+                }
+            }
+        }
+    }
+
+    // Integer version of RealFFT<N>::split
+    static void split(int16_t* z) {
+        int32_t dc = z[0];
+        int32_t ny = z[1];
+        z[0] = (int16_t)(dc + ny);
+        z[1] = (int16_t)(dc - ny);
+
+        for (size_t k = 1; k <= M / 2; k++) {
+            size_t a = 2 * k;
+            size_t b = 2 * (M - k);
+
+            int32_t fe_r = ((int32_t)z[a] + z[b]) >> 1;
+            int32_t fe_i = ((int32_t)z[a + 1] - z[b + 1]) >> 1;
+            int32_t fo_r = ((int32_t)z[a + 1] + z[b + 1]) >> 1;
+            int32_t fo_i = -(((int32_t)z[a] - z[b]) >> 1);
+
+            int32_t wr = tables.cos_table[k];
+            int32_t wi = tables.sin_table[k];
+            int32_t tr = (wr * fo_r - wi * fo_i + (1 << 14)) >> 15;
+            int32_t ti = (wr * fo_i + wi * fo_r + (1 << 14)) >> 15;
+
+            z[a] = (int16_t)(fe_r + tr);
+            z[a + 1] = (int16_t)(fe_i + ti);
+            z[b] = (int16_t)(fe_r - tr);
+            z[b + 1] = (int16_t)(-(fe_i - ti));
+        }
+    }
+};
+
+template <size_t N>
+constexpr realfft_detail::TablesQ15<N> RealFFTQ15<N>::tables;
+
+#endif
@@ -0,0 +1,63 @@
+#include "ProcessingCascade.h"
+
+HysteresisGate::HysteresisGate(float open_at, float close_below)
+    : open_level(0.0f), close_level(0.0f), open(false) {
+    set_levels(open_at, close_below);
+}
+
+void HysteresisGate::set_levels(float open_at, float close_below) {
+    open_level = open_at;
+    close_level = close_below > open_at ? open_at : close_below;
+    open = false;
+}
+
+bool HysteresisGate::update(float value) {
+    if (!enabled()) {
+        return true;
+    }
+    if (open) {
+        open = value >= close_level;
+    } else {
+        open = value >= open_level;
+    }
+    return open;
+}
+
+ProcessingCascade::ProcessingCascade()
+    : energy(CASCADE_ENERGY_OPEN, CASCADE_ENERGY_CLOSE),
+      spectral(CASCADE_SPECTRAL_OPEN, CASCADE_SPECTRAL_CLOSE) {
+    reset_stats();
+}
+
+bool ProcessingCascade::admit_frame(float infrasound_trace) {
+    stats.frames++;
+    if (!energy.update(infrasound_trace)) {
+        stats.energy_rejected++;
+        // Start the next stage fresh once the energy gate reopens
+        spectral.reset();
+        return false;
+    }
+    return true;
+}
+
+bool ProcessingCascade::admit_features(const AudioFeatures& features) {
+    if (!spectral.update(infrasound_share(features))) {
+        stats.spectral_rejected++;
+        return false;
+    }
+    stats.spectral_passed++;
+    return true;
+}
+
+void ProcessingCascade::reset_stats() {
+    stats.frames = 0;
+    stats.energy_rejected = 0;
+    stats.spectral_rejected = 0;
+    stats.spectral_passed = 0;
+    stats.classified = 0;
+}
+
+float ProcessingCascade::infrasound_share(const AudioFeatures& features) {
+    float total = features.infrasound_energy + features.low_band_energy + features.mid_band_energy;
+    return total > 0.0f ? features.infrasound_energy / total : 0.0f;
+}
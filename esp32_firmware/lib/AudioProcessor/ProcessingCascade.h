@@ -0,0 +1,97 @@
+#ifndef PROCESSING_CASCADE_H
+#define PROCESSING_CASCADE_H
+
+#include <stdint.h>
+#include "AudioProcessor.h"
+
+// Stage 1 (before the FFT): per-sample infrasound trace from the sliding DFT.
+// A level of 0 disables the stage and lets every frame through.
+#ifndef CASCADE_ENERGY_OPEN
+#ifdef INFRASOUND_PRETRIGGER_THRESHOLD
+#define CASCADE_ENERGY_OPEN INFRASOUND_PRETRIGGER_THRESHOLD
+#else
+#define CASCADE_ENERGY_OPEN 0.0f
+#endif
+#endif
+#ifndef CASCADE_ENERGY_CLOSE
+#define CASCADE_ENERGY_CLOSE (CASCADE_ENERGY_OPEN * 0.5f)
+#endif
+
+// Stage 2 (before the classifier): infrasound share of the band energy,
+// infrasound / (infrasound + low + mid), in 0..1
+#ifndef CASCADE_SPECTRAL_OPEN
+#define CASCADE_SPECTRAL_OPEN 0.0f
+#endif
+#ifndef CASCADE_SPECTRAL_CLOSE
+#define CASCADE_SPECTRAL_CLOSE (CASCADE_SPECTRAL_OPEN * 0.8f)
+#endif
+
+// Two-level gate: opens once the value reaches open_level and stays open
+// until it drops below close_level, so a level hovering at the threshold
+// does not toggle every frame
+class HysteresisGate {
+public:
+    HysteresisGate(float open_at = 0.0f, float close_below = 0.0f);
+
+    // close_below is clamped to open_at; open_at <= 0 disables the gate
+    void set_levels(float open_at, float close_below);
+    float get_open_level() const { return open_level; }
+    float get_close_level() const { return close_level; }
+    bool enabled() const { return open_level > 0.0f; }
+
+    // Feed one observation and return whether the gate is now open
+    bool update(float value);
+    bool is_open() const { return !enabled() || open; }
+    void reset() { open = false; }
+
+private:
+    float open_level;
+    float close_level;
+    bool open;
+};
+
+// frames = energy_rejected + spectral_rejected + spectral_passed, all
+// counted per frame. classified counts classifier runs, which main.cpp
+// rate-limits, so it is at most spectral_passed.
+struct CascadeStats {
+    uint32_t frames;               // Frames that reached stage 1
+    uint32_t energy_rejected;      // Dropped before the FFT
+    uint32_t spectral_rejected;    // Features computed, classifier skipped
+    uint32_t spectral_passed;      // Features computed, classifier allowed
+    uint32_t classified;           // Classifier runs
+};
+
+// Energy-gated processing: cheap checks decide whether the next, more
+// expensive stage runs. main.cpp drives it once per ready frame:
+//
+//   admit_frame(trace)        false -> skip_frame(), no FFT
+//   admit_features(features)  false -> no KNN for this frame
+//   record_classification()   after each classifier run
+class ProcessingCascade {
+public:
+    ProcessingCascade();
+
+    bool admit_frame(float infrasound_trace);
+    bool admit_features(const AudioFeatures& features);
+    void record_classification() { stats.classified++; }
+
+    HysteresisGate& energy_gate() { return energy; }
+    HysteresisGate& spectral_gate() { return spectral; }
+
+    // Features stage 2 reads while enabled; extraction must include them
+    // whatever the classifier's own mask, or the share reads 0
+    FeatureMask get_required_features() const { return spectral.enabled() ? FEATURE_MASK_BANDS : 0; }
+
+    CascadeStats get_stats() const { return stats; }
+    void reset_stats();
+
+    // Stage 2 input; 0 when no band energy was computed
+    static float infrasound_share(const AudioFeatures& features);
+
+private:
+    HysteresisGate energy;
+    HysteresisGate spectral;
+    CascadeStats stats;
+};
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef REAL_FFT_H
+#define REAL_FFT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Real-input FFT specialised at compile time for one transform size.
+//
+// N real samples are treated as N/2 interleaved complex values, run through
+// an N/2-point radix-2 complex FFT and split into the N/2 + 1 bins of the
+// real spectrum with a post-twiddle pass. Twiddle and bit-reversal tables
+// are generated by constexpr for exactly N, so nothing is computed at boot
+// and no separate imaginary buffer is needed.
+//
+// Packed output layout (in place, N floats):
+//   data[0]      = Re X[0]      (DC, imaginary part is zero)
+//   data[1]      = Re X[N/2]    (Nyquist, imaginary part is zero)
+//   data[2k]     = Re X[k]      1 <= k < N/2
+//   data[2k + 1] = Im X[k]
+
+namespace realfft_detail {
+
+constexpr double PI_D = 3.14159265358979323846;
+
+// constexpr sine/cosine: reduce to [-pi, pi] and sum the Taylor series
+constexpr double reduce(double x) {
+    while (x > PI_D) {
+        x -= 2.0 * PI_D;
+    }
+    while (x < -PI_D) {
+        x += 2.0 * PI_D;
+    }
+    return x;
+}
+
+constexpr double sin_cx(double x) {
+    x = reduce(x);
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 16; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos_cx(double x) {
+    x = reduce(x);
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 16; n++) {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr size_t log2_size(size_t n) {
+    size_t bits = 0;
+    while (((size_t)1 << bits) < n) {
+        bits++;
+    }
+    return bits;
+}
+
+constexpr size_t reverse_bits(size_t value, size_t bits) {
+    size_t r = 0;
+    for (size_t b = 0; b < bits; b++) {
+        if (value & ((size_t)1 << b)) {
+            r |= (size_t)1 << (bits - 1 - b);
+        }
+    }
+    return r;
+}
+
+template <size_t N>
+struct Tables {
+    static const size_t HALF = N / 2;
+
+    // W^k = exp(-2*pi*i*k/N) for 0 <= k < N/2. The N/2-point complex stage
+    // uses every other entry; the post-twiddle uses all of them.
+    float cos_table[HALF] {};
+    float sin_table[HALF] {};
+    uint16_t bit_reverse[HALF] {};
+
+    constexpr Tables() {
+        for (size_t k = 0; k < HALF; k++) {
+            cos_table[k] = (float)cos_cx(2.0 * PI_D * k / N);
+            sin_table[k] = (float)-sin_cx(2.0 * PI_D * k / N);
+        }
+
+        const size_t bits = log2_size(HALF);
+        for (size_t i = 0; i < HALF; i++) {
+            bit_reverse[i] = (uint16_t)reverse_bits(i, bits);
+        }
+    }
+};
+
+}  // namespace realfft_detail
+
+template <size_t N>
+class RealFFT {
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "RealFFT size must be a power of two >= 4");
+    static_assert(N / 2 <= 65536, "RealFFT bit-reversal table uses 16-bit indices");
+
+public:
+    static const size_t SIZE = N;
+    static const size_t BINS = N / 2 + 1;
+
+    // In-place transform of N real samples to the packed spectrum
+    static void transform(float* data) {
+        complex_fft(data);
+        split(data);
+    }
+
+    // The two halves of transform(), exposed so an accelerated complex FFT
+    // (e.g. esp-dsp) can replace the first stage and reuse the split.
+    static void complex_stage(float* data) { complex_fft(data); }
+    static void split_stage(float* data) { split(data); }
+
+    // |X[k]|^2 from a packed spectrum, 0 <= k <= N/2
+    static inline float power(const float* data, size_t k) {
+        if (k == 0) {
+            return data[0] * data[0];
+        }
+        if (k == N / 2) {
+            return data[1] * data[1];
+        }
+        return data[2 * k] * data[2 * k] + data[2 * k + 1] * data[2 * k + 1];
+    }
+
+private:
+    static const size_t M = N / 2;
+    static constexpr realfft_detail::Tables<N> tables {};
+
+    // N/2-point complex FFT over interleaved (re, im) pairs
+    static void complex_fft(float* z) {
+        for (size_t i = 0; i < M; i++) {
+            size_t j = tables.bit_reverse[i];
+            if (i < j) {
+                float tr = z[2 * i];
+                float ti = z[2 * i + 1];
+                z[2 * i] = z[2 * j];
+                z[2 * i + 1] = z[2 * j + 1];
+                z[2 * j] = tr;
+                z[2 * j + 1] = ti;
+            }
+        }
+
+        for (size_t len = 2; len <= M; len <<= 1) {
+            size_t half = len / 2;
+            size_t stride = 2 * (M / len);     // Index step in the N-point table
+            for (size_t i = 0; i < M; i += len) {
+                for (size_t k = 0; k < half; k++) {
+                    float wr = tables.cos_table[k * stride];
+                    float wi = tables.sin_table[k * stride];
+                    size_t a = 2 * (i + k);
+                    size_t b = 2 * (i + k + half);
+                    float xr = z[b] * wr - z[b + 1] * wi;
+                    float xi = z[b] * wi + z[b + 1] * wr;
+                    z[b] = z[a] - xr;
+                    z[b + 1] = z[a + 1] - xi;
+                    z[a] += xr;
+                    z[a + 1] += xi;
+                }
+            }
+        }
+    }
+
+    // Separate the even/odd sub-spectra: for A = Z[k], B = conj(Z[M-k]),
+    //   Fe = (A + B) / 2,  Fo = -i (A - B) / 2
+    //   X[k] = Fe + W^k Fo,  X[M-k] = conj(Fe - W^k Fo)
+    static void split(float* z) {
+        float dc = z[0];
+        float ny = z[1];
+        z[0] = dc + ny;
+        z[1] = dc - ny;
+
+        for (size_t k = 1; k <= M / 2; k++) {
+            size_t a = 2 * k;
+            size_t b = 2 * (M - k);
+
+            float fe_r = 0.5f * (z[a] + z[b]);
+            float fe_i = 0.5f * (z[a + 1] - z[b + 1]);
+            float fo_r = 0.5f * (z[a + 1] + z[b + 1]);
+            float fo_i = -0.5f * (z[a] - z[b]);
+
+            float wr = tables.cos_table[k];
+            float wi = tables.sin_table[k];
+            float tr = wr * fo_r - wi * fo_i;
+            float ti = wr * fo_i + wi * fo_r;
+
+            z[a] = fe_r + tr;
+            z[a + 1] = fe_i + ti;
+            z[b] = fe_r - tr;
+            z[b + 1] = -(fe_i - ti);
+        }
+    }
+};
+
+template <size_t N>
+constexpr realfft_detail::Tables<N> RealFFT<N>::tables;
+
+#endif
@@ -0,0 +1,115 @@
+#include "CnnClassifier.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <FS.h>
+#include <SPIFFS.h>
+#endif
+
+bool CnnClassifier::load(const uint8_t* data, size_t size) {
+    loaded = false;
+    if (!data || size > CNN_MAX_MODEL_BYTES) {
+        model.clear();
+        return false;
+    }
+    memcpy(blob, data, size);
+    return parse_blob(size);
+}
+
+bool CnnClassifier::parse_blob(size_t size) {
+    loaded = model.parse(blob, size, CNN_ARENA_SIZE) &&
+             model.get_input_bins() == SPECTROGRAM_BINS &&
+             model.get_input_frames() <= SPECTROGRAM_FRAMES;
+    return loaded;
+}
+
+const int8_t* CnnClassifier::invoke() {
+    for (size_t i = 0; i < model.get_layer_count(); i++) {
+        const CnnLayer& layer = model.layer(i);
+        const int8_t* in = arena + layer.input_offset;
+        int8_t* out = arena + layer.output_offset;
+        switch (layer.type) {
+        case CNN_CONV1D:
+            Int8Kernels::conv1d(in, layer.in_frames, layer.in_channels, layer.weights, layer.kernel,
+                                layer.stride, layer.out_channels, layer.channels, layer.quant, out);
+            break;
+        case CNN_DEPTHWISE:
+            Int8Kernels::depthwise_conv1d(in, layer.in_frames, layer.in_channels, layer.weights, layer.kernel,
+                                          layer.stride, layer.channels, layer.quant, out);
+            break;
+        case CNN_MAX_POOL:
+            Int8Kernels::max_pool1d(in, layer.in_frames, layer.in_channels, layer.kernel, layer.stride, out);
+            break;
+        case CNN_AVG_POOL:
+            Int8Kernels::avg_pool1d(in, layer.in_frames, layer.in_channels, layer.kernel, layer.stride, out);
+            break;
+        case CNN_DENSE:
+            Int8Kernels::dense(in, (size_t)layer.in_frames * layer.in_channels, layer.weights,
+                               layer.out_channels, layer.channels, layer.quant, out);
+            break;
+        }
+    }
+    return arena + model.get_output_offset();
+}
+
+int CnnClassifier::classify(const AudioProcessor& audio, KnnResult& result) {
+    if (!loaded || !audio.copy_spectrogram(input_tensor(), model.get_input_frames())) {
+        clear_result(KNN_INSUFFICIENT_DATA, result);
+        return result.label_id;
+    }
+    return classify_input(result);
+}
+
+int CnnClassifier::classify_input(KnnResult& result) {
+    if (!loaded) {
+        clear_result(KNN_INSUFFICIENT_DATA, result);
+        return result.label_id;
+    }
+
+    const int8_t* codes = invoke();
+    const size_t count = model.get_label_count();
+    const float scale = model.get_output_scale();
+
+    // The output zero point cancels in the softmax
+    float logits[MAX_LABELS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        logits[i] = scale * (float)codes[i];
+    }
+    softmax_result(logits, count, result);
+    return result.label_id;
+}
+
+const char* CnnClassifier::get_label_name(int label_id) const {
+    if (label_id == KNN_INSUFFICIENT_DATA) {
+        return "insufficient_data";
+    }
+    if (!loaded || label_id < 0 || label_id >= (int)model.get_label_count()) {
+        return "unknown";
+    }
+    return model.label(label_id);
+}
+
+#ifdef ARDUINO
+
+static const char* MODEL_PATH = "/cnn_model.bin";
+
+bool CnnClassifier::load_from_storage() {
+    File file = SPIFFS.open(MODEL_PATH, FILE_READ);
+    if (!file) {
+        return false;
+    }
+    size_t size = file.size();
+    bool complete = size <= CNN_MAX_MODEL_BYTES && file.read(blob, size) == size;
+    file.close();
+
+    loaded = false;
+    return complete && parse_blob(size);
+}
+
+#else
+
+bool CnnClassifier::load_from_storage() {
+    return false;
+}
+
+#endif
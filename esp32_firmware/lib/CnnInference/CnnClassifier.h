@@ -0,0 +1,65 @@
+#ifndef CNN_CLASSIFIER_H
+#define CNN_CLASSIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AudioProcessor.h"
+#include "KnnResult.h"
+#include "CnnModel.h"
+
+// Largest weight blob, held in RAM after loading
+#ifndef CNN_MAX_MODEL_BYTES
+#define CNN_MAX_MODEL_BYTES 16384
+#endif
+
+// Activations: the input spectrogram and every intermediate tensor. A
+// model whose largest input + output pair does not fit is rejected.
+#ifndef CNN_ARENA_SIZE
+#define CNN_ARENA_SIZE 8192
+#endif
+
+// Int8 1D-CNN over the AudioProcessor spectrogram: convolutions run along
+// time with the frequency bins as input channels. The blob, the arena and
+// the layer table are members, so a global CnnClassifier uses no heap;
+// inference is a fixed sequence of integer kernels and a float softmax.
+class CnnClassifier {
+public:
+    CnnClassifier() : loaded(false) {}
+
+    // Copy a weight blob in and plan the arena; false, with nothing
+    // loaded, if it is larger than CNN_MAX_MODEL_BYTES, malformed, too big
+    // for the arena, or its input does not match the spectrogram
+    bool load(const uint8_t* blob, size_t size);
+
+    // load() from SPIFFS (no-op returning false off-device)
+    bool load_from_storage();
+
+    bool is_loaded() const { return loaded; }
+    const CnnModel& get_model() const { return model; }
+    size_t get_input_frames() const { return loaded ? model.get_input_frames() : 0; }
+
+    // Classify the latest get_input_frames() spectrogram frames. Scores are
+    // the softmax of the logits. KNN_INSUFFICIENT_DATA until that many
+    // consecutive frames are held, or without a model.
+    int classify(const AudioProcessor& audio, KnnResult& result);
+
+    // The same on an input written to input_tensor() ([frames][bins])
+    int8_t* input_tensor() { return arena; }
+    int classify_input(KnnResult& result);
+
+    // Run the layers over input_tensor(); returns the output logit codes
+    const int8_t* invoke();
+
+    const char* get_label_name(int label_id) const;
+
+private:
+    alignas(4) uint8_t blob[CNN_MAX_MODEL_BYTES];
+    alignas(4) int8_t arena[CNN_ARENA_SIZE];
+    CnnModel model;
+    bool loaded;
+
+    // Parse the first size bytes of blob; sets loaded
+    bool parse_blob(size_t size);
+};
+
+#endif
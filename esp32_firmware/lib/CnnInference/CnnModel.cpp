@@ -0,0 +1,182 @@
+#include "CnnModel.h"
+#include <string.h>
+
+static_assert(sizeof(CnnBlobHeader) == 16, "CnnBlobHeader is part of the blob format");
+static_assert(sizeof(CnnLayerHeader) == 12, "CnnLayerHeader is part of the blob format");
+
+static size_t align4(size_t n) {
+    return (n + 3) & ~(size_t)3;
+}
+
+// Bounds-checked walk over the blob, one 4-byte aligned section at a time
+struct BlobCursor {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+
+    const uint8_t* take(size_t bytes) {
+        if (align4(bytes) > size - offset) {
+            return NULL;
+        }
+        const uint8_t* section = data + offset;
+        offset += align4(bytes);
+        return section;
+    }
+};
+
+bool CnnModel::parse(const uint8_t* blob, size_t size, size_t arena_size) {
+    clear();
+    if (!blob || ((uintptr_t)blob & 3) != 0) {
+        return false;
+    }
+
+    BlobCursor cursor = {blob, size, 0};
+    const uint8_t* section = cursor.take(sizeof(CnnBlobHeader));
+    if (!section) {
+        return false;
+    }
+    memcpy(&header, section, sizeof(header));
+    if (header.magic != CNN_BLOB_MAGIC || header.version != CNN_BLOB_VERSION ||
+        header.layer_count == 0 || header.layer_count > CNN_MAX_LAYERS ||
+        header.label_count == 0 || header.label_count > MAX_LABELS ||
+        header.input_frames == 0 || header.input_bins == 0 || !(header.output_scale > 0.0f)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < header.label_count; i++) {
+        const char* name = (const char*)cursor.take(CNN_LABEL_BYTES);
+        size_t length = name ? strnlen(name, CNN_LABEL_BYTES) : 0;
+        if (length == 0 || length > KNN_LABEL_LENGTH) {
+            return false;
+        }
+        labels[i] = name;
+    }
+
+    size_t frames = header.input_frames;
+    size_t channels_count = header.input_bins;
+    int32_t zero_point = header.input_zero_point;
+    for (size_t i = 0; i < header.layer_count; i++) {
+        section = cursor.take(sizeof(CnnLayerHeader));
+        if (!section) {
+            return false;
+        }
+        CnnLayerHeader layer_header;
+        memcpy(&layer_header, section, sizeof(layer_header));
+
+        CnnLayer& layer = layers[i];
+        layer.type = (CnnLayerType)layer_header.type;
+        layer.kernel = layer_header.kernel;
+        layer.stride = layer_header.stride;
+        layer.in_frames = frames;
+        layer.in_channels = channels_count;
+        layer.out_channels = channels_count;
+        layer.weights = NULL;
+        layer.quant.input_zero_point = zero_point;
+        layer.quant.output_zero_point = layer_header.output_zero_point;
+        layer.quant.act_min = layer_header.act_min;
+        layer.quant.act_max = layer_header.act_max;
+
+        size_t weight_count = 0;
+        switch (layer.type) {
+        case CNN_CONV1D:
+            layer.out_channels = layer_header.out_channels;
+            weight_count = (size_t)layer.out_channels * layer.kernel * channels_count;
+            break;
+        case CNN_DEPTHWISE:
+            if (channels_count > INT8_MAX_DEPTHWISE_CHANNELS) {
+                return false;
+            }
+            weight_count = (size_t)layer.kernel * channels_count;
+            break;
+        case CNN_MAX_POOL:
+        case CNN_AVG_POOL:
+            if (layer.kernel == 0) {
+                layer.kernel = frames;
+                layer.stride = 1;
+            }
+            // Pooling keeps the input's scale and zero point
+            if (layer.quant.output_zero_point != zero_point) {
+                return false;
+            }
+            break;
+        case CNN_DENSE:
+            layer.kernel = frames;
+            layer.stride = 1;
+            layer.out_channels = layer_header.out_channels;
+            weight_count = (size_t)layer.out_channels * frames * channels_count;
+            break;
+        default:
+            return false;
+        }
+        if (layer.kernel == 0 || layer.stride == 0 || layer.out_channels == 0 ||
+            layer.quant.act_min > layer.quant.act_max) {
+            return false;
+        }
+        layer.out_frames = Int8Kernels::output_frames(frames, layer.kernel, layer.stride);
+        if (layer.out_frames == 0) {
+            return false;
+        }
+
+        if (weight_count > 0) {
+            size_t outputs = layer.out_channels;
+            layer.weights = (const int8_t*)cursor.take(weight_count);
+            layer.channels.bias = (const int32_t*)cursor.take(outputs * sizeof(int32_t));
+            layer.channels.multiplier = (const int32_t*)cursor.take(outputs * sizeof(int32_t));
+            layer.channels.shift = (const int8_t*)cursor.take(outputs);
+            if (!layer.weights || !layer.channels.bias || !layer.channels.multiplier || !layer.channels.shift) {
+                return false;
+            }
+            for (size_t c = 0; c < outputs; c++) {
+                if (layer.channels.shift[c] < -30 || layer.channels.shift[c] > 31) {
+                    return false;
+                }
+            }
+        }
+
+        frames = layer.out_frames;
+        channels_count = layer.out_channels;
+        zero_point = layer.quant.output_zero_point;
+    }
+
+    // Exactly one logit per label, and nothing after the last layer
+    if (frames * channels_count != header.label_count || cursor.offset != size) {
+        return false;
+    }
+
+    layer_count = header.layer_count;
+    label_count = header.label_count;
+    if (!plan_arena(arena_size)) {
+        // Keep the requirement so the caller can report it
+        size_t required = arena_required;
+        clear();
+        arena_required = required;
+        return false;
+    }
+    return true;
+}
+
+bool CnnModel::plan_arena(size_t arena_size) {
+    // The input sits at the start; each output goes to the end the layer's
+    // input is not at, 4-byte aligned
+    arena_size &= ~(size_t)3;
+    size_t in_offset = 0;
+    size_t in_size = header.input_frames * header.input_bins;
+    arena_required = 0;
+    for (size_t i = 0; i < layer_count; i++) {
+        CnnLayer& layer = layers[i];
+        size_t out_size = (size_t)layer.out_frames * layer.out_channels;
+        size_t needed = align4(in_size) + align4(out_size);
+        if (needed > arena_required) {
+            arena_required = needed;
+        }
+        if (needed > arena_size) {
+            return false;
+        }
+
+        layer.input_offset = in_offset;
+        layer.output_offset = in_offset == 0 ? (arena_size - out_size) & ~(size_t)3 : 0;
+        in_offset = layer.output_offset;
+        in_size = out_size;
+    }
+    return true;
+}
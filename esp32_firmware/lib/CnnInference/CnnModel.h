@@ -0,0 +1,118 @@
+#ifndef CNN_MODEL_H
+#define CNN_MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Int8Kernels.h"
+#include "LabelDictionary.h"
+
+#ifndef CNN_MAX_LAYERS
+#define CNN_MAX_LAYERS 16
+#endif
+
+// Weight blob layout (version 1), little-endian; every section starts on a
+// 4-byte boundary, zero-padded:
+//
+//   CnnBlobHeader
+//   label_count names, CNN_LABEL_BYTES each, NUL-padded
+//   per layer: CnnLayerHeader, then for conv1d, depthwise and dense
+//     int8 weights     conv1d [out][kernel][in], depthwise [kernel][channel],
+//                      dense [out][in frames * in channels]
+//     int32 bias[out], int32 multiplier[out], int8 shift[out]
+//
+// The input is [input_frames][input_bins] spectrogram codes. The last
+// layer's output holds one logit per label.
+#define CNN_BLOB_MAGIC 0x314E4345  // "ECN1"
+#define CNN_BLOB_VERSION 1
+#define CNN_LABEL_BYTES 16
+
+enum CnnLayerType {
+    CNN_CONV1D = 1,
+    CNN_DEPTHWISE = 2,
+    CNN_MAX_POOL = 3,
+    CNN_AVG_POOL = 4,       // Kernel 0 pools over all frames
+    CNN_DENSE = 5
+};
+
+struct CnnBlobHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t layer_count;
+    uint8_t label_count;
+    uint8_t input_frames;
+    uint8_t input_bins;
+    int8_t input_zero_point;
+    uint16_t reserved;
+    float output_scale;             // Logit = output_scale * (code - output zero point)
+};
+
+struct CnnLayerHeader {
+    uint8_t type;                   // CnnLayerType
+    uint8_t kernel;                 // Frames per window; pools: 0 = all
+    uint8_t stride;
+    uint8_t reserved0;
+    uint16_t out_channels;          // conv1d and dense; others keep the input's
+    uint16_t reserved1;
+    int8_t output_zero_point;       // Pools must repeat the input's
+    int8_t act_min;
+    int8_t act_max;
+    uint8_t reserved2;
+};
+
+// One parsed layer: shapes, pointers into the blob and where its input
+// and output live in the arena
+struct CnnLayer {
+    CnnLayerType type;
+    uint16_t kernel;
+    uint16_t stride;
+    uint16_t in_frames;
+    uint16_t in_channels;
+    uint16_t out_frames;
+    uint16_t out_channels;
+    const int8_t* weights;
+    ChannelQuant channels;
+    LayerQuant quant;
+    uint32_t input_offset;
+    uint32_t output_offset;
+};
+
+// Validated view of a weight blob plus the static arena plan. Tensors
+// alternate between the two ends of the arena, so a layer's output never
+// overlaps its input and nothing is allocated per inference.
+class CnnModel {
+public:
+    CnnModel() : layer_count(0), label_count(0), arena_required(0) {}
+
+    // False, with nothing parsed, for a malformed or truncated blob, a blob
+    // not 4-byte aligned, or a network that needs more than arena_size
+    // bytes. The blob must outlive the model.
+    bool parse(const uint8_t* blob, size_t size, size_t arena_size);
+    void clear() { layer_count = 0; label_count = 0; arena_required = 0; }
+
+    size_t get_layer_count() const { return layer_count; }
+    const CnnLayer& layer(size_t i) const { return layers[i]; }
+    size_t get_label_count() const { return label_count; }
+    const char* label(size_t i) const { return labels[i]; }
+
+    size_t get_input_frames() const { return header.input_frames; }
+    size_t get_input_bins() const { return header.input_bins; }
+    float get_output_scale() const { return header.output_scale; }
+
+    // Largest input + output pair, the smallest arena that fits the network;
+    // also set when parse() failed only for lack of arena
+    size_t get_arena_required() const { return arena_required; }
+    // Where the output logits end up
+    uint32_t get_output_offset() const { return layers[layer_count - 1].output_offset; }
+
+private:
+    CnnBlobHeader header;
+    CnnLayer layers[CNN_MAX_LAYERS];
+    const char* labels[MAX_LABELS];
+    size_t layer_count;
+    size_t label_count;
+    size_t arena_required;
+
+    bool plan_arena(size_t arena_size);
+};
+
+#endif
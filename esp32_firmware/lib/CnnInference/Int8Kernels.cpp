@@ -0,0 +1,91 @@
+#include "Int8Kernels.h"
+
+int32_t Int8Kernels::dot(const int8_t* in, const int8_t* weights, size_t count, int32_t zero_point) {
+    // sum (x - zp) * w = sum x * w - zp * sum w, one multiply-add per term
+    int32_t sum = 0;
+    int32_t weight_sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += (int32_t)in[i] * weights[i];
+        weight_sum += weights[i];
+    }
+    return sum - zero_point * weight_sum;
+}
+
+void Int8Kernels::conv1d(const int8_t* in, size_t frames, size_t in_channels,
+                         const int8_t* weights, size_t kernel, size_t stride, size_t out_channels,
+                         const ChannelQuant& channels, const LayerQuant& quant, int8_t* out) {
+    const size_t window = kernel * in_channels;
+    const size_t out_frames = output_frames(frames, kernel, stride);
+    for (size_t t = 0; t < out_frames; t++) {
+        const int8_t* span = in + t * stride * in_channels;
+        for (size_t o = 0; o < out_channels; o++) {
+            int32_t acc = channels.bias[o] + dot(span, weights + o * window, window, quant.input_zero_point);
+            *out++ = to_output(acc, channels, o, quant);
+        }
+    }
+}
+
+void Int8Kernels::depthwise_conv1d(const int8_t* in, size_t frames, size_t channels_count,
+                                   const int8_t* weights, size_t kernel, size_t stride,
+                                   const ChannelQuant& channels, const LayerQuant& quant, int8_t* out) {
+    int32_t acc[INT8_MAX_DEPTHWISE_CHANNELS];
+    const size_t out_frames = output_frames(frames, kernel, stride);
+    for (size_t t = 0; t < out_frames; t++) {
+        for (size_t c = 0; c < channels_count; c++) {
+            acc[c] = channels.bias[c];
+        }
+        // Row by row so both the input and the [kernel][channel] weights
+        // are read in order
+        for (size_t k = 0; k < kernel; k++) {
+            const int8_t* row = in + (t * stride + k) * channels_count;
+            const int8_t* taps = weights + k * channels_count;
+            for (size_t c = 0; c < channels_count; c++) {
+                acc[c] += ((int32_t)row[c] - quant.input_zero_point) * taps[c];
+            }
+        }
+        for (size_t c = 0; c < channels_count; c++) {
+            *out++ = to_output(acc[c], channels, c, quant);
+        }
+    }
+}
+
+void Int8Kernels::max_pool1d(const int8_t* in, size_t frames, size_t channels_count,
+                             size_t kernel, size_t stride, int8_t* out) {
+    const size_t out_frames = output_frames(frames, kernel, stride);
+    for (size_t t = 0; t < out_frames; t++) {
+        const int8_t* first = in + t * stride * channels_count;
+        for (size_t c = 0; c < channels_count; c++) {
+            int8_t best = first[c];
+            for (size_t k = 1; k < kernel; k++) {
+                int8_t value = first[k * channels_count + c];
+                best = value > best ? value : best;
+            }
+            *out++ = best;
+        }
+    }
+}
+
+void Int8Kernels::avg_pool1d(const int8_t* in, size_t frames, size_t channels_count,
+                             size_t kernel, size_t stride, int8_t* out) {
+    const size_t out_frames = output_frames(frames, kernel, stride);
+    const int32_t half = (int32_t)kernel / 2;
+    for (size_t t = 0; t < out_frames; t++) {
+        const int8_t* first = in + t * stride * channels_count;
+        for (size_t c = 0; c < channels_count; c++) {
+            int32_t sum = 0;
+            for (size_t k = 0; k < kernel; k++) {
+                sum += first[k * channels_count + c];
+            }
+            // C++ division truncates toward zero on every target
+            *out++ = (int8_t)((sum >= 0 ? sum + half : sum - half) / (int32_t)kernel);
+        }
+    }
+}
+
+void Int8Kernels::dense(const int8_t* in, size_t inputs, const int8_t* weights, size_t outputs,
+                        const ChannelQuant& channels, const LayerQuant& quant, int8_t* out) {
+    for (size_t o = 0; o < outputs; o++) {
+        int32_t acc = channels.bias[o] + dot(in, weights + o * inputs, inputs, quant.input_zero_point);
+        out[o] = to_output(acc, channels, o, quant);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef INT8_KERNELS_H
+#define INT8_KERNELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Widest depthwise layer (its accumulators live on the stack)
+#ifndef INT8_MAX_DEPTHWISE_CHANNELS
+#define INT8_MAX_DEPTHWISE_CHANNELS 128
+#endif
+
+// Requantization of one output channel from its int32 accumulator. The
+// real scale input_scale * weight_scale / output_scale is
+// multiplier * 2^-(31 + shift), multiplier normally in [2^30, 2^31).
+struct ChannelQuant {
+    const int32_t* bias;            // Added to the accumulator, at input * weight scale
+    const int32_t* multiplier;
+    const int8_t* shift;            // -30..31
+};
+
+// Zero points and the fused activation of one layer. Weights are
+// symmetric (zero point 0); ReLU is act_min = output_zero_point.
+struct LayerQuant {
+    int32_t input_zero_point;
+    int32_t output_zero_point;
+    int8_t act_min;
+    int8_t act_max;
+};
+
+// Integer-only kernels over time-major tensors, [frames][channels] int8.
+// All padding is "valid" and every result is exactly defined, so device
+// and host builds produce identical outputs.
+class Int8Kernels {
+public:
+    // round(acc * multiplier / 2^(31 + shift)), halves rounded up
+    static int32_t requantize(int32_t acc, int32_t multiplier, int shift) {
+        int total = 31 + shift;
+        int64_t product = (int64_t)acc * multiplier;
+        return (int32_t)((product + ((int64_t)1 << (total - 1))) >> total);
+    }
+
+    static int8_t to_output(int32_t acc, const ChannelQuant& channels, size_t c, const LayerQuant& quant) {
+        int32_t value = quant.output_zero_point + requantize(acc, channels.multiplier[c], channels.shift[c]);
+        return (int8_t)(value < quant.act_min ? quant.act_min : value > quant.act_max ? quant.act_max : value);
+    }
+
+    // Output frames of a window of kernel frames moved by stride
+    static size_t output_frames(size_t frames, size_t kernel, size_t stride) {
+        return frames < kernel ? 0 : (frames - kernel) / stride + 1;
+    }
+
+    // out[t][o] = sum over k, c of in[t * stride + k][c] * weights[o][k][c].
+    // The input window of one output frame is contiguous, so each output
+    // is one dot product of kernel * in_channels values.
+    static void conv1d(const int8_t* in, size_t frames, size_t in_channels,
+                       const int8_t* weights, size_t kernel, size_t stride, size_t out_channels,
+                       const ChannelQuant& channels, const LayerQuant& quant, int8_t* out);
+
+    // One filter per channel: out[t][c] = sum over k of
+    // in[t * stride + k][c] * weights[k][c]; channels is at most
+    // INT8_MAX_DEPTHWISE_CHANNELS
+    static void depthwise_conv1d(const int8_t* in, size_t frames, size_t channels_count,
+                                 const int8_t* weights, size_t kernel, size_t stride,
+                                 const ChannelQuant& channels, const LayerQuant& quant, int8_t* out);
+
+    // Pooling keeps the input's quantization. The average rounds halves
+    // away from zero.
+    static void max_pool1d(const int8_t* in, size_t frames, size_t channels_count,
+                           size_t kernel, size_t stride, int8_t* out);
+    static void avg_pool1d(const int8_t* in, size_t frames, size_t channels_count,
+                           size_t kernel, size_t stride, int8_t* out);
+
+    // out[o] = sum over i of in[i] * weights[o][i], the input flattened
+    static void dense(const int8_t* in, size_t inputs, const int8_t* weights, size_t outputs,
+                      const ChannelQuant& channels, const LayerQuant& quant, int8_t* out);
+
+private:
+    static int32_t dot(const int8_t* in, const int8_t* weights, size_t count, int32_t zero_point);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "CrossValidation.h"
+
+bool CrossValidation::start(const KNNClassifier& classifier) {
+    clear();
+    if (classifier.get_sample_count() <= MIN_TRAINING_SAMPLES) {
+        return false;
+    }
+    revision = classifier.get_revision();
+    total = classifier.get_sample_count();
+    label_count = classifier.get_label_count();
+    confusion.assign(label_count * label_count, 0);
+    rejected.assign(label_count, 0);
+    state = CV_RUNNING;
+    return true;
+}
+
+bool CrossValidation::step(KNNClassifier& classifier, size_t count) {
+    if (state != CV_RUNNING) {
+        return false;
+    }
+    if (classifier.get_revision() != revision) {
+        state = CV_CANCELLED;
+        return false;
+    }
+
+    KnnResult result;
+    for (size_t end = next + count < total ? next + count : total; next < end; next++) {
+        uint8_t label_id = classifier.get_sample_label(next);
+        int predicted = classifier.classify_held_out(next, result);
+        if (predicted < 0) {
+            rejected[label_id]++;
+            continue;
+        }
+        confusion[label_id * label_count + predicted]++;
+        correct += predicted == label_id;
+    }
+
+    if (next == total) {
+        state = CV_DONE;
+        return false;
+    }
+    return true;
+}
+
+void CrossValidation::clear() {
+    state = CV_IDLE;
+    next = 0;
+    total = 0;
+    label_count = 0;
+    correct = 0;
+    std::vector<uint32_t>().swap(confusion);
+    std::vector<uint32_t>().swap(rejected);
+}
+
+uint32_t CrossValidation::get_support(size_t true_label) const {
+    uint32_t support = rejected[true_label];
+    for (size_t p = 0; p < label_count; p++) {
+        support += get_count(true_label, p);
+    }
+    return support;
+}
+
+float CrossValidation::get_recall(size_t true_label) const {
+    uint32_t support = get_support(true_label);
+    return support ? (float)get_count(true_label, true_label) / support : 0.0f;
+}
+
+uint32_t CrossValidation::get_rejected_total() const {
+    uint32_t sum = 0;
+    for (size_t l = 0; l < label_count; l++) {
+        sum += rejected[l];
+    }
+    return sum;
+}
@@ -0,0 +1,66 @@
+#ifndef CROSS_VALIDATION_H
+#define CROSS_VALIDATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "KNNClassifier.h"
+
+enum CrossValidationState {
+    CV_IDLE,
+    CV_RUNNING,
+    CV_DONE,
+    CV_CANCELLED        // The training set changed during the pass
+};
+
+// Leave-one-out accuracy of the stored k-NN training set, computed a few
+// samples at a time so the caller can keep processing audio in between.
+// Each sample is classified by all the others with the classifier's own
+// search (KNNClassifier::classify_held_out), so the KD-tree prunes most
+// distances and no distance matrix is kept.
+class CrossValidation {
+public:
+    CrossValidation() : state(CV_IDLE), revision(0), next(0), total(0), label_count(0), correct(0) {}
+
+    // Start a pass over the current training set, dropping any earlier
+    // one; false with too few samples to leave one out
+    bool start(const KNNClassifier& classifier);
+
+    // Classify up to count more samples. False once the pass is over:
+    // done, or cancelled because the training set changed since start().
+    bool step(KNNClassifier& classifier, size_t count);
+
+    // Back to idle; frees the counts
+    void clear();
+
+    CrossValidationState get_state() const { return state; }
+    size_t get_evaluated() const { return next; }
+    size_t get_total() const { return total; }
+    size_t get_label_count() const { return label_count; }
+
+    // Held-out samples of true_label classified as predicted, rejected
+    // (nearest neighbour too far) or in total
+    uint32_t get_count(size_t true_label, size_t predicted) const {
+        return confusion[true_label * label_count + predicted];
+    }
+    uint32_t get_rejected(size_t true_label) const { return rejected[true_label]; }
+    uint32_t get_support(size_t true_label) const;
+
+    // Share of the label's samples classified as the label; 0 without any
+    float get_recall(size_t true_label) const;
+    uint32_t get_correct() const { return correct; }
+    uint32_t get_rejected_total() const;
+    float get_accuracy() const { return next ? (float)correct / next : 0.0f; }
+
+private:
+    CrossValidationState state;
+    uint32_t revision;
+    size_t next;                        // Next sample to hold out
+    size_t total;
+    size_t label_count;
+    uint32_t correct;
+    std::vector<uint32_t> confusion;    // [true * label_count + predicted]
+    std::vector<uint32_t> rejected;     // [true]
+};
+
+#endif
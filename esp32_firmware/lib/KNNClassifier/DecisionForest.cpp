@@ -0,0 +1,50 @@
+#include "DecisionForest.h"
+
+bool DecisionForest::load(const ForestModel* forest) {
+    model = nullptr;
+    if (!forest || forest->tree_count == 0 || forest->label_count == 0 || forest->label_count > MAX_LABELS) {
+        return false;
+    }
+    model = forest;
+    return true;
+}
+
+uint8_t DecisionForest::evaluate_tree(const ForestNode* root, const float* values) {
+    const ForestNode* node = root;
+    while (node->feature >= 0) {
+        node += values[node->feature] <= node->threshold ? 1 : node->right;
+    }
+    return node->label;
+}
+
+int DecisionForest::classify(const AudioFeatures& features, KnnResult& result) const {
+    if (!model) {
+        clear_result(KNN_INSUFFICIENT_DATA, result);
+        return result.label_id;
+    }
+
+    const float values[NUM_FEATURES] = {
+        features.rms, features.infrasound_energy, features.low_band_energy, features.mid_band_energy,
+        features.spectral_centroid, features.dominant_frequency, features.spectral_flux,
+        features.temporal_envelope
+    };
+
+    uint16_t votes[MAX_LABELS] = {0};
+    uint8_t ranked[MAX_LABELS];     // Distinct labels, first tree first
+    size_t distinct = 0;
+    for (uint16_t t = 0; t < model->tree_count; t++) {
+        uint8_t label_id = evaluate_tree(model->nodes + model->tree_start[t], values);
+        if (votes[label_id]++ == 0) {
+            ranked[distinct++] = label_id;
+        }
+    }
+    rank_votes(votes, ranked, distinct, model->tree_count, result);
+    return result.label_id;
+}
+
+const char* DecisionForest::get_label_name(int label_id) const {
+    if (!model || label_id < 0 || label_id >= model->label_count) {
+        return "unknown";
+    }
+    return model->labels[label_id];
+}
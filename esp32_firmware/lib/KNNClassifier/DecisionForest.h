@@ -0,0 +1,57 @@
+#ifndef DECISION_FOREST_H
+#define DECISION_FOREST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AudioProcessor.h"
+#include "KnnResult.h"
+
+// One node of a flattened decision tree. Trees are stored in pre-order:
+// the left child directly follows its parent, the right child is `right`
+// nodes further on. A query goes left when its value is <= threshold.
+struct ForestNode {
+    float threshold;
+    int8_t feature;     // AudioFeatures field in FEATURES: order; -1 for a leaf
+    uint8_t label;      // Leaf: label ID the tree votes for
+    uint16_t right;     // Offset from this node to its right child
+};
+
+// A trained forest as emitted by tools/forest_trainer: constexpr arrays
+// that stay in flash, referenced rather than copied
+struct ForestModel {
+    const ForestNode* nodes;
+    const uint32_t* tree_start;     // First node of each tree
+    uint16_t tree_count;
+    const char* const* labels;      // Label ID -> name
+    uint8_t label_count;
+    FeatureMask feature_mask;       // Features the splits read
+};
+
+// Alternative engine behind KNNClassifier (see set_engine). Inference is a
+// fixed walk of tree_count root-to-leaf paths, whatever the training set
+// size, and never allocates.
+class DecisionForest {
+public:
+    DecisionForest() : model(nullptr) {}
+
+    // False, with nothing loaded, if the model has more labels than a
+    // KnnResult can hold
+    bool load(const ForestModel* forest);
+    bool is_loaded() const { return model != nullptr; }
+    const ForestModel* get_model() const { return model; }
+
+    // Each tree votes for one label; scores are the fraction of trees, ties
+    // go to the label the earlier tree voted for
+    int classify(const AudioFeatures& features, KnnResult& result) const;
+
+    const char* get_label_name(int label_id) const;
+    FeatureMask get_feature_mask() const { return model ? model->feature_mask : 0; }
+
+    // Leaf a single tree reaches; exposed for the trainer's self-check
+    static uint8_t evaluate_tree(const ForestNode* root, const float* values);
+
+private:
+    const ForestModel* model;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "DetectionDecoder.h"
+
+DetectionDecoder::DetectionDecoder(float open_at, float close_below, uint32_t onset, uint32_t hold) {
+    configure(open_at, close_below, onset, hold);
+}
+
+void DetectionDecoder::configure(float open_at, float close_below, uint32_t onset, uint32_t hold) {
+    open_level = open_at;
+    close_level = close_below > open_at ? open_at : close_below;
+    onset_ms = onset;
+    hold_ms = hold;
+    active_label = -1;
+    active_start = 0;
+    active_last = 0;
+    active_peak = 0.0f;
+    pending_label = -1;
+    pending_start = 0;
+    pending_last = 0;
+}
+
+size_t DetectionDecoder::update(const KnnResult& result, uint32_t now_ms, DetectionEvent* events) {
+    // Opening, support and the peak all use the winner's confidence, which
+    // is calibrated for k-NN; the runners-up's scores are raw vote shares
+    bool valid = result.label_id >= 0;
+    if (active_label >= 0 && result.label_id == active_label && result.confidence >= close_level) {
+        active_last = now_ms;
+        active_peak = result.confidence > active_peak ? result.confidence : active_peak;
+    }
+
+    // Any other label confident enough builds a run towards onset. A
+    // result that does not continue the run, or a gap longer than the
+    // hold, starts over.
+    int candidate = valid && result.label_id != active_label && result.confidence >= open_level
+                  ? result.label_id : -1;
+    if (candidate < 0) {
+        pending_label = -1;
+    } else if (candidate != pending_label || now_ms - pending_last > hold_ms) {
+        pending_label = candidate;
+        pending_start = now_ms;
+    }
+    pending_last = now_ms;
+
+    size_t count = tick(now_ms, events);
+    if (pending_label >= 0 && now_ms - pending_start >= onset_ms) {
+        if (active_label >= 0) {
+            end_event(events[count++]);
+        }
+        active_label = pending_label;
+        active_start = pending_start;
+        active_last = now_ms;
+        active_peak = result.confidence;
+        pending_label = -1;
+
+        DetectionEvent& event = events[count++];
+        event.type = DETECTION_START;
+        event.label_id = active_label;
+        event.start_ms = active_start;
+        event.end_ms = 0;
+        event.confidence = result.confidence;
+    }
+    return count;
+}
+
+size_t DetectionDecoder::tick(uint32_t now_ms, DetectionEvent* events) {
+    if (active_label >= 0 && now_ms - active_last > hold_ms) {
+        end_event(events[0]);
+        return 1;
+    }
+    return 0;
+}
+
+size_t DetectionDecoder::finish(DetectionEvent* events) {
+    pending_label = -1;
+    if (active_label >= 0) {
+        end_event(events[0]);
+        return 1;
+    }
+    return 0;
+}
+
+void DetectionDecoder::end_event(DetectionEvent& event) {
+    event.type = DETECTION_END;
+    event.label_id = active_label;
+    event.start_ms = active_start;
+    event.end_ms = active_last;
+    event.confidence = active_peak;
+    active_label = -1;
+}
@@ -0,0 +1,97 @@
+#ifndef DETECTION_DECODER_H
+#define DETECTION_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "KnnResult.h"
+
+// A label starts an event once its confidence reaches the open level; the
+// event continues while the label keeps winning with its confidence at or
+// above the close level. An open level of 0 disables the decoder (every
+// result is sent).
+#ifndef DETECTION_OPEN_CONFIDENCE
+#define DETECTION_OPEN_CONFIDENCE 0.6f
+#endif
+#ifndef DETECTION_CLOSE_CONFIDENCE
+#define DETECTION_CLOSE_CONFIDENCE 0.4f
+#endif
+
+// How long a label must keep winning before its event starts (debounce),
+// and how long the event survives without support before it ends. The
+// hold is longer than the 800 ms classification interval so a slower
+// engine does not end an event between two results.
+#ifndef DETECTION_ONSET_MS
+#define DETECTION_ONSET_MS 500
+#endif
+#ifndef DETECTION_HOLD_MS
+#define DETECTION_HOLD_MS 2000
+#endif
+
+// Most events one update() can produce: the end of the current event and
+// the start of the next
+#define DETECTION_MAX_EVENTS 2
+
+enum DetectionEventType {
+    DETECTION_START,
+    DETECTION_END
+};
+
+struct DetectionEvent {
+    DetectionEventType type;
+    int label_id;
+    uint32_t start_ms;      // First result of the run that started the event
+    uint32_t end_ms;        // End: last result that supported it; start: 0
+    float confidence;       // Start: the result's confidence; end: peak confidence
+};
+
+// Turns the stream of per-frame classifications into detection events.
+// Hysteresis on the confidence plus a minimum onset and a hold time, all in
+// milliseconds, so it behaves the same whether results arrive every hop
+// or every feature interval. One event is open at a time.
+class DetectionDecoder {
+public:
+    DetectionDecoder(float open_at = DETECTION_OPEN_CONFIDENCE, float close_below = DETECTION_CLOSE_CONFIDENCE,
+                     uint32_t onset = DETECTION_ONSET_MS, uint32_t hold = DETECTION_HOLD_MS);
+
+    // close_below is clamped to open_at; open_at <= 0 disables the decoder.
+    // Drops any run in progress; end an open event with finish() first.
+    void configure(float open_at, float close_below, uint32_t onset, uint32_t hold);
+    float get_open_level() const { return open_level; }
+    float get_close_level() const { return close_level; }
+    uint32_t get_onset_ms() const { return onset_ms; }
+    uint32_t get_hold_ms() const { return hold_ms; }
+    bool enabled() const { return open_level > 0.0f; }
+
+    // Feed one classification made at now_ms; writes up to
+    // DETECTION_MAX_EVENTS events, in order, and returns how many
+    size_t update(const KnnResult& result, uint32_t now_ms, DetectionEvent* events);
+
+    // Between results: ends the open event once it has had no support for
+    // the hold time. At most one event.
+    size_t tick(uint32_t now_ms, DetectionEvent* events);
+
+    // End the open event now, e.g. before label IDs change. At most one.
+    size_t finish(DetectionEvent* events);
+
+    bool is_active() const { return active_label >= 0; }
+    int get_active_label() const { return active_label; }
+
+private:
+    float open_level;
+    float close_level;
+    uint32_t onset_ms;
+    uint32_t hold_ms;
+
+    int active_label;           // -1 when no event is open
+    uint32_t active_start;
+    uint32_t active_last;       // Last result that supported the event
+    float active_peak;
+
+    int pending_label;          // Label building up towards onset, or -1
+    uint32_t pending_start;
+    uint32_t pending_last;
+
+    void end_event(DetectionEvent& event);
+};
+
+#endif
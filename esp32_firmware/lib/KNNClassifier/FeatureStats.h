@@ -0,0 +1,38 @@
+#ifndef FEATURE_STATS_H
+#define FEATURE_STATS_H
+
+#include <stdint.h>
+#include <math.h>
+#include "AudioProcessor.h"
+
+// Running per-feature mean and variance (Welford), one update per training
+// sample. The state is plain data so it can be saved with the model.
+struct FeatureStats {
+    uint32_t count;
+    float mean[NUM_FEATURES];
+    float m2[NUM_FEATURES];     // Sum of squared deviations from the mean
+
+    void reset() {
+        count = 0;
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            mean[f] = 0.0f;
+            m2[f] = 0.0f;
+        }
+    }
+
+    void add(const float* values) {
+        count++;
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            float delta = values[f] - mean[f];
+            mean[f] += delta / count;
+            m2[f] += delta * (values[f] - mean[f]);
+        }
+    }
+
+    // Sample standard deviation; 0 until two samples are in
+    float std_dev(int f) const {
+        return count > 1 ? sqrtf(m2[f] / (count - 1)) : 0.0f;
+    }
+};
+
+#endif
@@ -0,0 +1,1044 @@
+#include "KNNClassifier.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef ARDUINO
+#include <FS.h>
+#include <SPIFFS.h>
+#endif
+
+// Reference feature statistics from the recordings (see
+// docs/TECHNICAL_DEEP_DIVE.md), used until the training set has its own
+static const float FEATURE_MEAN[NUM_FEATURES] = {
+    0.025f,   // rms
+    1.0f,     // infrasound_energy
+    0.06f,    // low_band_energy
+    0.005f,   // mid_band_energy
+    85.0f,    // spectral_centroid
+    50.0f,    // dominant_frequency
+    0.2f,     // spectral_flux
+    0.25f     // temporal_envelope
+};
+
+static const float FEATURE_STD[NUM_FEATURES] = {
+    0.008f, 0.4f, 0.03f, 0.002f, 15.0f, 25.0f, 0.1f, 0.08f
+};
+
+#if KNN_QUANTIZED
+typedef int32_t DistanceSum;
+
+// int8 code steps per standard deviation
+static const float QUANT_STEPS = 127.0f / KNN_QUANT_RANGE;
+#else
+typedef float DistanceSum;
+#endif
+
+// One feature's squared difference between stored values. Features are
+// already normalized, so no per-feature weight is needed; int8 codes are
+// all the same fraction of a std apart.
+static inline DistanceSum distance_term(FeatureValue a, FeatureValue b) {
+#if KNN_QUANTIZED
+    int32_t d = (int32_t)a - (int32_t)b;
+#else
+    float d = a - b;
+#endif
+    return d * d;
+}
+
+KNNClassifier::KNNClassifier()
+    : feature_mask(FEATURE_MASK_ALL), use_index(KNN_USE_KDTREE), early_abandon(KNN_EARLY_ABANDON),
+      engine(ENGINE_KNN), index_dirty(true), revision(0), held_out(KNN_NO_SAMPLE), active_dims(0),
+      budget(KNN_MEMORY_BUDGET), class_quota(KNN_CLASS_QUOTA), storage_stale(true) {
+    calibration.clear();
+    reset_budget_state();
+    reset_normalization();
+    reset_search_stats();
+    forget_early_rows();
+}
+
+void KNNClassifier::initialize() {
+    clear_samples();
+    reserve_samples(TRAINING_STORE_GROW_STEP);
+    labels.clear();
+    linear.clear();
+    calibration.clear();
+    reset_normalization();
+    feature_mask = FEATURE_MASK_ALL;
+    budget = KNN_MEMORY_BUDGET;
+    class_quota = KNN_CLASS_QUOTA;
+    reset_budget_state();
+    invalidate_storage();
+    samples_changed();
+}
+
+bool KNNClassifier::add_sample(const AudioFeatures& features, const char* label) {
+    int label_id = labels.add(label);
+    if (label_id < 0) {
+        return false;
+    }
+    label_seen[label_id]++;
+
+    float values[NUM_FEATURES];
+    to_array(features, values);
+    running_stats.add(values);
+    float mean[NUM_FEATURES];
+    float inv_std[NUM_FEATURES];
+    if (stats_drifted(mean, inv_std)) {
+        renormalize(mean, inv_std);
+    }
+    uint32_t row = admit((uint8_t)label_id);
+    if (row == label_ids.size()) {
+        if (label_ids.size() == label_ids.capacity()) {
+            reserve_samples(label_ids.size() + TRAINING_STORE_GROW_STEP);
+        }
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            columns[f].push_back(encode(normalize(f, values[f])));
+        }
+        label_ids.push_back((uint8_t)label_id);
+    } else if (row != KNN_NO_SAMPLE) {
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            columns[f][row] = encode(normalize(f, values[f]));
+        }
+        label_ids[row] = (uint8_t)label_id;
+    }
+    if (row != KNN_NO_SAMPLE) {
+        keep_early_row(row, values);
+        mark_unsaved(row);
+        samples_changed();
+    }
+
+    float input[NUM_FEATURES];
+    linear_input(values, input);
+    linear.train(input, (uint8_t)label_id, labels.size());
+    return true;
+}
+
+int KNNClassifier::classify(const AudioFeatures& features, KnnResult& result) {
+    if (engine == ENGINE_FOREST) {
+        return forest.classify(features, result);
+    }
+    if (engine == ENGINE_LINEAR) {
+        if (linear.get_sample_count() < MIN_TRAINING_SAMPLES) {
+            clear_result(KNN_INSUFFICIENT_DATA, result);
+            return result.label_id;
+        }
+        float values[NUM_FEATURES];
+        float input[NUM_FEATURES];
+        to_array(features, values);
+        linear_input(values, input);
+        return linear.classify(input, labels.size(), result);
+    }
+    if (label_ids.size() < MIN_TRAINING_SAMPLES) {
+        clear_result(KNN_INSUFFICIENT_DATA, result);
+        return result.label_id;
+    }
+
+    Neighbor nearest[K_NEIGHBORS];
+    size_t k = find_neighbors(features, nearest);
+    return vote_neighbors(nearest, k, result);
+}
+
+int KNNClassifier::classify_held_out(size_t index, KnnResult& result) {
+    if (index >= label_ids.size() || label_ids.size() <= MIN_TRAINING_SAMPLES) {
+        clear_result(KNN_INSUFFICIENT_DATA, result);
+        return result.label_id;
+    }
+    float normalized[NUM_FEATURES];
+    FeatureValue query[NUM_FEATURES];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        query[f] = columns[f][index];
+        normalized[f] = to_normalized(query[f]);
+    }
+
+    Neighbor nearest[K_NEIGHBORS];
+    held_out = (uint32_t)index;
+    size_t k = search(normalized, query, nearest);
+    held_out = KNN_NO_SAMPLE;
+    return vote_neighbors(nearest, k, result);
+}
+
+// Rejection, vote and calibration for the neighbours of one query
+int KNNClassifier::vote_neighbors(const Neighbor* nearest, size_t k, KnnResult& result) const {
+    if (nearest[0].distance > MAX_CLASSIFICATION_DISTANCE * MAX_CLASSIFICATION_DISTANCE) {
+        clear_result(KNN_REJECTED, result);
+        return result.label_id;
+    }
+
+    vote(nearest, k, label_ids.data(), result);
+    result.confidence = calibration.apply(result.confidence);
+    return result.label_id;
+}
+
+int KNNClassifier::classify_id(const AudioFeatures& features, float& confidence) {
+    KnnResult result;
+    classify(features, result);
+    confidence = result.confidence;
+    return result.label_id;
+}
+
+// Each neighbour votes 1 / (distance + KNN_WEIGHT_EPSILON), so the scores
+// move continuously with the query instead of in steps of 1 / k. Labels
+// are ranked by total weight; walking the neighbours closest first, a tie
+// goes to the label with the nearer neighbour. Distances are squared
+// normalized units in both builds (the int8 build re-ranks in float).
+void KNNClassifier::vote(const Neighbor* nearest, size_t k, const uint8_t* label_of, KnnResult& result) {
+    float votes[MAX_LABELS] = {0};
+    uint8_t ranked[K_NEIGHBORS];    // Distinct labels, nearest neighbour first
+    size_t distinct = 0;
+    float total = 0.0f;
+    for (size_t i = 0; i < k; i++) {
+        uint8_t label_id = label_of[nearest[i].index];
+        float weight = 1.0f / (sqrtf(nearest[i].distance) + KNN_WEIGHT_EPSILON);
+        if (votes[label_id] == 0.0f) {
+            ranked[distinct++] = label_id;
+        }
+        votes[label_id] += weight;
+        total += weight;
+    }
+    rank_votes(votes, ranked, distinct, total, result);
+}
+
+const char* KNNClassifier::get_label_name(int label_id) const {
+    if (label_id == KNN_INSUFFICIENT_DATA) {
+        return "insufficient_data";
+    }
+    if (engine == ENGINE_FOREST) {
+        return forest.get_label_name(label_id);
+    }
+    if (label_id < 0 || label_id >= (int)labels.size()) {
+        return "unknown";
+    }
+    return labels.name(label_id);
+}
+
+bool KNNClassifier::set_engine(ClassifierEngine selected) {
+    if (selected == ENGINE_FOREST && !forest.is_loaded()) {
+        return false;
+    }
+    engine = selected;
+    return true;
+}
+
+bool KNNClassifier::load_linear(const LinearModel* model) {
+    if (!model || model->label_count == 0 || model->label_count > MAX_LABELS) {
+        return false;
+    }
+    // Check every label fits before changing anything
+    size_t missing = 0;
+    for (uint8_t i = 0; i < model->label_count; i++) {
+        size_t length = strlen(model->labels[i]);
+        if (length == 0 || length > KNN_LABEL_LENGTH) {
+            return false;
+        }
+        missing += labels.find(model->labels[i]) < 0;
+    }
+    if (labels.size() + missing > MAX_LABELS) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < model->label_count; i++) {
+        uint8_t label_id = (uint8_t)labels.add(model->labels[i]);
+        linear.set_raw(label_id, model->weights + i * NUM_FEATURES, model->bias[i], norm_mean, norm_inv_std);
+    }
+    linear.restrict_features(feature_mask);
+    linear.set_sample_count(linear.get_sample_count() + model->sample_count);
+    return true;
+}
+
+bool KNNClassifier::set_calibration(const KnnCalibration& table) {
+    if (!table.valid()) {
+        return false;
+    }
+    calibration = table;
+    return true;
+}
+
+FeatureMask KNNClassifier::get_required_features() const {
+    return engine == ENGINE_FOREST ? forest.get_feature_mask() : feature_mask;
+}
+
+size_t KNNClassifier::find_neighbors(const AudioFeatures& features, Neighbor* out) {
+    // Only the query is normalized per call
+    float values[NUM_FEATURES];
+    to_array(features, values);
+    float normalized[NUM_FEATURES];
+    FeatureValue query[NUM_FEATURES];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        normalized[f] = normalize(f, values[f]);
+        query[f] = encode(normalized[f]);
+    }
+    return search(normalized, query, out);
+}
+
+// Search with the configured method, skipping held_out. normalized is the
+// query in float; query is the same in storage units.
+size_t KNNClassifier::search(const float* normalized, const FeatureValue* query, Neighbor* out) {
+    if (index_dirty) {
+        rebuild_index();
+    }
+    search_stats.queries++;
+    SearchHeap heap;
+    if (use_index) {
+        search_subtree(query, 0, index_order.size(), heap);
+    } else if (early_abandon) {
+        search_labels(query, heap);
+    } else {
+        search_linear(query, heap);
+    }
+
+#if KNN_QUANTIZED
+    // Re-rank the integer candidates against the unquantized query, which
+    // removes the query's share of the quantization error
+    Neighbor candidates[KNN_RERANK_CANDIDATES];
+    size_t count = heap.drain_sorted(candidates);
+    KnnHeap best;
+    for (size_t i = 0; i < count; i++) {
+        best.push(rerank_distance(normalized, candidates[i].index), candidates[i].index);
+    }
+    return best.drain_sorted(out);
+#else
+    (void)normalized;
+    return heap.drain_sorted(out);
+#endif
+}
+
+// Anything that changes what the stored rows mean: the index has to be
+// rebuilt, and passes over the old rows are stale
+void KNNClassifier::samples_changed() {
+    index_dirty = true;
+    revision++;
+}
+
+// Row to write in place at the next save; past KNN_MAX_UNSAVED_ROWS a
+// rewrite is cheaper than the seeks
+void KNNClassifier::mark_unsaved(uint32_t row) {
+    if (storage_stale) {
+        return;
+    }
+    for (size_t i = 0; i < unsaved_rows.size(); i++) {
+        if (unsaved_rows[i] == row) {
+            return;
+        }
+    }
+    if (unsaved_rows.size() == KNN_MAX_UNSAVED_ROWS) {
+        invalidate_storage();
+        return;
+    }
+    unsaved_rows.push_back(row);
+}
+
+// Rows were rescaled, removed or reordered: the next save writes them all
+void KNNClassifier::invalidate_storage() {
+    storage_stale = true;
+    std::vector<uint32_t>().swap(unsaved_rows);
+}
+
+void KNNClassifier::reset_search_stats() {
+    search_stats.queries = 0;
+    search_stats.candidates = 0;
+    search_stats.dims_evaluated = 0;
+    search_stats.labels_skipped = 0;
+}
+
+void KNNClassifier::clear_data() {
+    clear_samples();
+    labels.clear();
+    linear.clear();
+    calibration.clear();
+    reset_normalization();
+    reset_budget_state();
+    invalidate_storage();
+    samples_changed();
+}
+
+void KNNClassifier::get_sample_features(size_t index, float* out) const {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        out[f] = to_normalized(columns[f][index]) / norm_inv_std[f] + norm_mean[f];
+    }
+}
+
+void KNNClassifier::set_feature_mask(FeatureMask mask) {
+    feature_mask = mask;
+    // Split dimensions are chosen among the masked features
+    samples_changed();
+    linear.restrict_features(mask);
+}
+
+void KNNClassifier::to_array(const AudioFeatures& features, float* out) {
+    out[0] = features.rms;
+    out[1] = features.infrasound_energy;
+    out[2] = features.low_band_energy;
+    out[3] = features.mid_band_energy;
+    out[4] = features.spectral_centroid;
+    out[5] = features.dominant_frequency;
+    out[6] = features.spectral_flux;
+    out[7] = features.temporal_envelope;
+}
+
+// Normalized features with the ones outside the mask fed as 0, so their
+// weights get no gradient and their (unextracted) values never count
+void KNNClassifier::linear_input(const float* values, float* out) const {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        out[f] = (feature_mask & (1 << f)) ? normalize(f, values[f]) : 0.0f;
+    }
+}
+
+void KNNClassifier::get_normalization(float* mean, float* std_dev) const {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        mean[f] = norm_mean[f];
+        std_dev[f] = 1.0f / norm_inv_std[f];
+    }
+}
+
+void KNNClassifier::reset_normalization() {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        norm_mean[f] = FEATURE_MEAN[f];
+        norm_inv_std[f] = 1.0f / FEATURE_STD[f];
+    }
+    running_stats.reset();
+    renormalizations = 0;
+}
+
+// True once the running statistics have moved far enough from the model
+// statistics; mean and inv_std receive the statistics to switch to
+bool KNNClassifier::stats_drifted(float* mean, float* inv_std) const {
+    if (running_stats.count < KNN_STATS_MIN_SAMPLES) {
+        return false;
+    }
+    bool drifted = false;
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        float floor = FEATURE_STD[f] * KNN_STD_FLOOR;
+        float std_dev = running_stats.std_dev(f);
+        std_dev = std_dev > floor ? std_dev : floor;
+        mean[f] = running_stats.mean[f];
+        inv_std[f] = 1.0f / std_dev;
+
+        float model_std = 1.0f / norm_inv_std[f];
+        if (fabsf(mean[f] - norm_mean[f]) > KNN_RENORMALIZE_DRIFT * model_std ||
+            fabsf(std_dev - model_std) > KNN_RENORMALIZE_DRIFT * model_std) {
+            drifted = true;
+        }
+    }
+    return drifted;
+}
+
+// One pass over the store: map every value from the old normalization to
+// the new one. In the int8 build this re-rounds the codes, so passes are
+// kept rare by the drift threshold, and rows still in early_rows are
+// encoded from their raw values. The linear weights are rebased to the
+// new statistics exactly.
+void KNNClassifier::renormalize(const float* mean, const float* inv_std) {
+    linear.rebase(norm_mean, norm_inv_std, mean, inv_std);
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        float scale = inv_std[f] / norm_inv_std[f];
+        float offset = (norm_mean[f] - mean[f]) * inv_std[f];
+        FeatureValue* column = columns[f].data();
+        for (size_t i = 0; i < columns[f].size(); i++) {
+            column[i] = encode(to_normalized(column[i]) * scale + offset);
+        }
+        norm_mean[f] = mean[f];
+        norm_inv_std[f] = inv_std[f];
+    }
+#if KNN_QUANTIZED
+    for (size_t i = 0; i < early_rows.size(); i++) {
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            columns[f][early_rows[i]] = encode(normalize(f, early_values[i * NUM_FEATURES + f]));
+        }
+    }
+#endif
+    renormalizations++;
+    invalidate_storage();
+    samples_changed();
+}
+
+// Records a written row's raw values during the first KNN_FLOAT_ROWS
+// samples and drops the copy after them. A row written again (reservoir
+// replacement) keeps its entry.
+void KNNClassifier::keep_early_row(uint32_t row, const float* values) {
+#if KNN_QUANTIZED
+    if (running_stats.count > KNN_FLOAT_ROWS) {
+        forget_early_rows();
+        return;
+    }
+    if (early_rows.empty()) {
+        early_rows.reserve(KNN_FLOAT_ROWS);
+        early_values.reserve(KNN_FLOAT_ROWS * NUM_FEATURES);
+    }
+    size_t i = std::find(early_rows.begin(), early_rows.end(), row) - early_rows.begin();
+    if (i == early_rows.size()) {
+        early_rows.push_back(row);
+        early_values.resize(early_values.size() + NUM_FEATURES);
+    }
+    memcpy(&early_values[i * NUM_FEATURES], values, NUM_FEATURES * sizeof(float));
+#else
+    (void)row;
+    (void)values;
+#endif
+}
+
+// Also called whenever rows are cleared or moved
+void KNNClassifier::forget_early_rows() {
+#if KNN_QUANTIZED
+    std::vector<uint32_t>().swap(early_rows);
+    std::vector<float>().swap(early_values);
+#endif
+}
+
+float KNNClassifier::normalize(int feature, float value) const {
+    return (value - norm_mean[feature]) * norm_inv_std[feature];
+}
+
+FeatureValue KNNClassifier::encode(float normalized) {
+#if KNN_QUANTIZED
+    int32_t code = (int32_t)lroundf(normalized * QUANT_STEPS);
+    return (FeatureValue)(code < -128 ? -128 : (code > 127 ? 127 : code));
+#else
+    return normalized;
+#endif
+}
+
+float KNNClassifier::to_normalized(FeatureValue stored) {
+#if KNN_QUANTIZED
+    return stored * (1.0f / QUANT_STEPS);
+#else
+    return stored;
+#endif
+}
+
+// Squared distance over the masked features, in search units (see
+// distance_term). Squared so that equal-looking distances are never merged
+// by a rounding sqrt, which keeps tie order identical between the linear
+// scan and the KD-tree. search_linear() computes the same sum column by
+// column; keep the two in step or they stop agreeing on ties.
+//
+// Terms are added in dim_order and the sum stops as soon as it exceeds
+// limit. Every term is non-negative and float rounding is monotonic, so a
+// partial sum over the limit means the full distance is too; the partial
+// sum is returned, and the heap rejects it like the full one.
+float KNNClassifier::distance(const FeatureValue* query, uint32_t index, float limit) {
+    DistanceSum sum = 0;
+    size_t d = 0;
+    while (d + 1 < active_dims) {
+        int f = dim_order[d];
+        int g = dim_order[d + 1];
+        sum += distance_term(query[f], columns[f][index]);
+        sum += distance_term(query[g], columns[g][index]);
+        d += 2;
+        if ((float)sum > limit) {
+            break;
+        }
+    }
+    if (d + 1 == active_dims && (float)sum <= limit) {
+        int f = dim_order[d++];
+        sum += distance_term(query[f], columns[f][index]);
+    }
+    search_stats.candidates++;
+    search_stats.dims_evaluated += d;
+    return (float)sum;
+}
+
+// Distance beyond which a candidate cannot enter the heap
+float KNNClassifier::abandon_limit(const SearchHeap& heap) const {
+    return early_abandon && heap.full() ? heap.worst().distance : INFINITY;
+}
+
+// Float distance from the normalized, unquantized query to a sample
+float KNNClassifier::rerank_distance(const float* query, uint32_t index) const {
+    float sum = 0.0f;
+    for (int i = 0; i < NUM_FEATURES; i++) {
+        if (feature_mask & (1 << i)) {
+            float d = query[i] - to_normalized(columns[i][index]);
+            sum += d * d;
+        }
+    }
+    return sum;
+}
+
+void KNNClassifier::reserve_samples(size_t count) {
+    if (count > budget) {
+        count = budget;
+    }
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        columns[f].reserve(count);
+    }
+    label_ids.reserve(count);
+}
+
+void KNNClassifier::clear_samples() {
+    // Release the memory too; clear() alone keeps the capacity
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        std::vector<FeatureValue>().swap(columns[f]);
+    }
+    std::vector<uint8_t>().swap(label_ids);
+    forget_early_rows();
+}
+
+// Adds one feature's squared term for n consecutive samples
+static inline void accumulate_column(const FeatureValue* column, FeatureValue q, DistanceSum* sums, size_t n) {
+    for (size_t j = 0; j < n; j++) {
+        sums[j] += distance_term(q, column[j]);
+    }
+}
+
+// Column-major scan: distances for a block of samples are accumulated one
+// feature at a time, so each inner loop streams one contiguous column.
+// Full blocks use a constant trip count, which the compiler vectorizes.
+void KNNClassifier::search_linear(const FeatureValue* query, SearchHeap& heap) {
+    static const size_t BLOCK = 64;
+    DistanceSum sums[BLOCK];
+    size_t count = label_ids.size();
+
+    for (size_t start = 0; start < count; start += BLOCK) {
+        size_t n = count - start < BLOCK ? count - start : BLOCK;
+        for (size_t j = 0; j < BLOCK; j++) {
+            sums[j] = 0;
+        }
+        for (size_t d = 0; d < active_dims; d++) {
+            int f = dim_order[d];
+            const FeatureValue* column = columns[f].data() + start;
+            if (n == BLOCK) {
+                accumulate_column(column, query[f], sums, BLOCK);
+            } else {
+                accumulate_column(column, query[f], sums, n);
+            }
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (start + j != held_out) {
+                heap.push((float)sums[j], (uint32_t)(start + j));
+            }
+        }
+    }
+    search_stats.candidates += count;
+    search_stats.dims_evaluated += count * active_dims;
+}
+
+// Linear scan one label at a time, nearest bounding box first. The box
+// bound sums the same terms as distance() with each sample value replaced
+// by the box point closest to the query, so it never exceeds the distance
+// to any member; once it passes the k-th best, so do all later labels.
+void KNNClassifier::search_labels(const FeatureValue* query, SearchHeap& heap) {
+    float bound[MAX_LABELS];
+    uint8_t order[MAX_LABELS];
+    size_t count = 0;
+    for (size_t label = 0; label < labels.size(); label++) {
+        if (label_start[label] == label_start[label + 1]) {
+            continue;
+        }
+        DistanceSum sum = 0;
+        for (size_t d = 0; d < active_dims; d++) {
+            int f = dim_order[d];
+            FeatureValue q = query[f];
+            FeatureValue nearest = q < label_low[label][f] ? label_low[label][f]
+                                 : (q > label_high[label][f] ? label_high[label][f] : q);
+            sum += distance_term(q, nearest);
+        }
+        // Insertion sort; there are at most MAX_LABELS
+        size_t pos = count++;
+        while (pos > 0 && bound[pos - 1] > (float)sum) {
+            bound[pos] = bound[pos - 1];
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        bound[pos] = (float)sum;
+        order[pos] = (uint8_t)label;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (heap.full() && bound[i] > heap.worst().distance) {
+            search_stats.labels_skipped += count - i;
+            break;
+        }
+        const uint32_t* members = label_members.data() + label_start[order[i]];
+        size_t n = label_start[order[i] + 1] - label_start[order[i]];
+        for (size_t j = 0; j < n; j++) {
+            if (members[j] != held_out) {
+                heap.push(distance(query, members[j], abandon_limit(heap)), members[j]);
+            }
+        }
+    }
+}
+
+void KNNClassifier::search_subtree(const FeatureValue* query, size_t lo, size_t hi, SearchHeap& heap) {
+    if (lo >= hi) {
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    uint32_t index = index_order[mid];
+    if (index != held_out) {
+        heap.push(distance(query, index, INFINITY), index);
+    }
+    if (hi - lo == 1) {
+        return;
+    }
+
+    // Any point across the split is at least this far along one masked
+    // dimension. The term is computed exactly as in distance(), and float
+    // rounding is monotonic, so the bound never exceeds a true distance.
+    int dim = index_split_dim[mid];
+    FeatureValue split = columns[dim][index];
+    float bound = (float)distance_term(query[dim], split);
+    bool go_left = query[dim] < split;
+
+    if (go_left) {
+        search_subtree(query, lo, mid, heap);
+    } else {
+        search_subtree(query, mid + 1, hi, heap);
+    }
+    // Equal bounds are still searched: a tie with a lower index wins
+    if (!heap.full() || bound <= heap.worst().distance) {
+        if (go_left) {
+            search_subtree(query, mid + 1, hi, heap);
+        } else {
+            search_subtree(query, lo, mid, heap);
+        }
+    }
+}
+
+void KNNClassifier::rebuild_index() {
+    index_order.resize(label_ids.size());
+    index_split_dim.resize(label_ids.size());
+    for (size_t i = 0; i < index_order.size(); i++) {
+        index_order[i] = (uint32_t)i;
+    }
+    build_subtree(0, index_order.size());
+    build_search_order();
+    if (early_abandon) {
+        build_label_groups();
+    } else {
+        std::vector<uint32_t>().swap(label_members);
+    }
+    index_dirty = false;
+}
+
+// The label groups are only built while they are used; switching either
+// way rebuilds the index, which builds or releases them
+void KNNClassifier::set_early_abandon(bool enabled) {
+    if (enabled != early_abandon) {
+        early_abandon = enabled;
+        index_dirty = true;
+    }
+}
+
+// Dimension order for the current samples, shared by every search mode
+void KNNClassifier::build_search_order() {
+    size_t count = label_ids.size();
+    size_t label_count = labels.size();
+    uint32_t members[MAX_LABELS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        members[label_ids[i]]++;
+    }
+
+    // Between-label variance of each masked feature: how far the label
+    // means sit from the overall mean, weighted by label size
+    float score[NUM_FEATURES];
+    active_dims = 0;
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        if (!(feature_mask & (1 << f))) {
+            continue;
+        }
+        float sums[MAX_LABELS] = {0};
+        float total = 0.0f;
+        const FeatureValue* column = columns[f].data();
+        for (size_t i = 0; i < count; i++) {
+            float v = to_normalized(column[i]);
+            sums[label_ids[i]] += v;
+            total += v;
+        }
+        float mean = count ? total / count : 0.0f;
+        float between = 0.0f;
+        for (size_t label = 0; label < label_count; label++) {
+            if (members[label]) {
+                float d = sums[label] / members[label] - mean;
+                between += members[label] * d * d;
+            }
+        }
+        score[f] = between;
+
+        // Insertion sort, highest score first; ties keep feature order
+        size_t pos = active_dims++;
+        while (pos > 0 && score[dim_order[pos - 1]] < between) {
+            dim_order[pos] = dim_order[pos - 1];
+            pos--;
+        }
+        dim_order[pos] = (uint8_t)f;
+    }
+}
+
+// Label groups and label boxes for search_labels()
+void KNNClassifier::build_label_groups() {
+    size_t count = label_ids.size();
+    size_t label_count = labels.size();
+    uint32_t members[MAX_LABELS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        members[label_ids[i]]++;
+    }
+
+    // Counting sort by label; members stay in index order within a label
+    label_start[0] = 0;
+    for (size_t label = 0; label < MAX_LABELS; label++) {
+        label_start[label + 1] = label_start[label] + (label < label_count ? members[label] : 0);
+    }
+    label_members.resize(count);
+    uint32_t next[MAX_LABELS];
+    for (size_t label = 0; label < MAX_LABELS; label++) {
+        next[label] = label_start[label];
+    }
+    for (size_t i = 0; i < count; i++) {
+        label_members[next[label_ids[i]]++] = (uint32_t)i;
+    }
+
+    for (size_t label = 0; label < label_count; label++) {
+        if (!members[label]) {
+            continue;
+        }
+        uint32_t first = label_members[label_start[label]];
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            const FeatureValue* column = columns[f].data();
+            FeatureValue low = column[first];
+            FeatureValue high = low;
+            for (uint32_t m = label_start[label] + 1; m < label_start[label + 1]; m++) {
+                FeatureValue v = column[label_members[m]];
+                low = v < low ? v : low;
+                high = v > high ? v : high;
+            }
+            label_low[label][f] = low;
+            label_high[label][f] = high;
+        }
+    }
+}
+
+void KNNClassifier::build_subtree(size_t lo, size_t hi) {
+    if (hi - lo <= 1) {
+        if (hi > lo) {
+            index_split_dim[lo] = 0;
+        }
+        return;
+    }
+
+    // Split on the masked dimension with the widest normalized spread
+    int dim = 0;
+    float widest = -1.0f;
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        if (!(feature_mask & (1 << f))) {
+            continue;
+        }
+        const FeatureValue* column = columns[f].data();
+        FeatureValue low = column[index_order[lo]];
+        FeatureValue high = low;
+        for (size_t i = lo + 1; i < hi; i++) {
+            FeatureValue v = column[index_order[i]];
+            low = v < low ? v : low;
+            high = v > high ? v : high;
+        }
+        float spread = (float)distance_term(high, low);
+        if (spread > widest) {
+            widest = spread;
+            dim = f;
+        }
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    const FeatureValue* column = columns[dim].data();
+    std::nth_element(index_order.begin() + lo, index_order.begin() + mid, index_order.begin() + hi,
+                     [column](uint32_t a, uint32_t b) {
+                         return column[a] < column[b];
+                     });
+    index_split_dim[mid] = (uint8_t)dim;
+
+    build_subtree(lo, mid);
+    build_subtree(mid + 1, hi);
+}
+
+#ifdef ARDUINO
+
+static const char* STORAGE_PATH = "/training_data.bin";
+// Quantized and float builds store different column types
+#if KNN_QUANTIZED
+static const uint32_t STORAGE_MAGIC = 0x38514E4B;  // "KNQ8"
+#else
+static const uint32_t STORAGE_MAGIC = 0x374E4E4B;  // "KNN7"
+#endif
+
+// Layout: a fixed-size header, then one fixed-size record per sample
+// (normalized features, then the label ID) in store order. A sample that
+// is added or replaced is saved by rewriting the header and its record in
+// place; only rescaling or removing rows rewrites the file.
+struct StorageHeader {
+    uint32_t magic;
+    FeatureMask feature_mask;
+    float norm_mean[NUM_FEATURES];
+    float norm_inv_std[NUM_FEATURES];
+    FeatureStats running_stats;
+    uint8_t label_count;
+    char labels[MAX_LABELS][KNN_LABEL_LENGTH + 1];
+    uint32_t budget;
+    uint32_t class_quota;
+    uint32_t label_seen[MAX_LABELS];
+    uint32_t reservoir_state;
+    LinearState linear;
+    KnnCalibration calibration;
+    uint32_t count;
+};
+
+static const size_t STORAGE_RECORD_SIZE = NUM_FEATURES * sizeof(FeatureValue) + 1;
+
+// Records written per file call on a full rewrite or load
+static const size_t STORAGE_RECORD_BATCH = 32;
+
+// Static, to keep their 3 KB off the loop task's stack
+static StorageHeader storage_header;
+static uint8_t storage_records[STORAGE_RECORD_BATCH * STORAGE_RECORD_SIZE];
+
+bool KNNClassifier::save_to_storage() {
+    if (!storage_stale && !SPIFFS.exists(STORAGE_PATH)) {
+        invalidate_storage();
+    }
+    File file = SPIFFS.open(STORAGE_PATH, storage_stale ? FILE_WRITE : "r+");
+    if (!file) {
+        return false;
+    }
+
+    StorageHeader& header = storage_header;
+    memset(&header, 0, sizeof(header));
+    header.magic = STORAGE_MAGIC;
+    header.feature_mask = feature_mask;
+    memcpy(header.norm_mean, norm_mean, sizeof(norm_mean));
+    memcpy(header.norm_inv_std, norm_inv_std, sizeof(norm_inv_std));
+    header.running_stats = running_stats;
+    header.label_count = labels.size();
+    for (size_t i = 0; i < labels.size(); i++) {
+        strncpy(header.labels[i], labels.name(i), KNN_LABEL_LENGTH);
+    }
+    header.budget = budget;
+    header.class_quota = class_quota;
+    memcpy(header.label_seen, label_seen, sizeof(label_seen));
+    header.reservoir_state = reservoir_state;
+    header.linear = linear.get_state();
+    header.calibration = calibration;
+    header.count = label_ids.size();
+    bool complete = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+    uint8_t* records = storage_records;
+    if (storage_stale) {
+        for (size_t start = 0; start < label_ids.size() && complete; start += STORAGE_RECORD_BATCH) {
+            size_t n = label_ids.size() - start < STORAGE_RECORD_BATCH ? label_ids.size() - start
+                                                                       : STORAGE_RECORD_BATCH;
+            for (size_t i = 0; i < n; i++) {
+                get_record(start + i, records + i * STORAGE_RECORD_SIZE);
+            }
+            complete = file.write(records, n * STORAGE_RECORD_SIZE) == n * STORAGE_RECORD_SIZE;
+        }
+    } else {
+        // Ascending, so an appended record is never written past the end
+        std::sort(unsaved_rows.begin(), unsaved_rows.end());
+        for (size_t i = 0; i < unsaved_rows.size() && complete; i++) {
+            uint32_t row = unsaved_rows[i];
+            get_record(row, records);
+            complete = file.seek(sizeof(header) + row * STORAGE_RECORD_SIZE) &&
+                       file.write(records, STORAGE_RECORD_SIZE) == STORAGE_RECORD_SIZE;
+        }
+    }
+    file.close();
+
+    // A partial write leaves the file unknown; write all of it next time
+    if (complete) {
+        storage_stale = false;
+        unsaved_rows.clear();
+    } else {
+        invalidate_storage();
+    }
+    return complete;
+}
+
+bool KNNClassifier::load_from_storage() {
+    File file = SPIFFS.open(STORAGE_PATH, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    StorageHeader& header = storage_header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != STORAGE_MAGIC ||
+        header.label_count > MAX_LABELS || header.budget < MIN_TRAINING_SAMPLES ||
+        header.budget > MAX_TRAINING_SAMPLES || header.count > header.budget || !header.calibration.valid()) {
+        file.close();
+        return false;
+    }
+
+    labels.clear();
+    for (uint8_t i = 0; i < header.label_count; i++) {
+        header.labels[i][KNN_LABEL_LENGTH] = '\0';
+        if (labels.add(header.labels[i]) != i) {
+            file.close();
+            labels.clear();
+            return false;
+        }
+    }
+
+    clear_samples();
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        columns[f].resize(header.count);
+    }
+    label_ids.resize(header.count);
+    bool complete = true;
+    uint8_t* records = storage_records;
+    for (size_t start = 0; start < header.count && complete; start += STORAGE_RECORD_BATCH) {
+        size_t n = header.count - start < STORAGE_RECORD_BATCH ? header.count - start : STORAGE_RECORD_BATCH;
+        complete = file.read(records, n * STORAGE_RECORD_SIZE) == n * STORAGE_RECORD_SIZE;
+        for (size_t i = 0; i < n && complete; i++) {
+            complete = set_record(start + i, records + i * STORAGE_RECORD_SIZE, header.label_count);
+        }
+    }
+    file.close();
+    if (!complete) {
+        clear_samples();
+        labels.clear();
+        return false;
+    }
+
+    feature_mask = header.feature_mask;
+    memcpy(norm_mean, header.norm_mean, sizeof(norm_mean));
+    memcpy(norm_inv_std, header.norm_inv_std, sizeof(norm_inv_std));
+    running_stats = header.running_stats;
+    renormalizations = 0;
+    budget = header.budget;
+    class_quota = header.class_quota;
+    memcpy(label_seen, header.label_seen, sizeof(label_seen));
+    reservoir_state = header.reservoir_state;
+    linear.set_state(header.linear);
+    calibration = header.calibration;
+    samples_changed();
+    rebuild_index();
+    storage_stale = false;
+    unsaved_rows.clear();
+    return true;
+}
+
+// One sample as a storage record
+void KNNClassifier::get_record(size_t row, uint8_t* record) const {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        memcpy(record + f * sizeof(FeatureValue), &columns[f][row], sizeof(FeatureValue));
+    }
+    record[NUM_FEATURES * sizeof(FeatureValue)] = label_ids[row];
+}
+
+// False if the record's label ID is not below label_count
+bool KNNClassifier::set_record(size_t row, const uint8_t* record, uint8_t label_count) {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        memcpy(&columns[f][row], record + f * sizeof(FeatureValue), sizeof(FeatureValue));
+    }
+    label_ids[row] = record[NUM_FEATURES * sizeof(FeatureValue)];
+    return label_ids[row] < label_count;
+}
+
+#else
+
+bool KNNClassifier::save_to_storage() {
+    return false;
+}
+
+bool KNNClassifier::load_from_storage() {
+    return false;
+}
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef KNN_CLASSIFIER_H
+#define KNN_CLASSIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "AudioProcessor.h"
+#include "NeighborHeap.h"
+#include "FeatureStats.h"
+#include "LabelDictionary.h"
+#include "KnnResult.h"
+#include "KnnCalibration.h"
+#include "DecisionForest.h"
+#include "LinearClassifier.h"
+#include "PrototypeReduction.h"
+
+#define K_NEIGHBORS 5
+#define MIN_TRAINING_SAMPLES 10
+
+// 33 bytes per sample in the column store plus 5 for the KD-tree index,
+// and 4 more for the label groups while early abandon is on
+#ifndef MAX_TRAINING_SAMPLES
+#define MAX_TRAINING_SAMPLES 3000
+#endif
+
+// Training store budget in samples (at most MAX_TRAINING_SAMPLES), and
+// the most samples kept per label: 0 shares the budget evenly among the
+// labels so far. Runtime: set_memory_budget().
+#ifndef KNN_MEMORY_BUDGET
+#define KNN_MEMORY_BUDGET MAX_TRAINING_SAMPLES
+#endif
+#ifndef KNN_CLASS_QUOTA
+#define KNN_CLASS_QUOTA 0
+#endif
+#if KNN_MEMORY_BUDGET > MAX_TRAINING_SAMPLES
+#error "KNN_MEMORY_BUDGET cannot exceed MAX_TRAINING_SAMPLES"
+#endif
+
+// Changed samples saved in place, each as one record, before
+// save_to_storage() rewrites the whole file instead
+#ifndef KNN_MAX_UNSAVED_ROWS
+#define KNN_MAX_UNSAVED_ROWS 64
+#endif
+
+// Samples the columns grow by, so capacity tracks the count instead of
+// doubling past it
+#ifndef TRAINING_STORE_GROW_STEP
+#define TRAINING_STORE_GROW_STEP 128
+#endif
+
+// Search the KD-tree index instead of scanning every sample (runtime
+// switch: set_use_index). Both give identical neighbours.
+#ifndef KNN_USE_KDTREE
+#define KNN_USE_KDTREE 1
+#endif
+
+// Samples are stored normalized, (value - mean) / std, with statistics kept
+// alongside the model. Until this many samples are in, the documented
+// reference statistics are used.
+#ifndef KNN_STATS_MIN_SAMPLES
+#define KNN_STATS_MIN_SAMPLES 30
+#endif
+
+// The stored samples are renormalized in one pass once the running mean
+// has moved by more than this many model stds, or the running std differs
+// from the model std by more than this fraction
+#ifndef KNN_RENORMALIZE_DRIFT
+#define KNN_RENORMALIZE_DRIFT 0.25f
+#endif
+
+// Lower bound on a feature's std, as a fraction of its documented std, so
+// a constant (e.g. masked) feature cannot blow up the scale
+#ifndef KNN_STD_FLOOR
+#define KNN_STD_FLOOR 0.05f
+#endif
+
+// Store training features as per-feature affine int8 codes (a quarter of
+// the float column memory) and search with integer distances. The best
+// KNN_RERANK_CANDIDATES are then re-ranked by float distance to the
+// unquantized query.
+#ifndef KNN_QUANTIZED
+#define KNN_QUANTIZED 0
+#endif
+
+// int8 codes span the model mean +- this many standard deviations. The
+// model statistics follow the training data (see KNN_FLOAT_ROWS), so the
+// range only has to cover that data's own tails.
+#ifndef KNN_QUANT_RANGE
+#define KNN_QUANT_RANGE 5.0f
+#endif
+
+#ifndef KNN_RERANK_CANDIDATES
+#define KNN_RERANK_CANDIDATES (2 * K_NEIGHBORS)
+#endif
+
+// Rows written during the first this many samples also keep their raw
+// values in float until then. Their codes start on the reference
+// statistics, which can clip them, and each renormalization while the
+// statistics settle would re-round them again; those passes encode them
+// from the raw values instead. The float copy lives only while the store
+// is this small.
+#ifndef KNN_FLOAT_ROWS
+#define KNN_FLOAT_ROWS 256
+#endif
+
+// Linear scans go label by label, skip whole labels whose bounding box is
+// out of reach and stop summing a distance once it passes the current k-th
+// best (runtime switch: set_early_abandon). The KD-tree, which already
+// prunes spatially, is unaffected. Neighbours are identical either way.
+// Off by default: slower on the host, where the full block scan
+// vectorizes, and not yet measured on the ESP32.
+#ifndef KNN_EARLY_ABANDON
+#define KNN_EARLY_ABANDON 0
+#endif
+
+#if KNN_QUANTIZED
+typedef int8_t FeatureValue;
+#else
+typedef float FeatureValue;
+#endif
+
+// Build the firmware with the forest generated by tools/forest_trainer
+// (ForestModel.h in this library) and start with it as the engine
+#ifndef CLASSIFIER_FOREST
+#define CLASSIFIER_FOREST 0
+#endif
+
+// Build the firmware with the weights generated by tools/linear_trainer
+// (LinearWeights.h in this library) and start with the linear engine
+#ifndef CLASSIFIER_LINEAR
+#define CLASSIFIER_LINEAR 0
+#endif
+
+// Nearest neighbour further than this (in normalized units) is rejected
+#define MAX_CLASSIFICATION_DISTANCE 10.0f
+
+// Neighbours vote with weight 1 / (distance + this), in normalized units,
+// so an exact match does not take the whole vote
+#ifndef KNN_WEIGHT_EPSILON
+#define KNN_WEIGHT_EPSILON 0.1f
+#endif
+
+// Sample index meaning "none"
+#define KNN_NO_SAMPLE 0xFFFFFFFFUL
+
+// What add_sample() did with the sample
+enum SampleAdmission {
+    SAMPLE_APPENDED,
+    SAMPLE_REPLACED,        // Took the place of an evicted sample
+    SAMPLE_DISCARDED        // Not stored; the linear engine still learned from it
+};
+
+// What classify() runs: k-NN over the training set, a loaded forest, or
+// the linear model trained alongside the samples
+enum ClassifierEngine {
+    ENGINE_KNN,
+    ENGINE_FOREST,
+    ENGINE_LINEAR
+};
+
+// Work done by find_neighbors() since the last reset. dims_evaluated /
+// candidates is the average number of dimensions summed per candidate.
+struct KnnSearchStats {
+    uint32_t queries;
+    uint32_t candidates;        // Samples a distance was started for
+    uint32_t dims_evaluated;
+    uint32_t labels_skipped;    // Labels ruled out by their bounding box
+};
+
+class KNNClassifier {
+public:
+    KNNClassifier();
+
+    void initialize();
+
+    // Store a labelled sample and make one SGD step of the linear engine
+    // on it. Past the memory budget or the label's quota the sample may
+    // replace an older one or be dropped (see set_memory_budget), so
+    // training never stops. False only once MAX_LABELS is reached or if
+    // the label is empty or longer than KNN_LABEL_LENGTH.
+    bool add_sample(const AudioFeatures& features, const char* label);
+    SampleAdmission get_last_admission() const { return last_admission; }
+
+    // At most samples are kept, and at most per_class of each label (0: an
+    // even share among the labels so far). A full label keeps a uniform
+    // reservoir sample of everything it was given; a label under quota
+    // evicts a random sample of the label furthest over its own. A smaller
+    // budget evicts at once. False, with nothing changed, unless
+    // MIN_TRAINING_SAMPLES <= samples <= MAX_TRAINING_SAMPLES.
+    bool set_memory_budget(size_t samples, size_t per_class);
+    size_t get_memory_budget() const { return budget; }
+    size_t get_class_quota() const { return class_quota; }
+    // Samples each label may keep: the class quota, or the budget shared
+    // among the labels so far; at least 1
+    size_t get_label_quota() const;
+    // Samples ever given for a label, kept or not
+    uint32_t get_label_seen(uint8_t label_id) const { return label_seen[label_id]; }
+
+    // Inverse-distance weighted vote of the K_NEIGHBORS nearest samples (or
+    // the forest's trees, or the linear engine's softmax; see set_engine),
+    // with every label's score and the best KNN_TOP_LABELS. For k-NN the
+    // confidence is the winner's share mapped through the calibration
+    // table. Returns result.label_id. Never allocates once the index is
+    // built.
+    int classify(const AudioFeatures& features, KnnResult& result);
+
+    // classify() reduced to the label ID and its confidence
+    int classify_id(const AudioFeatures& features, float& confidence);
+
+    // Leave-one-out k-NN: classify stored sample index by all the other
+    // samples, with the configured search, whatever the active engine. The
+    // query is the stored row, so nothing is normalized. See
+    // CrossValidation.
+    int classify_held_out(size_t index, KnnResult& result);
+
+    // Label for a classify() result of the active engine, including the
+    // special results
+    const char* get_label_name(int label_id) const;
+    size_t get_label_count() const { return labels.size(); }
+    const LabelDictionary& get_labels() const { return labels; }
+
+    // The up to K_NEIGHBORS nearest samples, closest first; returns the count
+    size_t find_neighbors(const AudioFeatures& features, Neighbor* out);
+
+    void clear_data();
+    size_t get_sample_count() const { return label_ids.size(); }
+    // Changes whenever the stored samples or their scaling do, so a pass
+    // spread over many calls can tell its results have gone stale
+    uint32_t get_revision() const { return revision; }
+    void get_sample_features(size_t index, float* out) const;
+    uint8_t get_sample_label(size_t index) const { return label_ids[index]; }
+    const char* get_sample_label_name(size_t index) const { return labels.name(label_ids[index]); }
+
+    // Persist to / restore from SPIFFS (no-ops returning false off-device).
+    // Saving writes only the header and the samples added or replaced
+    // since the last save, unless the rows were rescaled, removed or too
+    // many changed.
+    bool save_to_storage();
+    bool load_from_storage();
+
+    // Features the distance uses. Saved with the training data so the
+    // AudioProcessor can be told to skip the rest.
+    void set_feature_mask(FeatureMask mask);
+    FeatureMask get_feature_mask() const { return feature_mask; }
+
+    // KD-tree search on/off. The index (tree, dimension order and label
+    // boxes) is rebuilt lazily after changes.
+    void set_use_index(bool enabled) { use_index = enabled; }
+    bool get_use_index() const { return use_index; }
+    void rebuild_index();
+
+    // Forest engine. The model is referenced, not copied, and keeps its own
+    // labels; training samples are still stored and saved as before.
+    // set_engine(ENGINE_FOREST) fails until a forest is loaded.
+    bool load_forest(const ForestModel* model) { return forest.load(model); }
+    bool set_engine(ClassifierEngine selected);
+    ClassifierEngine get_engine() const { return engine; }
+    const DecisionForest& get_forest() const { return forest; }
+
+    // Linear engine. It shares the label dictionary and normalization with
+    // k-NN and is trained by add_sample(), so set_engine(ENGINE_LINEAR)
+    // always succeeds; classify() reports KNN_INSUFFICIENT_DATA until it
+    // has seen MIN_TRAINING_SAMPLES. load_linear() replaces the weights of
+    // the model's labels (adding them to the dictionary) with an offline
+    // model, restricted to the feature mask; false, with the engine
+    // unchanged, if the labels do not fit.
+    bool load_linear(const LinearModel* model);
+    const LinearClassifier& get_linear() const { return linear; }
+
+    // Features the active engine reads, for AudioProcessor::set_feature_mask
+    FeatureMask get_required_features() const;
+
+    // Partial-distance abandoning and label box pruning in the linear scan on/off
+    void set_early_abandon(bool enabled);
+    bool get_early_abandon() const { return early_abandon; }
+
+    const KnnSearchStats& get_search_stats() const { return search_stats; }
+    void reset_search_stats();
+
+    // Statistics the stored samples are currently normalized with
+    void get_normalization(float* mean, float* std_dev) const;
+    const FeatureStats& get_running_stats() const { return running_stats; }
+    uint32_t get_renormalization_count() const { return renormalizations; }
+
+    // k-NN confidence calibration, saved with the training data. False,
+    // with the table unchanged, unless KnnCalibration::valid(). Cleared
+    // with the data and by a prototype reduction, which changes the vote
+    // shares it was fitted to.
+    bool set_calibration(const KnnCalibration& table);
+    const KnnCalibration& get_calibration() const { return calibration; }
+
+    // Replace the training set with at most per_class prototypes per label
+    // and report accuracy before and after. Runs on demand: the accuracy
+    // pass is O(n^2). False, with the set unchanged, if fewer than
+    // MIN_TRAINING_SAMPLES prototypes would remain.
+    bool reduce_prototypes(ReductionMethod method, size_t per_class, ReductionReport& report);
+
+private:
+    typedef NeighborHeap<K_NEIGHBORS> KnnHeap;
+#if KNN_QUANTIZED
+    typedef NeighborHeap<KNN_RERANK_CANDIDATES> SearchHeap;
+#else
+    typedef KnnHeap SearchHeap;
+#endif
+
+    // Training set as one contiguous column per feature plus a label ID
+    // column; sample i is row i of every column
+    std::vector<FeatureValue> columns[NUM_FEATURES];
+    std::vector<uint8_t> label_ids;
+    LabelDictionary labels;
+    FeatureMask feature_mask;
+    bool use_index;
+    bool early_abandon;
+    ClassifierEngine engine;
+    DecisionForest forest;
+    LinearClassifier linear;
+    KnnCalibration calibration;
+
+    // Implicit KD-tree: the subtree over index_order[lo, hi) has its root at
+    // the middle position, split on index_split_dim of that position, with
+    // the lower half on the left. Built by median partitioning.
+    std::vector<uint32_t> index_order;
+    std::vector<uint8_t> index_split_dim;
+    bool index_dirty;
+    uint32_t revision;
+    uint32_t held_out;          // Sample the searches skip, or KNN_NO_SAMPLE
+
+    // Masked features by descending between-label variance; every distance
+    // is summed in this order so partial sums grow fastest
+    uint8_t dim_order[NUM_FEATURES];
+    size_t active_dims;
+
+    // Sample indices grouped by label: label l owns
+    // label_members[label_start[l], label_start[l + 1]), inside the box
+    // label_low[l] .. label_high[l]. Built only while early abandon is on.
+    std::vector<uint32_t> label_members;
+    uint32_t label_start[MAX_LABELS + 1];
+    FeatureValue label_low[MAX_LABELS][NUM_FEATURES];
+    FeatureValue label_high[MAX_LABELS][NUM_FEATURES];
+
+    KnnSearchStats search_stats;
+
+    // Model statistics: columns hold (value - norm_mean) * norm_inv_std
+    float norm_mean[NUM_FEATURES];
+    float norm_inv_std[NUM_FEATURES];
+    FeatureStats running_stats;
+    uint32_t renormalizations;
+#if KNN_QUANTIZED
+    // Raw values of the rows written during the first KNN_FLOAT_ROWS
+    // samples, which renormalize() encodes from instead of from their
+    // codes; early_values holds NUM_FEATURES floats per entry of early_rows
+    std::vector<uint32_t> early_rows;
+    std::vector<float> early_values;
+#endif
+
+    // Memory budget and per-label reservoirs
+    size_t budget;
+    size_t class_quota;
+    uint32_t label_seen[MAX_LABELS];
+    uint32_t reservoir_state;
+    SampleAdmission last_admission;
+
+    // Rows changed since the last save, unless storage_stale: the whole
+    // file must be written
+    std::vector<uint32_t> unsaved_rows;
+    bool storage_stale;
+
+    void reset_normalization();
+    bool stats_drifted(float* mean, float* inv_std) const;
+    void renormalize(const float* mean, const float* inv_std);
+    void keep_early_row(uint32_t row, const float* values);
+    void forget_early_rows();
+    float normalize(int feature, float value) const;
+    static FeatureValue encode(float normalized);
+    static float to_normalized(FeatureValue stored);
+
+    static void to_array(const AudioFeatures& features, float* out);
+    void linear_input(const float* values, float* out) const;
+    float distance(const FeatureValue* query, uint32_t index, float limit);
+    float rerank_distance(const float* query, uint32_t index) const;
+    void reserve_samples(size_t count);
+    void clear_samples();
+
+    static void vote(const Neighbor* nearest, size_t k, const uint8_t* label_of, KnnResult& result);
+
+    // Prototype reduction helpers (PrototypeReduction.cpp)
+    void get_normalized_row(size_t index, float* out) const;
+    float row_distance(const float* a, const float* b) const;
+    void condense(const std::vector<uint32_t>& candidates, size_t per_class, std::vector<uint32_t>& kept) const;
+    void kmeans(const std::vector<uint32_t>& members, size_t clusters, float* centroids) const;
+
+    void samples_changed();
+    void mark_unsaved(uint32_t row);
+    void get_record(size_t row, uint8_t* record) const;
+    bool set_record(size_t row, const uint8_t* record, uint8_t label_count);
+    void invalidate_storage();
+    void reset_budget_state();
+    uint32_t admit(uint8_t label_id);
+    uint32_t reservoir_random(uint32_t range);
+    void count_labels(uint32_t* held) const;
+    int largest_label(const uint32_t* held) const;
+    uint32_t find_member(uint8_t label_id, uint32_t rank) const;
+    size_t search(const float* normalized, const FeatureValue* query, Neighbor* out);
+    int vote_neighbors(const Neighbor* nearest, size_t k, KnnResult& result) const;
+    void search_linear(const FeatureValue* query, SearchHeap& heap);
+    void search_labels(const FeatureValue* query, SearchHeap& heap);
+    void search_subtree(const FeatureValue* query, size_t lo, size_t hi, SearchHeap& heap);
+    float abandon_limit(const SearchHeap& heap) const;
+    void build_subtree(size_t lo, size_t hi);
+    void build_search_order();
+    void build_label_groups();
+};
+
+#endif
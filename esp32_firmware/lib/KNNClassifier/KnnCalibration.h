@@ -0,0 +1,60 @@
+#ifndef KNN_CALIBRATION_H
+#define KNN_CALIBRATION_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Knots of the confidence calibration table
+#ifndef KNN_CALIBRATION_POINTS
+#define KNN_CALIBRATION_POINTS 8
+#endif
+
+// Isotonic map from the winner's weighted vote share to the probability
+// that the winner is right, fitted on the host by tools/knn_calibrator and
+// saved with the model. Piecewise linear between knots, flat outside them.
+// Plain data so it can be written to storage as is.
+struct KnnCalibration {
+    uint8_t count;                                  // Knots in use; 0 = identity
+    float share[KNN_CALIBRATION_POINTS];            // Increasing, in 0..1
+    float probability[KNN_CALIBRATION_POINTS];      // Non-decreasing, in 0..1
+
+    void clear() { count = 0; }
+
+    // A table apply() can use: finite, sorted, monotonic and in range. NaN
+    // fails no comparison, so it is rejected explicitly.
+    bool valid() const {
+        if (count > KNN_CALIBRATION_POINTS) {
+            return false;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            if (!isfinite(share[i]) || !isfinite(probability[i])) {
+                return false;
+            }
+            if (share[i] < 0.0f || share[i] > 1.0f || probability[i] < 0.0f || probability[i] > 1.0f) {
+                return false;
+            }
+            if (i > 0 && (share[i] <= share[i - 1] || probability[i] < probability[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    float apply(float value) const {
+        if (count == 0) {
+            return value;
+        }
+        if (value <= share[0]) {
+            return probability[0];
+        }
+        for (uint8_t i = 1; i < count; i++) {
+            if (value < share[i]) {
+                float t = (value - share[i - 1]) / (share[i] - share[i - 1]);
+                return probability[i - 1] + t * (probability[i] - probability[i - 1]);
+            }
+        }
+        return probability[count - 1];
+    }
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef KNN_RESULT_H
+#define KNN_RESULT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "LabelDictionary.h"
+
+// classify_id() results that are not label IDs
+#define KNN_INSUFFICIENT_DATA -1
+#define KNN_REJECTED -2
+
+// Labels ranked in a KnnResult (and sent on the CLASSIFICATION line)
+#ifndef KNN_TOP_LABELS
+#define KNN_TOP_LABELS 3
+#endif
+
+// One classification, from either engine. Plain data, so it can live on
+// the stack or in a global and be filled without allocating.
+struct KnnResult {
+    int label_id;                   // Winning label, or KNN_INSUFFICIENT_DATA / KNN_REJECTED
+    float confidence;               // scores[label_id], calibrated for k-NN; 0 without a winner
+    float scores[MAX_LABELS];       // Share of the (distance-weighted) votes, or softmax, per label ID
+    uint8_t top[KNN_TOP_LABELS];    // Label IDs by descending score, ties to the earlier vote
+    uint8_t top_count;              // Entries of top in use (labels with a vote)
+};
+
+// Fill result from votes per label, tree counts or neighbour weights, that
+// add up to total. ranked holds the distinct labels that got a vote, in
+// tie-break order (nearest neighbour first, or first tree first); it is
+// sorted in place by votes, keeping that order for ties.
+template <typename Vote>
+inline void rank_votes(const Vote* votes, uint8_t* ranked, size_t distinct, float total, KnnResult& result) {
+    for (size_t i = 1; i < distinct; i++) {
+        uint8_t label_id = ranked[i];
+        size_t pos = i;
+        while (pos > 0 && votes[ranked[pos - 1]] < votes[label_id]) {
+            ranked[pos] = ranked[pos - 1];
+            pos--;
+        }
+        ranked[pos] = label_id;
+    }
+
+    for (size_t i = 0; i < MAX_LABELS; i++) {
+        result.scores[i] = (float)votes[i] / total;
+    }
+    result.label_id = ranked[0];
+    result.confidence = result.scores[ranked[0]];
+    result.top_count = distinct < KNN_TOP_LABELS ? distinct : KNN_TOP_LABELS;
+    for (size_t i = 0; i < result.top_count; i++) {
+        result.top[i] = ranked[i];
+    }
+}
+
+// Fill result with the softmax of count logits, ranked by score with ties
+// to the lower label ID. The largest logit is subtracted first so expf
+// never overflows.
+inline void softmax_result(const float* logits, size_t count, KnnResult& result) {
+    float largest = logits[0];
+    for (size_t i = 1; i < count; i++) {
+        largest = logits[i] > largest ? logits[i] : largest;
+    }
+    float total = 0.0f;
+    for (size_t i = 0; i < MAX_LABELS; i++) {
+        result.scores[i] = i < count ? expf(logits[i] - largest) : 0.0f;
+        total += result.scores[i];
+    }
+
+    uint8_t ranked[MAX_LABELS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        result.scores[i] /= total;
+        size_t pos = i;
+        while (pos > 0 && result.scores[ranked[pos - 1]] < result.scores[i]) {
+            ranked[pos] = ranked[pos - 1];
+            pos--;
+        }
+        ranked[pos] = (uint8_t)i;
+    }
+    result.label_id = ranked[0];
+    result.confidence = result.scores[ranked[0]];
+    result.top_count = count < KNN_TOP_LABELS ? count : KNN_TOP_LABELS;
+    for (size_t i = 0; i < result.top_count; i++) {
+        result.top[i] = ranked[i];
+    }
+}
+
+// Result for a query that has no winner
+inline void clear_result(int label_id, KnnResult& result) {
+    result.label_id = label_id;
+    result.confidence = 0.0f;
+    for (size_t i = 0; i < MAX_LABELS; i++) {
+        result.scores[i] = 0.0f;
+    }
+    result.top_count = 0;
+}
+
+#endif
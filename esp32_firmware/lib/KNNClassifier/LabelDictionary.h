@@ -0,0 +1,59 @@
+#ifndef LABEL_DICTIONARY_H
+#define LABEL_DICTIONARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Distinct labels the classifier can hold
+#ifndef MAX_LABELS
+#define MAX_LABELS 32
+#endif
+
+// Longest label name, in characters
+#ifndef KNN_LABEL_LENGTH
+#define KNN_LABEL_LENGTH 15
+#endif
+
+// Label ID <-> name table in fixed storage (MAX_LABELS * 16 bytes by
+// default). IDs are assigned in order of first use and never change until
+// clear(), so they can be stored per sample and saved with the model.
+class LabelDictionary {
+public:
+    LabelDictionary() : count(0) {}
+
+    void clear() { count = 0; }
+    size_t size() const { return count; }
+    const char* name(size_t id) const { return names[id]; }
+
+    // ID of name, or -1
+    int find(const char* name) const {
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(names[i], name) == 0) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    // ID of name, added if new; -1 if the table is full or the name is
+    // empty or longer than KNN_LABEL_LENGTH
+    int add(const char* name) {
+        int id = find(name);
+        if (id >= 0) {
+            return id;
+        }
+        size_t length = strlen(name);
+        if (count >= MAX_LABELS || length == 0 || length > KNN_LABEL_LENGTH) {
+            return -1;
+        }
+        memcpy(names[count], name, length + 1);
+        return (int)count++;
+    }
+
+private:
+    char names[MAX_LABELS][KNN_LABEL_LENGTH + 1];
+    uint8_t count;
+};
+
+#endif
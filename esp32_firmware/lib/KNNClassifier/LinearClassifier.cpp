@@ -0,0 +1,87 @@
+#include "LinearClassifier.h"
+
+void LinearClassifier::clear() {
+    for (size_t label = 0; label < MAX_LABELS; label++) {
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            state.weights[label][f] = 0.0f;
+        }
+        state.bias[label] = 0.0f;
+    }
+    state.sample_count = 0;
+}
+
+// Fixed trip count over one contiguous row, which the compiler unrolls
+void LinearClassifier::logits(const float* values, size_t label_count, float* out) const {
+    for (size_t label = 0; label < label_count; label++) {
+        const float* w = state.weights[label];
+        float sum = state.bias[label];
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            sum += w[f] * values[f];
+        }
+        out[label] = sum;
+    }
+}
+
+int LinearClassifier::classify(const float* values, size_t label_count, KnnResult& result) const {
+    float z[MAX_LABELS] = {0};
+    logits(values, label_count, z);
+    softmax_result(z, label_count, result);
+    return result.label_id;
+}
+
+// Gradient of the cross-entropy with respect to a label's logit is its
+// probability minus 1 for the true label, 0 for the others
+void LinearClassifier::train(const float* values, uint8_t label_id, size_t label_count, float rate) {
+    KnnResult predicted;
+    classify(values, label_count, predicted);
+
+    const float decay = 1.0f - rate * LINEAR_WEIGHT_DECAY;
+    for (size_t label = 0; label < label_count; label++) {
+        float error = predicted.scores[label] - (label == label_id ? 1.0f : 0.0f);
+        float* w = state.weights[label];
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            w[f] = w[f] * decay - rate * error * values[f];
+        }
+        state.bias[label] -= rate * error;
+    }
+    state.sample_count++;
+}
+
+// With z = (x - mean) * inv_std, w . z + b = (w * inv_std) . x + b - (w * inv_std) . mean
+void LinearClassifier::get_raw(uint8_t label_id, const float* mean, const float* inv_std, float* weights,
+                               float& bias) const {
+    bias = state.bias[label_id];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        weights[f] = state.weights[label_id][f] * inv_std[f];
+        bias -= weights[f] * mean[f];
+    }
+}
+
+void LinearClassifier::set_raw(uint8_t label_id, const float* weights, float bias, const float* mean,
+                               const float* inv_std) {
+    state.bias[label_id] = bias;
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        state.weights[label_id][f] = weights[f] / inv_std[f];
+        state.bias[label_id] += weights[f] * mean[f];
+    }
+}
+
+void LinearClassifier::rebase(const float* old_mean, const float* old_inv_std, const float* mean,
+                              const float* inv_std) {
+    for (size_t label = 0; label < MAX_LABELS; label++) {
+        float raw[NUM_FEATURES];
+        float bias;
+        get_raw((uint8_t)label, old_mean, old_inv_std, raw, bias);
+        set_raw((uint8_t)label, raw, bias, mean, inv_std);
+    }
+}
+
+void LinearClassifier::restrict_features(FeatureMask mask) {
+    for (size_t label = 0; label < MAX_LABELS; label++) {
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            if (!(mask & (1 << f))) {
+                state.weights[label][f] = 0.0f;
+            }
+        }
+    }
+}
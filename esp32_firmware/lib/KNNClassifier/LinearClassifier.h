@@ -0,0 +1,81 @@
+#ifndef LINEAR_CLASSIFIER_H
+#define LINEAR_CLASSIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AudioProcessor.h"
+#include "KnnResult.h"
+
+// Step size of the SGD update made for every training sample
+#ifndef LINEAR_LEARNING_RATE
+#define LINEAR_LEARNING_RATE 0.05f
+#endif
+
+// L2 weight decay per update, so a long labelling session cannot grow the
+// weights without bound
+#ifndef LINEAR_WEIGHT_DECAY
+#define LINEAR_WEIGHT_DECAY 0.0001f
+#endif
+
+// A model trained offline by tools/linear_trainer: constexpr arrays that
+// stay in flash. Weights are in raw feature units, so the model does not
+// depend on the normalization of the device it is loaded on.
+struct LinearModel {
+    const float* weights;           // [label_count][NUM_FEATURES]
+    const float* bias;              // [label_count]
+    const char* const* labels;      // Label ID -> name
+    uint8_t label_count;
+    FeatureMask feature_mask;       // Features with a non-zero weight
+    uint32_t sample_count;          // Samples it was trained on
+};
+
+// Everything the engine learns, as plain data so it can be saved with the
+// training set. Weights apply to normalized features.
+struct LinearState {
+    float weights[MAX_LABELS][NUM_FEATURES];
+    float bias[MAX_LABELS];
+    uint32_t sample_count;          // SGD updates, plus the offline model's samples
+};
+
+// Alternative engine behind KNNClassifier (see set_engine): multinomial
+// logistic regression. Inference is one NUM_FEATURES-wide dot product per
+// label and a softmax, so it can run on every frame; training is one SGD
+// step per sample and never allocates.
+class LinearClassifier {
+public:
+    LinearClassifier() { clear(); }
+
+    void clear();
+
+    // One SGD step of softmax cross-entropy on a normalized sample, over
+    // label IDs 0 .. label_count - 1
+    void train(const float* values, uint8_t label_id, size_t label_count, float rate = LINEAR_LEARNING_RATE);
+
+    // Softmax of the label_count logits into result; returns result.label_id
+    int classify(const float* values, size_t label_count, KnnResult& result) const;
+
+    // Logits for a normalized sample, for label IDs below label_count
+    void logits(const float* values, size_t label_count, float* out) const;
+
+    // Re-express the weights for inputs normalized as (x - mean) * inv_std
+    // instead of (x - old_mean) * old_inv_std; every logit is unchanged
+    void rebase(const float* old_mean, const float* old_inv_std, const float* mean, const float* inv_std);
+
+    // One label's weights in raw feature units, given the normalization
+    // the state is in, and back
+    void get_raw(uint8_t label_id, const float* mean, const float* inv_std, float* weights, float& bias) const;
+    void set_raw(uint8_t label_id, const float* weights, float bias, const float* mean, const float* inv_std);
+
+    // Zero the weights of features outside mask, which are then fed as 0
+    void restrict_features(FeatureMask mask);
+
+    uint32_t get_sample_count() const { return state.sample_count; }
+    void set_sample_count(uint32_t count) { state.sample_count = count; }
+    const LinearState& get_state() const { return state; }
+    void set_state(const LinearState& loaded) { state = loaded; }
+
+private:
+    LinearState state;
+};
+
+#endif
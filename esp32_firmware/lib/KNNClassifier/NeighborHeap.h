@@ -0,0 +1,92 @@
+#ifndef NEIGHBOR_HEAP_H
+#define NEIGHBOR_HEAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One neighbour: squared normalized distance and training sample index.
+// Ordered by distance, then index, so ties resolve the same in every search.
+struct Neighbor {
+    float distance;
+    uint32_t index;
+};
+
+inline bool neighbor_before(float distance, uint32_t index, const Neighbor& other) {
+    return distance < other.distance || (distance == other.distance && index < other.index);
+}
+
+// Fixed-capacity max-heap keeping the K best neighbours seen so far. Lives
+// on the stack; the worst kept neighbour is at the root so a candidate is
+// accepted or rejected with one comparison.
+template <size_t K>
+class NeighborHeap {
+    static_assert(K > 0, "NeighborHeap needs room for at least one neighbour");
+
+public:
+    NeighborHeap() : count(0) {}
+
+    size_t size() const { return count; }
+    bool full() const { return count == K; }
+
+    // Worst kept neighbour; only meaningful once full()
+    const Neighbor& worst() const { return items[0]; }
+
+    // Offer a candidate; kept if the heap has room or it beats worst()
+    void push(float distance, uint32_t index) {
+        if (count < K) {
+            size_t pos = count++;
+            // Sift up
+            while (pos > 0) {
+                size_t parent = (pos - 1) / 2;
+                if (!neighbor_before(items[parent].distance, items[parent].index, Neighbor{distance, index})) {
+                    break;
+                }
+                items[pos] = items[parent];
+                pos = parent;
+            }
+            items[pos].distance = distance;
+            items[pos].index = index;
+        } else if (neighbor_before(distance, index, items[0])) {
+            sift_down(0, count, Neighbor{distance, index});
+        }
+    }
+
+    // Write the kept neighbours to out, closest first, and return the count.
+    // Empties the heap.
+    size_t drain_sorted(Neighbor* out) {
+        size_t n = count;
+        while (count > 0) {
+            out[count - 1] = items[0];
+            count--;
+            if (count > 0) {
+                sift_down(0, count, items[count]);
+            }
+        }
+        return n;
+    }
+
+private:
+    Neighbor items[K];
+    size_t count;
+
+    // Place value at pos and restore the heap property below it
+    void sift_down(size_t pos, size_t n, Neighbor value) {
+        while (true) {
+            size_t child = 2 * pos + 1;
+            if (child >= n) {
+                break;
+            }
+            if (child + 1 < n && neighbor_before(items[child].distance, items[child].index, items[child + 1])) {
+                child++;
+            }
+            if (!neighbor_before(value.distance, value.index, items[child])) {
+                break;
+            }
+            items[pos] = items[child];
+            pos = child;
+        }
+        items[pos] = value;
+    }
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "KNNClassifier.h"
+#include <string.h>
+#include <algorithm>
+
+bool parse_reduction_method(const char* name, ReductionMethod& method) {
+    if (strcmp(name, "condensed") == 0) {
+        method = REDUCE_CONDENSED;
+    } else if (strcmp(name, "edited") == 0) {
+        method = REDUCE_EDITED;
+    } else if (strcmp(name, "kmeans") == 0) {
+        method = REDUCE_KMEANS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* reduction_method_name(ReductionMethod method) {
+    switch (method) {
+        case REDUCE_CONDENSED: return "condensed";
+        case REDUCE_EDITED: return "edited";
+        case REDUCE_KMEANS: return "kmeans";
+    }
+    return "unknown";
+}
+
+// All of the reduction works on normalized float values: the stored
+// samples are read through rerank_distance(), and the prototypes are
+// built as row-major float rows before they replace the columns.
+
+void KNNClassifier::get_normalized_row(size_t index, float* out) const {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        out[f] = to_normalized(columns[f][index]);
+    }
+}
+
+float KNNClassifier::row_distance(const float* a, const float* b) const {
+    float sum = 0.0f;
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        if (feature_mask & (1 << f)) {
+            float d = a[f] - b[f];
+            sum += d * d;
+        }
+    }
+    return sum;
+}
+
+// Hart's condensed nearest neighbour over the candidate samples: start from
+// the first candidate of each label and add every candidate the kept set
+// misclassifies (1-NN), until a pass adds nothing or every label is full
+void KNNClassifier::condense(const std::vector<uint32_t>& candidates, size_t per_class,
+                             std::vector<uint32_t>& kept) const {
+    size_t kept_per_label[MAX_LABELS] = {0};
+    std::vector<uint8_t> is_kept(label_ids.size());
+    kept.clear();
+    for (size_t i = 0; i < candidates.size(); i++) {
+        uint8_t label = label_ids[candidates[i]];
+        if (kept_per_label[label] == 0) {
+            kept.push_back(candidates[i]);
+            is_kept[candidates[i]] = 1;
+            kept_per_label[label]++;
+        }
+    }
+
+    bool added = true;
+    while (added) {
+        added = false;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            uint32_t index = candidates[i];
+            uint8_t label = label_ids[index];
+            if (is_kept[index] || kept_per_label[label] >= per_class) {
+                continue;
+            }
+
+            float query[NUM_FEATURES];
+            get_normalized_row(index, query);
+            uint32_t nearest = kept[0];
+            float best = rerank_distance(query, kept[0]);
+            for (size_t j = 1; j < kept.size(); j++) {
+                float d = rerank_distance(query, kept[j]);
+                if (d < best) {
+                    best = d;
+                    nearest = kept[j];
+                }
+            }
+            if (label_ids[nearest] != label) {
+                kept.push_back(index);
+                is_kept[index] = 1;
+                kept_per_label[label]++;
+                added = true;
+            }
+        }
+    }
+}
+
+// Per-label Lloyd iterations. Initial centroids are chosen farthest-first,
+// starting from the member closest to the label mean, so runs are
+// repeatable. An empty cluster keeps its previous centroid.
+void KNNClassifier::kmeans(const std::vector<uint32_t>& members, size_t clusters, float* centroids) const {
+    float mean[NUM_FEATURES] = {0};
+    float row[NUM_FEATURES];
+    for (size_t i = 0; i < members.size(); i++) {
+        get_normalized_row(members[i], row);
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            mean[f] += row[f] / members.size();
+        }
+    }
+
+    // nearest[i]: squared distance from member i to its closest centroid
+    std::vector<float> nearest(members.size());
+    size_t first = 0;
+    for (size_t i = 0; i < members.size(); i++) {
+        nearest[i] = rerank_distance(mean, members[i]);
+        if (nearest[i] < nearest[first]) {
+            first = i;
+        }
+    }
+    get_normalized_row(members[first], centroids);
+    for (size_t i = 0; i < members.size(); i++) {
+        nearest[i] = rerank_distance(centroids, members[i]);
+    }
+    for (size_t c = 1; c < clusters; c++) {
+        size_t farthest = 0;
+        for (size_t i = 1; i < members.size(); i++) {
+            if (nearest[i] > nearest[farthest]) {
+                farthest = i;
+            }
+        }
+        float* centroid = centroids + c * NUM_FEATURES;
+        get_normalized_row(members[farthest], centroid);
+        for (size_t i = 0; i < members.size(); i++) {
+            float d = rerank_distance(centroid, members[i]);
+            nearest[i] = d < nearest[i] ? d : nearest[i];
+        }
+    }
+
+    std::vector<uint8_t> assignment(members.size());
+    std::vector<float> sums(clusters * NUM_FEATURES);
+    std::vector<uint32_t> counts(clusters);
+    for (int iteration = 0; iteration < KNN_KMEANS_ITERATIONS; iteration++) {
+        for (size_t i = 0; i < members.size(); i++) {
+            size_t best = 0;
+            float best_distance = rerank_distance(centroids, members[i]);
+            for (size_t c = 1; c < clusters; c++) {
+                float d = rerank_distance(centroids + c * NUM_FEATURES, members[i]);
+                if (d < best_distance) {
+                    best_distance = d;
+                    best = c;
+                }
+            }
+            assignment[i] = (uint8_t)best;
+        }
+
+        std::fill(sums.begin(), sums.end(), 0.0f);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < members.size(); i++) {
+            get_normalized_row(members[i], row);
+            float* sum = &sums[assignment[i] * NUM_FEATURES];
+            for (int f = 0; f < NUM_FEATURES; f++) {
+                sum[f] += row[f];
+            }
+            counts[assignment[i]]++;
+        }
+        for (size_t c = 0; c < clusters; c++) {
+            if (counts[c] == 0) {
+                continue;
+            }
+            for (int f = 0; f < NUM_FEATURES; f++) {
+                centroids[c * NUM_FEATURES + f] = sums[c * NUM_FEATURES + f] / counts[c];
+            }
+        }
+    }
+}
+
+bool KNNClassifier::reduce_prototypes(ReductionMethod method, size_t per_class, ReductionReport& report) {
+    size_t count = label_ids.size();
+    report.samples_before = count;
+    report.samples_after = count;
+    report.accuracy_before = 0.0f;
+    report.accuracy_after = 0.0f;
+    if (count < MIN_TRAINING_SAMPLES || per_class == 0 || per_class > 255) {
+        return false;
+    }
+
+    // Leave-one-out k-NN over the full set: the "before" accuracy, and the
+    // editing rule for REDUCE_EDITED
+    std::vector<uint8_t> loo_correct(count);
+    size_t correct = 0;
+    for (size_t i = 0; i < count; i++) {
+        float query[NUM_FEATURES];
+        get_normalized_row(i, query);
+        KnnHeap heap;
+        for (size_t j = 0; j < count; j++) {
+            if (j != i) {
+                heap.push(rerank_distance(query, j), (uint32_t)j);
+            }
+        }
+        Neighbor nearest[K_NEIGHBORS];
+        size_t k = heap.drain_sorted(nearest);
+        KnnResult result;
+        vote(nearest, k, label_ids.data(), result);
+        loo_correct[i] = result.label_id == label_ids[i];
+        correct += loo_correct[i];
+    }
+    report.accuracy_before = (float)correct / count;
+
+    // Prototypes as normalized rows
+    std::vector<float> rows;
+    std::vector<uint8_t> row_labels;
+    if (method == REDUCE_KMEANS) {
+        for (size_t label = 0; label < labels.size(); label++) {
+            std::vector<uint32_t> members;
+            for (size_t i = 0; i < count; i++) {
+                if (label_ids[i] == label) {
+                    members.push_back(i);
+                }
+            }
+            if (members.empty()) {
+                continue;
+            }
+            size_t clusters = members.size() < per_class ? members.size() : per_class;
+            size_t start = rows.size();
+            rows.resize(start + clusters * NUM_FEATURES);
+            kmeans(members, clusters, &rows[start]);
+            row_labels.insert(row_labels.end(), clusters, (uint8_t)label);
+        }
+    } else {
+        std::vector<uint32_t> candidates;
+        for (size_t i = 0; i < count; i++) {
+            if (method != REDUCE_EDITED || loo_correct[i]) {
+                candidates.push_back(i);
+            }
+        }
+        // Editing never removes a label outright
+        for (size_t label = 0; label < labels.size() && method == REDUCE_EDITED; label++) {
+            bool present = false;
+            for (size_t i = 0; i < candidates.size() && !present; i++) {
+                present = label_ids[candidates[i]] == label;
+            }
+            for (size_t i = 0; i < count && !present; i++) {
+                if (label_ids[i] == label) {
+                    candidates.push_back(i);
+                }
+            }
+        }
+
+        std::vector<uint32_t> kept;
+        condense(candidates, per_class, kept);
+        rows.resize(kept.size() * NUM_FEATURES);
+        for (size_t i = 0; i < kept.size(); i++) {
+            get_normalized_row(kept[i], &rows[i * NUM_FEATURES]);
+            row_labels.push_back(label_ids[kept[i]]);
+        }
+    }
+
+    size_t prototypes = row_labels.size();
+    if (prototypes < MIN_TRAINING_SAMPLES) {
+        return false;
+    }
+
+    // k-NN of every original sample against the prototypes
+    correct = 0;
+    for (size_t i = 0; i < count; i++) {
+        float query[NUM_FEATURES];
+        get_normalized_row(i, query);
+        KnnHeap heap;
+        for (size_t j = 0; j < prototypes; j++) {
+            heap.push(row_distance(query, &rows[j * NUM_FEATURES]), (uint32_t)j);
+        }
+        Neighbor nearest[K_NEIGHBORS];
+        size_t k = heap.drain_sorted(nearest);
+        KnnResult result;
+        vote(nearest, k, row_labels.data(), result);
+        correct += result.label_id == label_ids[i];
+    }
+    report.accuracy_after = (float)correct / count;
+    report.samples_after = prototypes;
+
+    // Replace the store. The running statistics still describe everything
+    // that was labelled, so the normalization is left as it is.
+    clear_samples();
+    reserve_samples(prototypes);
+    for (size_t i = 0; i < prototypes; i++) {
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            columns[f].push_back(encode(rows[i * NUM_FEATURES + f]));
+        }
+        label_ids.push_back(row_labels[i]);
+    }
+    calibration.clear();
+    invalidate_storage();
+    samples_changed();
+    return true;
+}
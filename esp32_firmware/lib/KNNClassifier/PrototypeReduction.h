@@ -0,0 +1,39 @@
+#ifndef PROTOTYPE_REDUCTION_H
+#define PROTOTYPE_REDUCTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Ways KNNClassifier::reduce_prototypes() compresses the training set to a
+// fixed number of prototypes per label
+enum ReductionMethod {
+    REDUCE_CONDENSED,   // Hart's condensed NN: keep only samples the kept set misclassifies
+    REDUCE_EDITED,      // Wilson editing (drop samples their neighbours outvote), then condense
+    REDUCE_KMEANS       // Per-label k-means centroids
+};
+
+// Default prototypes per label for the REDUCE serial command
+#ifndef KNN_PROTOTYPES_PER_CLASS
+#define KNN_PROTOTYPES_PER_CLASS 32
+#endif
+
+// Lloyd iterations for REDUCE_KMEANS
+#ifndef KNN_KMEANS_ITERATIONS
+#define KNN_KMEANS_ITERATIONS 10
+#endif
+
+// Accuracy is measured on the training set as it was before the
+// reduction: leave-one-out k-NN against the full set before, k-NN against
+// the prototypes after
+struct ReductionReport {
+    uint32_t samples_before;
+    uint32_t samples_after;
+    float accuracy_before;
+    float accuracy_after;
+};
+
+// Parses "condensed", "edited" or "kmeans"; false for anything else
+bool parse_reduction_method(const char* name, ReductionMethod& method);
+const char* reduction_method_name(ReductionMethod method);
+
+#endif
@@ -0,0 +1,140 @@
+#include "KNNClassifier.h"
+
+// Bounded training memory. Once a label has its quota, each new sample of
+// it replaces a random kept one with probability quota / samples seen
+// (reservoir sampling, Vitter's algorithm R), so the label keeps a uniform
+// sample of everything it was given however long training runs. A label
+// under quota in a full store takes a row from the largest label.
+
+void KNNClassifier::reset_budget_state() {
+    for (size_t l = 0; l < MAX_LABELS; l++) {
+        label_seen[l] = 0;
+    }
+    reservoir_state = 0x2545F491UL;
+    last_admission = SAMPLE_APPENDED;
+}
+
+size_t KNNClassifier::get_label_quota() const {
+    size_t quota = budget;
+    if (class_quota > 0 && class_quota < quota) {
+        quota = class_quota;
+    } else if (class_quota == 0 && labels.size() > 0) {
+        quota = budget / labels.size();
+    }
+    return quota > 0 ? quota : 1;
+}
+
+// Uniform in [0, range) from the high bits of an LCG
+uint32_t KNNClassifier::reservoir_random(uint32_t range) {
+    reservoir_state = reservoir_state * 1664525UL + 1013904223UL;
+    return (uint32_t)(((uint64_t)reservoir_state * range) >> 32);
+}
+
+void KNNClassifier::count_labels(uint32_t* held) const {
+    for (size_t l = 0; l < MAX_LABELS; l++) {
+        held[l] = 0;
+    }
+    for (size_t i = 0; i < label_ids.size(); i++) {
+        held[label_ids[i]]++;
+    }
+}
+
+// Label with the most samples, ties to the lower ID; -1 if there are none.
+// Every label has the same quota, so it is also the one furthest over.
+int KNNClassifier::largest_label(const uint32_t* held) const {
+    int largest = -1;
+    for (size_t l = 0; l < labels.size(); l++) {
+        if (held[l] > 0 && (largest < 0 || held[l] > held[largest])) {
+            largest = (int)l;
+        }
+    }
+    return largest;
+}
+
+// Row of the rank-th sample of a label, in store order
+uint32_t KNNClassifier::find_member(uint8_t label_id, uint32_t rank) const {
+    for (size_t i = 0; i < label_ids.size(); i++) {
+        if (label_ids[i] == label_id && rank-- == 0) {
+            return (uint32_t)i;
+        }
+    }
+    return KNN_NO_SAMPLE;
+}
+
+// Row for a new sample of label_id, already counted in label_seen: the
+// end of the store, a row to overwrite, or KNN_NO_SAMPLE to drop it
+uint32_t KNNClassifier::admit(uint8_t label_id) {
+    uint32_t held[MAX_LABELS];
+    count_labels(held);
+    if (held[label_id] < get_label_quota()) {
+        if (label_ids.size() < budget) {
+            last_admission = SAMPLE_APPENDED;
+            return (uint32_t)label_ids.size();
+        }
+        int largest = largest_label(held);
+        last_admission = SAMPLE_REPLACED;
+        return find_member((uint8_t)largest, reservoir_random(held[largest]));
+    }
+
+    uint32_t slot = reservoir_random(label_seen[label_id]);
+    if (slot >= held[label_id]) {
+        last_admission = SAMPLE_DISCARDED;
+        return KNN_NO_SAMPLE;
+    }
+    last_admission = SAMPLE_REPLACED;
+    return find_member(label_id, slot);
+}
+
+bool KNNClassifier::set_memory_budget(size_t samples, size_t per_class) {
+    if (samples < MIN_TRAINING_SAMPLES || samples > MAX_TRAINING_SAMPLES) {
+        return false;
+    }
+    budget = samples;
+    class_quota = per_class;
+
+    // Evict a random sample of the largest label until everything fits
+    uint32_t held[MAX_LABELS];
+    count_labels(held);
+    size_t quota = get_label_quota();
+    size_t kept = label_ids.size();
+    std::vector<uint8_t> evicted(kept, 0);
+    for (;;) {
+        int largest = largest_label(held);
+        if (largest < 0 || (kept <= budget && held[largest] <= quota)) {
+            break;
+        }
+        uint32_t rank = reservoir_random(held[largest]);
+        for (size_t i = 0; i < label_ids.size(); i++) {
+            if (label_ids[i] == largest && !evicted[i] && rank-- == 0) {
+                evicted[i] = 1;
+                break;
+            }
+        }
+        held[largest]--;
+        kept--;
+    }
+    if (kept == label_ids.size()) {
+        return true;
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < label_ids.size(); i++) {
+        if (evicted[i]) {
+            continue;
+        }
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            columns[f][out] = columns[f][i];
+        }
+        label_ids[out++] = label_ids[i];
+    }
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        columns[f].resize(out);
+        columns[f].shrink_to_fit();
+    }
+    label_ids.resize(out);
+    label_ids.shrink_to_fit();
+    forget_early_rows();
+    invalidate_storage();
+    samples_changed();
+    return true;
+}
@@ -0,0 +1,146 @@
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring buffer.
+//
+// The producer (acquisition task or ISR) pushes whole blocks; the consumer
+// drains in bulk through peek()/consume(), reading straight out of the ring
+// without an intermediate copy. Head and tail are free-running counters, so
+// the full CAPACITY is usable and wrap-around is a mask.
+template <typename T, size_t CAPACITY>
+class SpscRingBuffer {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "SpscRingBuffer capacity must be a power of two");
+
+public:
+    SpscRingBuffer() : head(0), tail(0), high_water(0), high_water_reset(false), overruns(0), dropped(0) {}
+
+    // Producer side. All-or-nothing: a block that does not fit is rejected
+    // and counted as an overrun rather than partially written.
+    bool push(const T* data, size_t count) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        size_t used = h - t;
+
+        // high_water has a single writer: a reset requested by the
+        // consumer is applied here
+        if (high_water_reset.load(std::memory_order_relaxed)) {
+            high_water_reset.store(false, std::memory_order_relaxed);
+            high_water.store(used, std::memory_order_relaxed);
+        }
+
+        if (count > CAPACITY - used) {
+            overruns.fetch_add(1, std::memory_order_relaxed);
+            dropped.fetch_add(count, std::memory_order_relaxed);
+            return false;
+        }
+
+        size_t start = h & MASK;
+        size_t first = CAPACITY - start;
+        if (first > count) {
+            first = count;
+        }
+        memcpy(&buffer[start], data, first * sizeof(T));
+        memcpy(&buffer[0], data + first, (count - first) * sizeof(T));
+
+        head.store(h + count, std::memory_order_release);
+
+        used += count;
+        if (used > high_water.load(std::memory_order_relaxed)) {
+            high_water.store(used, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side. Returns the number of elements readable without
+    // wrapping and points data at them; call consume() once processed.
+    size_t peek(const T*& data) const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        size_t available = h - t;
+        size_t start = t & MASK;
+
+        if (available > CAPACITY - start) {
+            available = CAPACITY - start;
+        }
+        data = &buffer[start];
+        return available;
+    }
+
+    void consume(size_t count) {
+        tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Copying pop for callers that need the data in their own buffer
+    size_t pop(T* out, size_t max_count) {
+        size_t total = 0;
+        while (total < max_count) {
+            const T* data;
+            size_t n = peek(data);
+            if (n == 0) {
+                break;
+            }
+            if (n > max_count - total) {
+                n = max_count - total;
+            }
+            memcpy(out + total, data, n * sizeof(T));
+            consume(n);
+            total += n;
+        }
+        return total;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return CAPACITY; }
+
+    // Statistics. Until the producer applies a reset, the high-water mark
+    // reads as the current fill level.
+    size_t get_high_water_mark() const {
+        return high_water_reset.load(std::memory_order_relaxed) ? size()
+                                                                : high_water.load(std::memory_order_relaxed);
+    }
+    uint32_t get_overrun_count() const { return overruns.load(std::memory_order_relaxed); }
+    uint32_t get_dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Consumer side, safe while the producer runs. The counters are reset
+    // with single stores against the producer's fetch_add. high_water is
+    // updated compare-then-store by the producer, which could overwrite a
+    // direct reset with a stale peak, so the producer applies it instead.
+    void reset_stats() {
+        high_water_reset.store(true, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+    }
+
+    // Only safe while neither side is running
+    void clear() {
+        head.store(0);
+        tail.store(0);
+        high_water.store(0);
+        high_water_reset.store(false);
+        overruns.store(0);
+        dropped.store(0);
+    }
+
+private:
+    static const size_t MASK = CAPACITY - 1;
+
+    T buffer[CAPACITY];
+    std::atomic<uint32_t> head;        // Written by producer
+    std::atomic<uint32_t> tail;        // Written by consumer
+
+    std::atomic<size_t> high_water;    // Peak fill level seen by producer
+    std::atomic<bool> high_water_reset;  // Set by consumer, applied by producer
+    std::atomic<uint32_t> overruns;    // Rejected pushes
+    std::atomic<uint32_t> dropped;     // Elements in rejected pushes
+};
+
+#endif
@@ -0,0 +1,603 @@
+#include "SerialProtocol.h"
+#include "KNNClassifier.h"
+#include "ProcessingCascade.h"
+#include "CnnClassifier.h"
+#include <stdlib.h>
+
+// Owned by main.cpp
+extern AudioProcessor audio_processor;
+extern KNNClassifier classifier;
+extern CnnClassifier cnn;
+extern bool cnn_active;
+extern ProcessingCascade cascade;
+extern DetectionDecoder detector;
+extern AudioFeatures last_features;
+extern bool has_new_features;
+
+static const size_t MAX_COMMAND_LENGTH = 128;
+
+// Training samples replayed through classify_id() to time a reduction or
+// an engine
+static const size_t LATENCY_QUERIES = 16;
+
+void SerialProtocol::initialize() {
+    input_buffer.reserve(MAX_COMMAND_LENGTH);
+    input_buffer = "";
+}
+
+void SerialProtocol::handle_input() {
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c == '\n' || c == '\r') {
+            if (input_buffer.length() > 0) {
+                process_command(input_buffer);
+                input_buffer = "";
+            }
+        } else if (input_buffer.length() < MAX_COMMAND_LENGTH) {
+            input_buffer += c;
+        }
+    }
+}
+
+void SerialProtocol::process_command(const String& command) {
+    if (command.startsWith("LABEL:")) {
+        handle_label(command.substring(6));
+    } else if (command == "SAVE_DATA") {
+        if (classifier.save_to_storage()) {
+            Serial.println("OK:Training data saved");
+        } else {
+            Serial.println("ERROR:Failed to save training data");
+        }
+    } else if (command == "CLEAR_DATA") {
+        end_detection();
+        cross_validation.clear();       // Its report names the old labels
+        classifier.clear_data();
+        classifier.save_to_storage();
+        Serial.println("OK:Training data cleared");
+    } else if (command.startsWith("FEATURE_MASK:")) {
+        handle_feature_mask(command.substring(13));
+    } else if (command.startsWith("GATE:")) {
+        handle_gate(command.substring(5));
+    } else if (command.startsWith("SMOOTHING:")) {
+        handle_smoothing(command.substring(10));
+    } else if (command.startsWith("CALIBRATION:")) {
+        handle_calibration(command.substring(12));
+    } else if (command.startsWith("REDUCE:")) {
+        handle_reduce(command.substring(7));
+    } else if (command.startsWith("BUDGET:")) {
+        handle_budget(command.substring(7));
+    } else if (command.startsWith("ENGINE:")) {
+        handle_engine(command.substring(7));
+    } else if (command == "CROSS_VALIDATE") {
+        handle_cross_validate("");
+    } else if (command.startsWith("CROSS_VALIDATE:")) {
+        handle_cross_validate(command.substring(15));
+    } else if (command == "EXPORT_DATA") {
+        export_data();
+    } else {
+        Serial.print("ERROR:Unknown command ");
+        Serial.println(command);
+    }
+}
+
+void SerialProtocol::handle_label(const String& label) {
+    if (label.length() == 0) {
+        Serial.println("ERROR:Empty label");
+        return;
+    }
+    // Names go into comma-separated replies and a fixed-size dictionary
+    if (label.length() > KNN_LABEL_LENGTH || label.indexOf(',') >= 0) {
+        Serial.print("ERROR:Label must be at most ");
+        Serial.print(KNN_LABEL_LENGTH);
+        Serial.println(" characters without commas");
+        return;
+    }
+    if (!has_new_features) {
+        Serial.println("ERROR:No features available yet");
+        return;
+    }
+    if (!classifier.add_sample(last_features, label.c_str())) {
+        Serial.println("ERROR:Label table full");
+        return;
+    }
+    // Rewrites the header (counts seen, linear weights) and at most the
+    // one changed record
+    classifier.save_to_storage();
+
+    SampleAdmission admission = classifier.get_last_admission();
+    if (admission == SAMPLE_DISCARDED) {
+        Serial.print("OK:Sample not kept for ");
+    } else if (admission == SAMPLE_REPLACED) {
+        Serial.print("OK:Sample replaced one for ");
+    } else {
+        Serial.print("OK:Sample added as ");
+    }
+    Serial.print(label);
+    Serial.print(" (");
+    Serial.print(classifier.get_sample_count());
+    Serial.println(" total)");
+}
+
+void SerialProtocol::handle_budget(const String& value) {
+    int comma = value.indexOf(',');
+    long samples = (comma < 0 ? value : value.substring(0, comma)).toInt();
+    long per_class = comma < 0 ? 0 : value.substring(comma + 1).toInt();
+    if (per_class < 0 || samples < 0 || !classifier.set_memory_budget((size_t)samples, (size_t)per_class)) {
+        Serial.print("ERROR:Expected BUDGET:<samples ");
+        Serial.print(MIN_TRAINING_SAMPLES);
+        Serial.print("..");
+        Serial.print(MAX_TRAINING_SAMPLES);
+        Serial.println(">[,<per_class>]");
+        return;
+    }
+    // Shrinking evicts samples, which the report would no longer match
+    cross_validation.clear();
+    classifier.save_to_storage();
+
+    Serial.print("OK:Budget ");
+    Serial.print(classifier.get_memory_budget());
+    Serial.print(" samples (");
+    Serial.print(classifier.get_memory_budget() * (NUM_FEATURES * sizeof(FeatureValue) + 1));
+    Serial.print(" bytes), quota ");
+    Serial.print(classifier.get_label_quota());
+    Serial.print(" per label, ");
+    Serial.print(classifier.get_sample_count());
+    Serial.println(" kept");
+}
+
+void SerialProtocol::handle_feature_mask(const String& value) {
+    char* end = NULL;
+    unsigned long mask = strtoul(value.c_str(), &end, 0);
+    if (end == value.c_str() || *end != '\0' || mask == 0 || mask > FEATURE_MASK_ALL) {
+        Serial.println("ERROR:Feature mask must be 1..255");
+        return;
+    }
+
+    // The classifier declares what it uses; extraction follows it
+    classifier.set_feature_mask((FeatureMask)mask);
+    update_feature_extraction();
+    classifier.save_to_storage();
+
+    Serial.print("OK:Feature mask 0x");
+    Serial.print((unsigned)mask, HEX);
+    Serial.print(", ");
+    Serial.print(audio_processor.get_skipped_steps_per_frame());
+    Serial.println(" steps skipped per frame");
+}
+
+void SerialProtocol::handle_gate(const String& value) {
+    int first = value.indexOf(',');
+    int second = value.indexOf(',', first + 1);
+    if (first < 0 || second < 0) {
+        Serial.println("ERROR:Expected GATE:<stage>,<open>,<close>");
+        return;
+    }
+
+    String stage = value.substring(0, first);
+    HysteresisGate* gate = NULL;
+    if (stage == "energy") {
+        gate = &cascade.energy_gate();
+    } else if (stage == "spectral") {
+        gate = &cascade.spectral_gate();
+    } else {
+        Serial.println("ERROR:Gate stage must be energy or spectral");
+        return;
+    }
+
+    gate->set_levels(value.substring(first + 1, second).toFloat(), value.substring(second + 1).toFloat());
+    cascade.reset_stats();
+    update_feature_extraction();
+
+    Serial.print("OK:");
+    Serial.print(stage);
+    Serial.print(" gate open ");
+    Serial.print(gate->get_open_level(), 6);
+    Serial.print(" close ");
+    Serial.println(gate->get_close_level(), 6);
+}
+
+void SerialProtocol::handle_smoothing(const String& value) {
+    int first = value.indexOf(',');
+    int second = value.indexOf(',', first + 1);
+    int third = value.indexOf(',', second + 1);
+    if (first < 0 || second < 0 || third < 0) {
+        Serial.println("ERROR:Expected SMOOTHING:<open>,<close>,<onset_ms>,<hold_ms>");
+        return;
+    }
+    float open_at = value.substring(0, first).toFloat();
+    float close_below = value.substring(first + 1, second).toFloat();
+    long onset = value.substring(second + 1, third).toInt();
+    long hold = value.substring(third + 1).toInt();
+    if (open_at < 0.0f || open_at > 1.0f || close_below < 0.0f || onset < 0 || hold < 0) {
+        Serial.println("ERROR:Levels must be 0..1 and times non-negative");
+        return;
+    }
+
+    end_detection();
+    detector.configure(open_at, close_below, (uint32_t)onset, (uint32_t)hold);
+
+    if (!detector.enabled()) {
+        Serial.println("OK:Smoothing off, every classification is sent");
+        return;
+    }
+    Serial.print("OK:Smoothing open ");
+    Serial.print(detector.get_open_level(), 2);
+    Serial.print(" close ");
+    Serial.print(detector.get_close_level(), 2);
+    Serial.print(" onset ");
+    Serial.print(detector.get_onset_ms());
+    Serial.print(" ms hold ");
+    Serial.print(detector.get_hold_ms());
+    Serial.println(" ms");
+}
+
+// Up to LATENCY_QUERIES training samples spread over the set
+static size_t sample_queries(AudioFeatures* queries) {
+    size_t count = classifier.get_sample_count();
+    size_t query_count = count < LATENCY_QUERIES ? count : LATENCY_QUERIES;
+    for (size_t i = 0; i < query_count; i++) {
+        float v[NUM_FEATURES];
+        classifier.get_sample_features(i * count / query_count, v);
+        AudioFeatures features = {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]};
+        queries[i] = features;
+    }
+    return query_count;
+}
+
+static float classify_latency_us(const AudioFeatures* queries, size_t count) {
+    float confidence;
+    unsigned long start = micros();
+    for (size_t i = 0; i < count; i++) {
+        classifier.classify_id(queries[i], confidence);
+    }
+    return (float)(micros() - start) / count;
+}
+
+void SerialProtocol::handle_calibration(const String& value) {
+    KnnCalibration table;
+    table.clear();
+    if (value != "off") {
+        int start = 0;
+        while (start <= (int)value.length()) {
+            int end = value.indexOf(',', start);
+            if (end < 0) {
+                end = value.length();
+            }
+            int colon = value.indexOf(':', start);
+            if (colon < 0 || colon > end || table.count == KNN_CALIBRATION_POINTS) {
+                Serial.print("ERROR:Expected CALIBRATION:<share>:<probability>,... with at most ");
+                Serial.print(KNN_CALIBRATION_POINTS);
+                Serial.println(" points, or off");
+                return;
+            }
+            table.share[table.count] = value.substring(start, colon).toFloat();
+            table.probability[table.count] = value.substring(colon + 1, end).toFloat();
+            table.count++;
+            start = end + 1;
+        }
+    }
+    if (!classifier.set_calibration(table)) {
+        Serial.println("ERROR:Shares must increase and probabilities not decrease, all 0..1");
+        return;
+    }
+    classifier.save_to_storage();
+
+    if (table.count == 0) {
+        Serial.println("OK:Calibration off");
+        return;
+    }
+    Serial.print("OK:Calibration with ");
+    Serial.print(table.count);
+    Serial.println(" points");
+}
+
+void SerialProtocol::handle_cross_validate(const String& value) {
+    if (value == "stop") {
+        cross_validation.clear();
+        Serial.println("OK:Cross-validation stopped");
+        return;
+    }
+    if (value.length() > 0) {
+        Serial.println("ERROR:Expected CROSS_VALIDATE or CROSS_VALIDATE:stop");
+        return;
+    }
+    if (!cross_validation.start(classifier)) {
+        Serial.println("ERROR:Not enough training data to cross-validate");
+        return;
+    }
+    cv_started_ms = millis();
+    cv_report_line = 0;
+
+    Serial.print("OK:Cross-validating ");
+    Serial.print(cross_validation.get_total());
+    Serial.println(" samples");
+}
+
+void SerialProtocol::poll_cross_validation() {
+    switch (cross_validation.get_state()) {
+    case CV_RUNNING: {
+        // Short slices keep up with the audio frames; the rest of the
+        // pass waits for the next loop
+        uint32_t start = micros();
+        while (cross_validation.step(classifier, CROSS_VALIDATION_STEP) &&
+               micros() - start < CROSS_VALIDATION_SLICE_US) {
+        }
+        cv_elapsed_ms = millis() - cv_started_ms;
+        break;
+    }
+    case CV_CANCELLED:
+        cross_validation.clear();
+        Serial.println("ERROR:Cross-validation cancelled, training data changed");
+        break;
+    case CV_DONE:
+        // One line per pass so a full transmit buffer never stalls the
+        // loop for the whole report
+        send_cross_validation_line();
+        break;
+    case CV_IDLE:
+        break;
+    }
+}
+
+void SerialProtocol::send_cross_validation_line() {
+    const LabelDictionary& labels = classifier.get_labels();
+    size_t count = cross_validation.get_label_count();
+    size_t line = cv_report_line++;
+
+    if (line == 0) {
+        Serial.print("CV_LABELS:");
+        for (size_t l = 0; l < count; l++) {
+            if (l > 0) {
+                Serial.print(",");
+            }
+            Serial.print(labels.name(l));
+        }
+        Serial.println();
+    } else if (line <= count) {
+        size_t t = line - 1;
+        Serial.print("CV_ROW:");
+        Serial.print(labels.name(t));
+        for (size_t p = 0; p < count; p++) {
+            Serial.print(",");
+            Serial.print(cross_validation.get_count(t, p));
+        }
+        Serial.print(",");
+        Serial.println(cross_validation.get_rejected(t));
+    } else if (line <= 2 * count) {
+        size_t t = line - count - 1;
+        Serial.print("CV_RECALL:");
+        Serial.print(labels.name(t));
+        Serial.print(",");
+        Serial.print(cross_validation.get_recall(t), 3);
+        Serial.print(",");
+        Serial.println(cross_validation.get_support(t));
+    } else {
+        Serial.print("CV:");
+        Serial.print(cross_validation.get_total());
+        Serial.print(",");
+        Serial.print(cross_validation.get_correct());
+        Serial.print(",");
+        Serial.print(cross_validation.get_accuracy(), 3);
+        Serial.print(",");
+        Serial.print(cross_validation.get_rejected_total());
+        Serial.print(",");
+        Serial.println(cv_elapsed_ms);
+        cross_validation.clear();
+    }
+}
+
+void SerialProtocol::handle_reduce(const String& value) {
+    int comma = value.indexOf(',');
+    String name = comma < 0 ? value : value.substring(0, comma);
+    long per_class = comma < 0 ? KNN_PROTOTYPES_PER_CLASS : value.substring(comma + 1).toInt();
+    ReductionMethod method;
+    if (!parse_reduction_method(name.c_str(), method) || per_class < 1 || per_class > 255) {
+        Serial.println("ERROR:Expected REDUCE:<condensed|edited|kmeans>[,<per_class 1..255>]");
+        return;
+    }
+
+    size_t count = classifier.get_sample_count();
+    if (count < MIN_TRAINING_SAMPLES) {
+        Serial.println("ERROR:Not enough training data to reduce");
+        return;
+    }
+
+    // The same queries, spread over the set, are timed before and after
+    AudioFeatures queries[LATENCY_QUERIES];
+    size_t query_count = sample_queries(queries);
+
+    // Blocks the loop for the O(n^2) accuracy pass; audio blocks that
+    // arrive meanwhile are dropped and show up in ACQ:
+    float latency_before = classify_latency_us(queries, query_count);
+    ReductionReport report;
+    if (!classifier.reduce_prototypes(method, per_class, report)) {
+        Serial.println("ERROR:Reduction would leave too few prototypes");
+        return;
+    }
+    float latency_after = classify_latency_us(queries, query_count);
+    classifier.save_to_storage();
+
+    Serial.print("REDUCE:");
+    Serial.print(reduction_method_name(method));
+    Serial.print(",");
+    Serial.print(report.samples_before);
+    Serial.print(",");
+    Serial.print(report.samples_after);
+    Serial.print(",");
+    Serial.print(report.accuracy_before, 3);
+    Serial.print(",");
+    Serial.print(report.accuracy_after, 3);
+    Serial.print(",");
+    Serial.print(latency_before, 1);
+    Serial.print(",");
+    Serial.println(latency_after, 1);
+
+    Serial.print("OK:Training set reduced to ");
+    Serial.print(report.samples_after);
+    Serial.println(" prototypes");
+}
+
+// The CNN runs on whatever spectrogram the arena holds; the time does not
+// depend on the values
+static float cnn_latency_us() {
+    KnnResult result;
+    unsigned long start = micros();
+    for (size_t i = 0; i < LATENCY_QUERIES; i++) {
+        cnn.classify_input(result);
+    }
+    return (float)(micros() - start) / LATENCY_QUERIES;
+}
+
+void SerialProtocol::handle_engine(const String& value) {
+    if (value == "cnn") {
+        if (!cnn.is_loaded()) {
+            Serial.println("ERROR:No CNN model (upload /cnn_model.bin to SPIFFS)");
+            return;
+        }
+        end_detection();
+        cnn_active = true;
+        audio_processor.set_spectrogram_enabled(true);
+        Serial.print("ENGINE:cnn,");
+        Serial.println(cnn_latency_us(), 1);
+        return;
+    }
+
+    ClassifierEngine selected;
+    if (value == "knn") {
+        selected = ENGINE_KNN;
+    } else if (value == "forest") {
+        selected = ENGINE_FOREST;
+    } else if (value == "linear") {
+        selected = ENGINE_LINEAR;
+    } else {
+        Serial.println("ERROR:Expected ENGINE:<knn|forest|linear|cnn>");
+        return;
+    }
+    if (selected == ENGINE_FOREST && !classifier.get_forest().is_loaded()) {
+        Serial.println("ERROR:No forest in this firmware (build with CLASSIFIER_FOREST)");
+        return;
+    }
+    // Label IDs are the engine's own
+    end_detection();
+    classifier.set_engine(selected);
+    cnn_active = false;
+    audio_processor.set_spectrogram_enabled(false);
+    // A forest may read other features than the k-NN mask
+    update_feature_extraction();
+
+    AudioFeatures queries[LATENCY_QUERIES];
+    size_t query_count = sample_queries(queries);
+
+    Serial.print("ENGINE:");
+    Serial.print(value);
+    Serial.print(",");
+    Serial.println(query_count > 0 ? classify_latency_us(queries, query_count) : 0.0f, 1);
+}
+
+void SerialProtocol::export_data() {
+    size_t count = classifier.get_sample_count();
+    for (size_t i = 0; i < count; i++) {
+        float v[NUM_FEATURES];
+        classifier.get_sample_features(i, v);
+        Serial.print("SAMPLE:");
+        Serial.print(classifier.get_sample_label_name(i));
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            Serial.print(",");
+            Serial.print(v[f], 6);
+        }
+        Serial.println();
+    }
+    Serial.print("OK:Exported ");
+    Serial.print(count);
+    Serial.println(" samples");
+}
+
+void SerialProtocol::send_features(const AudioFeatures& features) {
+    Serial.print("FEATURES:");
+    Serial.print(features.rms, 6);
+    Serial.print(",");
+    Serial.print(features.infrasound_energy, 6);
+    Serial.print(",");
+    Serial.print(features.low_band_energy, 6);
+    Serial.print(",");
+    Serial.print(features.mid_band_energy, 6);
+    Serial.print(",");
+    Serial.print(features.spectral_centroid, 2);
+    Serial.print(",");
+    Serial.print(features.dominant_frequency, 2);
+    Serial.print(",");
+    Serial.print(features.spectral_flux, 6);
+    Serial.print(",");
+    Serial.println(features.temporal_envelope, 6);
+}
+
+void SerialProtocol::update_feature_extraction() {
+    audio_processor.set_feature_mask(classifier.get_required_features() | cascade.get_required_features());
+}
+
+void SerialProtocol::end_detection() {
+    DetectionEvent event;
+    if (detector.finish(&event)) {
+        send_detection(event);
+    }
+}
+
+// Names of the engine that produced the result
+static const char* result_label_name(int label_id) {
+    return cnn_active ? cnn.get_label_name(label_id) : classifier.get_label_name(label_id);
+}
+
+void SerialProtocol::send_classification(const AudioFeatures& features, const KnnResult& result) {
+    (void)features;
+
+    float confidence = result.confidence;
+    const char* level = "low_confidence";
+    if (confidence > 0.5f) {
+        level = "high_confidence";
+    } else if (confidence >= 0.3f) {
+        level = "medium_confidence";
+    }
+
+    Serial.print("CLASSIFICATION:");
+    Serial.print(result_label_name(result.label_id));
+    Serial.print(",");
+    Serial.print(confidence, 2);
+    Serial.print(",");
+    Serial.print(level);
+    // Runners-up after the three fields the GUIs have always read
+    for (size_t i = 1; i < result.top_count; i++) {
+        Serial.print(",");
+        Serial.print(result_label_name(result.top[i]));
+        Serial.print(",");
+        Serial.print(result.scores[result.top[i]], 2);
+    }
+    Serial.println();
+}
+
+void SerialProtocol::send_detection(const DetectionEvent& event) {
+    Serial.print("DETECTION:");
+    Serial.print(event.type == DETECTION_START ? "start," : "end,");
+    Serial.print(result_label_name(event.label_id));
+    Serial.print(",");
+    Serial.print(event.start_ms);
+    Serial.print(",");
+    if (event.type == DETECTION_END) {
+        Serial.print(event.end_ms);
+        Serial.print(",");
+    }
+    Serial.println(event.confidence, 2);
+}
+
+void SerialProtocol::send_status() {
+    // The GUIs read the first three fields; the rest are appended
+    Serial.print("STATUS:");
+    Serial.print(classifier.get_sample_count());
+    Serial.print(",");
+    Serial.print(millis());
+    Serial.print(",");
+    Serial.print(ESP.getFreeHeap());
+    Serial.print(",");
+    Serial.print(audio_processor.get_feature_mask());
+    Serial.print(",");
+    Serial.println(audio_processor.get_skipped_steps_per_frame());
+}
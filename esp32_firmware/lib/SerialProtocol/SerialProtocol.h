@@ -0,0 +1,140 @@
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+#include <Arduino.h>
+#include "AudioProcessor.h"
+#include "KNNClassifier.h"
+#include "DetectionDecoder.h"
+#include "CrossValidation.h"
+
+// Longest a cross-validation slice may hold up the loop, and how many
+// held-out samples are classified between clock checks
+#ifndef CROSS_VALIDATION_SLICE_US
+#define CROSS_VALIDATION_SLICE_US 3000
+#endif
+#ifndef CROSS_VALIDATION_STEP
+#define CROSS_VALIDATION_STEP 4
+#endif
+
+// Line-based USB protocol shared with the Python GUIs.
+//
+// Device -> host:
+//   FEATURES:rms,infrasound,low_band,mid_band,centroid,dominant,flux,envelope
+//   CLASSIFICATION:label,confidence,level[,label,score[,label,score]]
+//                          Winner, then the runners-up among the top
+//                          KNN_TOP_LABELS with their share of the
+//                          distance-weighted vote (softmax probability for
+//                          the linear engine and the CNN). The k-NN
+//                          winner's confidence goes through CALIBRATION.
+//                          Sent with every frame for the linear engine,
+//                          with FEATURES for the others. With smoothing
+//                          on, only sent when an event starts
+//   DETECTION:start,label,start_ms,confidence
+//   DETECTION:end,label,start_ms,end_ms,peak_confidence
+//                          Smoothed detection events (see SMOOTHING);
+//                          times are device uptime
+//   CV_LABELS:label,label,...
+//   CV_ROW:true_label,predicted_0,...,predicted_n-1,rejected
+//   CV_RECALL:label,recall,support
+//   CV:samples,correct,accuracy,rejected,elapsed_ms
+//                          Leave-one-out report (see CROSS_VALIDATE): the
+//                          label order, one confusion matrix row per true
+//                          label in that order, each label's recall and
+//                          the totals, one line per loop pass
+//   STATUS:samples,uptime_ms,free_memory,feature_mask,skipped_steps_per_frame
+//   OK:<message> / ERROR:<message>
+//
+// Host -> device:
+//   LABEL:<label>          Add the latest features as a training sample
+//                          (and one SGD step of the linear engine); up to
+//                          MAX_LABELS names of KNN_LABEL_LENGTH
+//                          characters, no commas. Past the budget the
+//                          reply says whether the sample was added,
+//                          replaced an older one or was not kept
+//   SAVE_DATA              Write the training data to SPIFFS
+//   CLEAR_DATA             Remove all training data
+//   FEATURE_MASK:<mask>    Features the classifier uses (decimal or 0x hex)
+//   GATE:<stage>,<open>,<close>
+//                          Cascade gate levels, stage "energy" or "spectral";
+//                          open 0 disables the stage
+//   REDUCE:<method>[,<per_class>]
+//                          Compress the training set to prototypes, method
+//                          "condensed", "edited" or "kmeans"; replies with
+//                          REDUCE:method,samples_before,samples_after,
+//                          accuracy_before,accuracy_after,
+//                          latency_before_us,latency_after_us
+//   BUDGET:<samples>[,<per_class>]
+//                          Most training samples kept, and per label (0 or
+//                          omitted: the budget shared evenly). Full labels
+//                          keep a reservoir sample of their stream; a
+//                          smaller budget evicts at once. Saved with the
+//                          training data
+//   SMOOTHING:<open>,<close>,<onset_ms>,<hold_ms>
+//                          Detection decoder: an event starts once a label
+//                          keeps confidence >= open for onset_ms and ends
+//                          once it has not won with confidence >= close
+//                          for hold_ms; open 0 sends every classification
+//   CALIBRATION:<share>:<probability>[,<share>:<probability>...]
+//   CALIBRATION:off        k-NN confidence table from tools/knn_calibrator:
+//                          up to KNN_CALIBRATION_POINTS knots, shares
+//                          increasing and probabilities non-decreasing,
+//                          all 0..1. Saved with the training data; cleared
+//                          by CLEAR_DATA and REDUCE
+//   ENGINE:<knn|forest|linear|cnn>
+//                          Classifier engine; "forest" needs a firmware
+//                          built with CLASSIFIER_FOREST, "cnn" a model in
+//                          SPIFFS /cnn_model.bin. Replies with
+//                          ENGINE:name,latency_us
+//   CROSS_VALIDATE         Leave-one-out k-NN accuracy of the training set,
+//                          run in slices between audio frames; replies
+//                          OK, then the CV_ report when done. Changing the
+//                          training data cancels it with an ERROR
+//   CROSS_VALIDATE:stop    Cancel a running pass
+//   EXPORT_DATA            Print every training sample as
+//                          SAMPLE:label,rms,...,envelope (the input of
+//                          tools/forest_trainer and tools/linear_trainer),
+//                          then OK:Exported <n> samples
+class SerialProtocol {
+public:
+    void initialize();
+
+    // Read pending characters and run any complete command line
+    void handle_input();
+
+    void send_features(const AudioFeatures& features);
+    void send_classification(const AudioFeatures& features, const KnnResult& result);
+    void send_detection(const DetectionEvent& event);
+    void send_status();
+
+    // Advance a running cross-validation by one time slice, or send the
+    // next line of its report. Call every loop pass.
+    void poll_cross_validation();
+
+    // Extract the features the classifier reads plus those the spectral
+    // gate needs; call whenever either changes
+    void update_feature_extraction();
+
+private:
+    String input_buffer;
+    CrossValidation cross_validation;
+    uint32_t cv_started_ms;
+    uint32_t cv_elapsed_ms;
+    size_t cv_report_line;         // Next report line to send
+
+    void process_command(const String& command);
+    void handle_label(const String& label);
+    void handle_feature_mask(const String& value);
+    void handle_gate(const String& value);
+    void handle_smoothing(const String& value);
+    void handle_calibration(const String& value);
+    void handle_reduce(const String& value);
+    void handle_budget(const String& value);
+    void handle_engine(const String& value);
+    void handle_cross_validate(const String& value);
+    void send_cross_validation_line();
+    void export_data();
+    // Close the open detection event before label IDs change meaning
+    void end_detection();
+};
+
+#endif
@@ -2,8 +2,18 @@
 #include <FS.h>
 #include <SPIFFS.h>
 #include "AudioProcessor.h"
+#include "ProcessingCascade.h"
 #include "KNNClassifier.h"
+#include "CnnClassifier.h"
+#include "DetectionDecoder.h"
 #include "SerialProtocol.h"
+#include "AudioAcquisition.h"
+#if CLASSIFIER_FOREST
+#include "ForestModel.h"   // Generated by tools/forest_trainer
+#endif
+#if CLASSIFIER_LINEAR
+#include "LinearWeights.h" // Generated by tools/linear_trainer
+#endif
 
 // Pin definitions
 #define MIC_PIN 34         // Analog microphone pin (capacitor/electret mic)
@@ -14,15 +24,20 @@
 #define CLASSIFICATION_INTERVAL 256  // ms between classifications (frame size)
 
 // Global objects
+TimerAdcSource adc_source(ADC1_CHANNEL_6);  // GPIO34
+AcquisitionEngine acquisition;
 AudioProcessor audio_processor;
+ProcessingCascade cascade;
 KNNClassifier classifier;
+CnnClassifier cnn;
+DetectionDecoder detector;
 SerialProtocol serial_protocol;
 
 // Global variables for communication with SerialProtocol
 AudioFeatures last_features;
-String last_classification = "unknown";
-float last_confidence = 0.0;
+KnnResult last_result;
 bool has_new_features = false;
+bool cnn_active = false;      // CNN on the spectrogram instead of classifier
 
 // Timing variables
 unsigned long last_classification_time = 0;
@@ -32,6 +47,10 @@ unsigned long last_status_print = 0;
 void init_analog_microphone();
 void read_analog_samples();
 void process_audio_frame();
+void send_acquisition_stats();
+void send_cascade_stats();
+void send_search_stats();
+void report_dsp_benchmark();
 
 void setup() {
     Serial.begin(115200);
@@ -49,7 +68,10 @@ void setup() {
     
     // Initialize audio processor with improved feature extraction
     audio_processor.initialize();
-    Serial.println("Audio processor initialized (1kHz, 256-sample frames, enhanced frequency detection)");
+    Serial.print("Audio processor initialized (1kHz, 256-sample window, hop ");
+    Serial.print(audio_processor.get_hop_size());
+    Serial.println(" samples, enhanced frequency detection)");
+    report_dsp_benchmark();
     
     // Initialize classifier
     classifier.initialize();
@@ -61,6 +83,51 @@ void setup() {
     } else {
         Serial.println("No existing data found, starting fresh");
     }
+#if CLASSIFIER_FOREST
+    // Training samples stay loaded so LABEL and EXPORT_DATA keep working
+    // and ENGINE:knn can switch back
+    if (classifier.load_forest(&FOREST_MODEL) && classifier.set_engine(ENGINE_FOREST)) {
+        Serial.print("Forest engine: ");
+        Serial.print(FOREST_MODEL.tree_count);
+        Serial.println(" trees");
+    } else {
+        Serial.println("ERROR:Forest model rejected, using k-NN");
+    }
+#endif
+#if CLASSIFIER_LINEAR
+    // The offline weights seed the engine. LABEL refines them and they are
+    // saved with the training data, so they only replace untrained ones.
+    if (classifier.get_linear().get_sample_count() == 0 && !classifier.load_linear(&LINEAR_MODEL)) {
+        Serial.println("ERROR:Linear model rejected (label table full)");
+    }
+    classifier.set_engine(ENGINE_LINEAR);
+    Serial.print("Linear engine: ");
+    Serial.print(classifier.get_label_count());
+    Serial.print(" labels, ");
+    Serial.print(classifier.get_linear().get_sample_count());
+    Serial.println(" samples");
+#endif
+    
+    // A CNN model uploaded to SPIFFS takes over from the feature engines
+    if (cnn.load_from_storage()) {
+        cnn_active = true;
+        audio_processor.set_spectrogram_enabled(true);
+        Serial.print("CNN engine: ");
+        Serial.print(cnn.get_model().get_layer_count());
+        Serial.print(" layers, arena ");
+        Serial.print(cnn.get_model().get_arena_required());
+        Serial.print(" of ");
+        Serial.print(CNN_ARENA_SIZE);
+        Serial.println(" bytes");
+    }
+    
+    // Only extract the features the active model and the cascade use
+    serial_protocol.update_feature_extraction();
+    Serial.print("Feature mask 0x");
+    Serial.print(audio_processor.get_feature_mask(), HEX);
+    Serial.print(" (");
+    Serial.print(audio_processor.get_skipped_steps_per_frame());
+    Serial.println(" steps skipped per frame)");
     
     // Initialize serial protocol
     serial_protocol.initialize();
@@ -82,20 +149,28 @@ void loop() {
     
     // Process audio frame for classification
     process_audio_frame();
+
+    // A slice of any leave-one-out pass, between frames
+    serial_protocol.poll_cross_validation();
+    
+    // End a detection whose label has gone quiet, also while the cascade
+    // keeps the classifier idle
+    DetectionEvent event;
+    if (detector.tick(millis(), &event)) {
+        serial_protocol.send_detection(event);
+    }
     
     // Send periodic status updates
     if (millis() - last_status_print > 5000) {  // Every 5 seconds
         serial_protocol.send_status();
+        send_acquisition_stats();
+        send_cascade_stats();
+        send_search_stats();
         last_status_print = millis();
     }
 }
 
 void init_analog_microphone() {
-    // Configure ADC for microphone input
-    analogReadResolution(12);  // 12-bit resolution (0-4095)
-    analogSetAttenuation(ADC_11db);  // For 3.3V reference, allows 0-3.3V input
-    analogSetPinAttenuation(MIC_PIN, ADC_11db);
-    
     // Optional: Enable microphone power pin
     if (MIC_VCC_PIN > 0) {
         pinMode(MIC_VCC_PIN, OUTPUT);
@@ -107,67 +182,158 @@ void init_analog_microphone() {
     Serial.println("- GPIO34 (ADC1_CH6) for audio input");
     Serial.println("- 12-bit resolution (0-4095)");
     Serial.println("- 11dB attenuation (0-3.3V range)");
-    Serial.println("- 1kHz sampling rate (1ms intervals)");
+    Serial.println("- 1kHz sampling rate (hardware timer paced)");
     Serial.println("- Enhanced frequency detection (10-200Hz optimized)");
+    
+    // Start timer-driven acquisition (ADC width/attenuation set by the source)
+    if (!acquisition.begin(&adc_source, SAMPLE_RATE)) {
+        Serial.println("ERROR:Audio acquisition failed to start");
+    }
 }
 
 void read_analog_samples() {
-    static unsigned long last_sample_time = 0;
+    // Samples are captured by the acquisition engine at a fixed rate and
+    // queued in its ring. Drain them in bulk straight into the current
+    // frame; whatever does not fit stays queued for the next frame.
+    SampleRing& ring = acquisition.samples();
+    const int16_t* data;
+    size_t available;
     
-    // Sample at exactly 1kHz (1ms intervals)
-    if (millis() - last_sample_time >= 1) {
-        last_sample_time = millis();
-        
-        // Read ADC value
-        int raw_value = analogRead(MIC_PIN);
-        
-        // Convert to voltage (0-3.3V range with 12-bit ADC)
-        float voltage = (raw_value * 3.3) / 4095.0;
-        
-        // Convert to signed 16-bit for audio processing
-        // Center around 0 (assuming 1.65V DC bias)
-        int16_t sample = (int16_t)((voltage - 1.65) * 10000);  // Scale for processing
-        
-        // Add sample to audio processor
-        audio_processor.add_sample(sample);
+    while (!audio_processor.is_frame_ready() && (available = ring.peek(data)) > 0) {
+        ring.consume(audio_processor.add_samples(data, available));
     }
 }
 
+void send_acquisition_stats() {
+    AcquisitionStats stats = acquisition.get_stats();
+    
+    // ACQ:samples,blocks,dropped_blocks,missed_ticks,ring_high_water,ring_capacity
+    Serial.print("ACQ:");
+    Serial.print(stats.samples_acquired);
+    Serial.print(",");
+    Serial.print(stats.blocks_completed);
+    Serial.print(",");
+    Serial.print(stats.blocks_dropped);
+    Serial.print(",");
+    Serial.print(stats.ticks_missed);
+    Serial.print(",");
+    Serial.print(stats.ring_high_water);
+    Serial.print(",");
+    Serial.println(stats.ring_capacity);
+}
+
+void send_cascade_stats() {
+    CascadeStats stats = cascade.get_stats();
+    
+    // CASCADE:frames,energy_rejected,spectral_rejected,spectral_passed,classified
+    Serial.print("CASCADE:");
+    Serial.print(stats.frames);
+    Serial.print(",");
+    Serial.print(stats.energy_rejected);
+    Serial.print(",");
+    Serial.print(stats.spectral_rejected);
+    Serial.print(",");
+    Serial.print(stats.spectral_passed);
+    Serial.print(",");
+    Serial.println(stats.classified);
+}
+
+void send_search_stats() {
+    const KnnSearchStats& stats = classifier.get_search_stats();
+    
+    // KNN_SEARCH:queries,candidates,dims_evaluated,labels_skipped since the
+    // last line; dims_evaluated / candidates is the average per candidate
+    Serial.print("KNN_SEARCH:");
+    Serial.print(stats.queries);
+    Serial.print(",");
+    Serial.print(stats.candidates);
+    Serial.print(",");
+    Serial.print(stats.dims_evaluated);
+    Serial.print(",");
+    Serial.println(stats.labels_skipped);
+    classifier.reset_search_stats();
+}
+
 void process_audio_frame() {
     static unsigned long last_feature_time = 0;
     const unsigned long FEATURE_INTERVAL = 800;  // Send features every 800ms (1.25 Hz)
     
     AudioFeatures features;
     
-    // Extract features if frame is ready
+    // Stage 1: while the per-sample infrasound trace keeps the energy gate
+    // closed, drop the frame without running the FFT or the classifier
+    if (audio_processor.is_frame_ready() && !cascade.admit_frame(audio_processor.get_infrasound_trace())) {
+        audio_processor.skip_frame();
+        return;
+    }
+    
+    // Stage 2: extract features if frame is ready
     if (audio_processor.extract_features(features)) {
         // Store features globally
         last_features = features;
         has_new_features = true;
         
+        // Evaluated every frame so its hysteresis follows the signal
+        bool run_classifier = cascade.admit_features(features);
+        
         // Rate limit the feature transmission
-        if (millis() - last_feature_time >= FEATURE_INTERVAL) {
+        bool send_now = millis() - last_feature_time >= FEATURE_INTERVAL;
+        if (send_now) {
             // Send features via USB (features only)
             serial_protocol.send_features(features);
-            
-            // Perform classification
-            String classification = classifier.classify(features, last_confidence);
-            
-            // Ensure we have a valid classification
-            if (classification.length() == 0) {
-                classification = "not_elephant";  // Fallback
-            }
-            
-            last_classification = classification;
-            last_classification_time = millis();
-            
-            // Send classification result via USB (separate message)
-            serial_protocol.send_classification(features, classification, last_confidence);
-            
             last_feature_time = millis();
         }
         
-        // Reset audio buffer for next frame
-        audio_processor.reset_buffer();
+        // The linear engine is a few dot products, so it classifies every
+        // frame; the others keep to the feature interval
+        bool every_frame = !cnn_active && classifier.get_engine() == ENGINE_LINEAR;
+        
+        // Stage 3: classifier only when the spectral pre-check passed
+        if (!run_classifier || !(send_now || every_frame)) {
+            return;
+        }
+        
+        // Perform classification (label ID and scores; no heap allocation)
+        if (cnn_active) {
+            cnn.classify(audio_processor, last_result);
+        } else {
+            classifier.classify(features, last_result);
+        }
+        cascade.record_classification();
+        last_classification_time = millis();
+        
+        // Send classification result via USB (separate message), or only
+        // the detection events it causes when smoothing is on
+        if (!detector.enabled()) {
+            serial_protocol.send_classification(features, last_result);
+            return;
+        }
+        DetectionEvent events[DETECTION_MAX_EVENTS];
+        size_t count = detector.update(last_result, millis(), events);
+        for (size_t i = 0; i < count; i++) {
+            serial_protocol.send_detection(events[i]);
+            // The GUIs count CLASSIFICATION lines, so they see one per event
+            if (events[i].type == DETECTION_START) {
+                serial_protocol.send_classification(features, last_result);
+            }
+        }
+    }
+}
+
+void report_dsp_benchmark() {
+    KernelTiming timings[DSP_KERNEL_COUNT];
+    size_t count = DspKernels::benchmark<FFT_SIZE>(timings);
+    
+    Serial.print("DSP backend: ");
+    Serial.println(DspKernels::backend_name());
+    
+    // DSP_BENCH:kernel,scalar_cycles,backend_cycles
+    for (size_t i = 0; i < count; i++) {
+        Serial.print("DSP_BENCH:");
+        Serial.print(timings[i].name);
+        Serial.print(",");
+        Serial.print(timings[i].scalar_cycles);
+        Serial.print(",");
+        Serial.println(timings[i].backend_cycles);
     }
 }
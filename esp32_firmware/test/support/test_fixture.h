@@ -0,0 +1,81 @@
+#ifndef TEST_FIXTURE_H
+#define TEST_FIXTURE_H
+
+// Shared by the host tests: a heap counter, a deterministic generator and
+// the three-cluster training set. Include from exactly one file per test,
+// since it defines the global operator new.
+
+#include <unity.h>
+#include <stdlib.h>
+#include <new>
+#include "KNNClassifier.h"
+
+// Counts every global operator new so tests can assert a code path never
+// touches the heap
+static volatile size_t heap_allocations = 0;
+
+void* operator new(size_t size) {
+    heap_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// Deterministic LCG so every host produces the same data
+static uint32_t rng_state;
+
+static inline uint32_t next_random() {
+    rng_state = rng_state * 1664525UL + 1013904223UL;
+    return rng_state >> 8;
+}
+
+// Features near the documented means, on a coarse grid so that exact
+// distance ties between samples are common
+static inline AudioFeatures make_features(int cluster) {
+    static const float mean[NUM_FEATURES] = {0.025f, 1.0f, 0.06f, 0.005f, 85.0f, 50.0f, 0.2f, 0.25f};
+    static const float step[NUM_FEATURES] = {0.004f, 0.2f, 0.015f, 0.001f, 7.5f, 12.5f, 0.05f, 0.04f};
+    float v[NUM_FEATURES];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        int offset = (int)(next_random() % 9) - 4 + (cluster - 1) * 3;
+        v[f] = mean[f] + offset * step[f];
+    }
+    AudioFeatures features = {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]};
+    return features;
+}
+
+static const char* const LABELS[3] = {"elephant", "not_elephant", "vehicle"};
+
+// count samples of the three clusters from a fixed seed. Each add_sample()
+// is also one SGD step of the linear engine, as on a LABEL command.
+static inline void fill(KNNClassifier& classifier, size_t count) {
+    classifier.initialize();
+    rng_state = 12345;
+    for (size_t i = 0; i < count; i++) {
+        int cluster = next_random() % 3;
+        TEST_ASSERT_TRUE(classifier.add_sample(make_features(cluster), LABELS[cluster]));
+    }
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include <unity.h>
+#include "AudioAcquisition.h"
+
+static const uint32_t RATE = 1000;
+
+// 12-bit ramp, so every sample's position can be checked after the ring
+static uint16_t ramp(uint32_t sample_index, void*) {
+    return (uint16_t)((sample_index * 7) & 0xFFF);
+}
+
+// Pops everything in the ring, checks it continues the ramp from *next and
+// adds the count to *drained
+static void drain_and_check(AcquisitionEngine& engine, uint32_t* next, size_t* drained) {
+    int16_t block[ACQ_BLOCK_SIZE];
+    size_t n;
+    while ((n = engine.samples().pop(block, ACQ_BLOCK_SIZE)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            int16_t expected = AcquisitionEngine::raw_to_sample(ramp((*next)++, nullptr));
+            TEST_ASSERT_EQUAL_INT16(expected, block[i]);
+        }
+        *drained += n;
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_begin_rejects_bad_arguments() {
+    AcquisitionEngine engine;
+    SyntheticSampleSource source(ramp);
+    SyntheticSampleSource no_generator(nullptr);
+    TEST_ASSERT_FALSE(engine.begin(nullptr, RATE));
+    TEST_ASSERT_FALSE(engine.begin(&source, 0));
+    TEST_ASSERT_FALSE(engine.begin(&no_generator, RATE));
+    TEST_ASSERT_TRUE(engine.begin(&source, RATE));
+    TEST_ASSERT_EQUAL(RATE, engine.get_sample_rate());
+    engine.end();
+}
+
+// Steps that are not a whole number of sample periods: the synthetic clock
+// must not drift, and only completed blocks reach the ring
+void test_blocks_counted_at_sample_rate() {
+    AcquisitionEngine engine;
+    SyntheticSampleSource source(ramp);
+    TEST_ASSERT_TRUE(engine.begin(&source, RATE));
+
+    uint32_t next = 0;
+    size_t drained = 0;
+    for (int step = 0; step < 3000; step++) {
+        source.advance(333);
+        drain_and_check(engine, &next, &drained);
+    }
+    AcquisitionStats stats = engine.get_stats();
+    TEST_ASSERT_EQUAL(999, source.get_sample_index());
+    TEST_ASSERT_EQUAL(999, stats.samples_acquired);
+    TEST_ASSERT_EQUAL(999 / ACQ_BLOCK_SIZE, stats.blocks_completed);
+    TEST_ASSERT_EQUAL(stats.blocks_completed * ACQ_BLOCK_SIZE, drained);
+    TEST_ASSERT_EQUAL(0, stats.blocks_dropped);
+    TEST_ASSERT_EQUAL(0, stats.ticks_missed);
+    TEST_ASSERT_EQUAL(ACQ_BLOCK_SIZE, stats.ring_high_water);
+    TEST_ASSERT_EQUAL(ACQ_BLOCK_SIZE * ACQ_BLOCK_COUNT, stats.ring_capacity);
+    engine.end();
+}
+
+// A consumer stall longer than the ring: the blocks that fit are kept in
+// order, every later block is dropped whole, and acquisition recovers once
+// the ring is drained
+void test_full_ring_drops_blocks() {
+    AcquisitionEngine engine;
+    SyntheticSampleSource source(ramp);
+    TEST_ASSERT_TRUE(engine.begin(&source, RATE));
+
+    const uint32_t blocks = 2 * ACQ_BLOCK_COUNT + 3;
+    source.advance(blocks * ACQ_BLOCK_SIZE * 1000000ULL / RATE);
+    AcquisitionStats stats = engine.get_stats();
+    TEST_ASSERT_EQUAL(blocks, stats.blocks_completed);
+    TEST_ASSERT_EQUAL(blocks - ACQ_BLOCK_COUNT, stats.blocks_dropped);
+    TEST_ASSERT_EQUAL(blocks - ACQ_BLOCK_COUNT, engine.samples().get_overrun_count());
+    TEST_ASSERT_EQUAL((blocks - ACQ_BLOCK_COUNT) * ACQ_BLOCK_SIZE, engine.samples().get_dropped_count());
+    TEST_ASSERT_EQUAL(stats.ring_capacity, stats.ring_high_water);
+
+    uint32_t next = 0;
+    size_t drained = 0;
+    drain_and_check(engine, &next, &drained);
+    TEST_ASSERT_EQUAL(ACQ_BLOCK_COUNT * ACQ_BLOCK_SIZE, drained);
+
+    // The next block starts where the clock is, not where the ring stopped
+    source.advance(ACQ_BLOCK_SIZE * 1000000ULL / RATE);
+    next = blocks * ACQ_BLOCK_SIZE;
+    drained = 0;
+    drain_and_check(engine, &next, &drained);
+    TEST_ASSERT_EQUAL(ACQ_BLOCK_SIZE, drained);
+    TEST_ASSERT_EQUAL(blocks - ACQ_BLOCK_COUNT, engine.get_stats().blocks_dropped);
+    engine.end();
+}
+
+// Missed ticks are reported by the source, never turned into samples, and
+// cleared with the other statistics
+void test_missed_ticks_are_counted() {
+    AcquisitionEngine engine;
+    SyntheticSampleSource source(ramp);
+    TEST_ASSERT_TRUE(engine.begin(&source, RATE));
+
+    source.advance(10000);
+    engine.on_missed_ticks(3);
+    engine.on_missed_ticks(2);
+    AcquisitionStats stats = engine.get_stats();
+    TEST_ASSERT_EQUAL(5, stats.ticks_missed);
+    TEST_ASSERT_EQUAL(10, stats.samples_acquired);
+
+    engine.reset_stats();
+    stats = engine.get_stats();
+    TEST_ASSERT_EQUAL(0, stats.ticks_missed);
+    TEST_ASSERT_EQUAL(0, stats.samples_acquired);
+
+    engine.on_missed_ticks(4);
+    TEST_ASSERT_TRUE(engine.begin(&source, RATE));
+    TEST_ASSERT_EQUAL(0, engine.get_stats().ticks_missed);
+    engine.end();
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_rejects_bad_arguments);
+    RUN_TEST(test_blocks_counted_at_sample_rate);
+    RUN_TEST(test_full_ring_drops_blocks);
+    RUN_TEST(test_missed_ticks_are_counted);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -0,0 +1,489 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include "CnnClassifier.h"
+#include "../support/test_fixture.h"
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+static int random_in(int lo, int hi) {
+    return lo + (int)(next_random() % (uint32_t)(hi - lo + 1));
+}
+
+// One layer as the reference sees it: plain vectors, no arena
+struct RefLayer {
+    CnnLayerHeader header;
+    std::vector<int8_t> weights;
+    std::vector<int32_t> bias;
+    std::vector<int32_t> multiplier;
+    std::vector<int8_t> shift;
+};
+
+struct RefModel {
+    int frames;
+    int bins;
+    int8_t input_zero_point;
+    float output_scale;
+    std::vector<const char*> labels;
+    std::vector<RefLayer> layers;
+};
+
+static void append(std::vector<uint8_t>& blob, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    blob.insert(blob.end(), bytes, bytes + size);
+    while (blob.size() % 4 != 0) {
+        blob.push_back(0);
+    }
+}
+
+static std::vector<uint8_t> write_blob(const RefModel& model) {
+    std::vector<uint8_t> blob;
+    CnnBlobHeader header = {};
+    header.magic = CNN_BLOB_MAGIC;
+    header.version = CNN_BLOB_VERSION;
+    header.layer_count = model.layers.size();
+    header.label_count = model.labels.size();
+    header.input_frames = model.frames;
+    header.input_bins = model.bins;
+    header.input_zero_point = model.input_zero_point;
+    header.output_scale = model.output_scale;
+    append(blob, &header, sizeof(header));
+    for (const char* label : model.labels) {
+        char name[CNN_LABEL_BYTES] = {0};
+        strncpy(name, label, CNN_LABEL_BYTES - 1);
+        append(blob, name, sizeof(name));
+    }
+    for (const RefLayer& layer : model.layers) {
+        append(blob, &layer.header, sizeof(layer.header));
+        if (!layer.weights.empty()) {
+            append(blob, layer.weights.data(), layer.weights.size());
+            append(blob, layer.bias.data(), layer.bias.size() * sizeof(int32_t));
+            append(blob, layer.multiplier.data(), layer.multiplier.size() * sizeof(int32_t));
+            append(blob, layer.shift.data(), layer.shift.size());
+        }
+    }
+    return blob;
+}
+
+// Adds a layer with random parameters. The shift is chosen from the
+// window size so outputs spread over the int8 range instead of saturating.
+static void add_layer(RefModel& model, int& frames, int& channels, uint8_t type,
+                      int kernel, int stride, int out_channels, bool relu) {
+    RefLayer layer;
+    memset(&layer.header, 0, sizeof(layer.header));
+    layer.header.type = type;
+    layer.header.kernel = kernel;
+    layer.header.stride = stride;
+    layer.header.out_channels = out_channels;
+
+    int8_t in_zero_point = model.layers.empty() ? model.input_zero_point : model.layers.back().header.output_zero_point;
+    int window = 0;
+    int outputs = channels;
+    switch (type) {
+    case CNN_CONV1D:
+        window = kernel * channels;
+        outputs = out_channels;
+        break;
+    case CNN_DEPTHWISE:
+        window = kernel;
+        break;
+    case CNN_DENSE:
+        window = frames * channels;
+        outputs = out_channels;
+        kernel = frames;
+        stride = 1;
+        break;
+    default:
+        if (kernel == 0) {
+            kernel = frames;
+            stride = 1;
+        }
+        break;
+    }
+
+    if (window > 0) {
+        layer.header.output_zero_point = random_in(-20, 20);
+        layer.header.act_min = relu ? layer.header.output_zero_point : -128;
+        layer.header.act_max = 127;
+        int weight_count = type == CNN_DEPTHWISE ? kernel * channels : outputs * window;
+        for (int i = 0; i < weight_count; i++) {
+            layer.weights.push_back(random_in(-127, 127));
+        }
+        // Accumulator std ~ sqrt(window) * 73 * 73; aim for ~40 at the output
+        int shift = (int)lround(log2(sqrt((double)window) * 5300.0 / 40.0)) - 1;
+        for (int o = 0; o < outputs; o++) {
+            layer.bias.push_back(random_in(-4000, 4000));
+            layer.multiplier.push_back((int32_t)(0x40000000 + next_random() % 0x40000000));
+            layer.shift.push_back(shift + random_in(-1, 1));
+        }
+    } else {
+        // Pools keep the quantization
+        layer.header.output_zero_point = in_zero_point;
+        layer.header.act_min = -128;
+        layer.header.act_max = 127;
+    }
+
+    frames = (frames - kernel) / stride + 1;
+    channels = outputs;
+    model.layers.push_back(layer);
+}
+
+// floor((acc * multiplier + 2^(total - 1)) / 2^total), by division
+static int32_t reference_requantize(int64_t acc, int32_t multiplier, int shift) {
+    int total = 31 + shift;
+    int64_t numerator = acc * multiplier + ((int64_t)1 << (total - 1));
+    int64_t divisor = (int64_t)1 << total;
+    int64_t quotient = numerator / divisor;
+    if (numerator % divisor != 0 && numerator < 0) {
+        quotient--;
+    }
+    return (int32_t)quotient;
+}
+
+static int8_t reference_output(int64_t acc, const RefLayer& layer, int c) {
+    int32_t value = layer.header.output_zero_point + reference_requantize(acc, layer.multiplier[c], layer.shift[c]);
+    value = value < layer.header.act_min ? layer.header.act_min : value;
+    value = value > layer.header.act_max ? layer.header.act_max : value;
+    return (int8_t)value;
+}
+
+// Straight from the layer definitions, one output element at a time
+static std::vector<int8_t> reference_run(const RefModel& model, const int8_t* input) {
+    int frames = model.frames;
+    int channels = model.bins;
+    int zero_point = model.input_zero_point;
+    std::vector<int8_t> x(input, input + frames * channels);
+
+    for (const RefLayer& layer : model.layers) {
+        int kernel = layer.header.kernel;
+        int stride = layer.header.stride;
+        std::vector<int8_t> y;
+        int out_frames = 0;
+        int out_channels = channels;
+
+        if (layer.header.type == CNN_DENSE) {
+            out_frames = 1;
+            out_channels = layer.header.out_channels;
+            int inputs = frames * channels;
+            for (int o = 0; o < out_channels; o++) {
+                int64_t acc = layer.bias[o];
+                for (int i = 0; i < inputs; i++) {
+                    acc += (int64_t)(x[i] - zero_point) * layer.weights[o * inputs + i];
+                }
+                y.push_back(reference_output(acc, layer, o));
+            }
+        } else {
+            if (kernel == 0) {
+                kernel = frames;
+                stride = 1;
+            }
+            out_frames = (frames - kernel) / stride + 1;
+            if (layer.header.type == CNN_CONV1D) {
+                out_channels = layer.header.out_channels;
+            }
+            for (int t = 0; t < out_frames; t++) {
+                for (int o = 0; o < out_channels; o++) {
+                    int64_t acc = 0;
+                    int best = -129;
+                    for (int k = 0; k < kernel; k++) {
+                        int row = t * stride + k;
+                        switch (layer.header.type) {
+                        case CNN_CONV1D:
+                            for (int c = 0; c < channels; c++) {
+                                acc += (int64_t)(x[row * channels + c] - zero_point) *
+                                       layer.weights[(o * kernel + k) * channels + c];
+                            }
+                            break;
+                        case CNN_DEPTHWISE:
+                            acc += (int64_t)(x[row * channels + o] - zero_point) * layer.weights[k * channels + o];
+                            break;
+                        case CNN_MAX_POOL:
+                            best = x[row * channels + o] > best ? x[row * channels + o] : best;
+                            break;
+                        case CNN_AVG_POOL:
+                            acc += x[row * channels + o];
+                            break;
+                        }
+                    }
+                    if (layer.header.type == CNN_MAX_POOL) {
+                        y.push_back((int8_t)best);
+                    } else if (layer.header.type == CNN_AVG_POOL) {
+                        y.push_back((int8_t)lround((double)acc / kernel));
+                    } else {
+                        y.push_back(reference_output(acc + layer.bias[o], layer, o));
+                    }
+                }
+            }
+        }
+
+        x = y;
+        frames = out_frames;
+        channels = out_channels;
+        zero_point = layer.header.output_zero_point;
+    }
+    return x;
+}
+
+static const char* CNN_LABELS[3] = {"rumble", "vehicle", "background"};
+
+// A network in the intended shape: strided conv over the spectrogram,
+// depthwise, max pool, conv, global average pool, dense to the labels
+static RefModel make_model(uint32_t seed, int frames) {
+    rng_state = seed;
+    RefModel model;
+    model.frames = frames;
+    model.bins = SPECTROGRAM_BINS;
+    model.input_zero_point = random_in(-10, 10);
+    model.output_scale = 0.05f;
+    model.labels.assign(CNN_LABELS, CNN_LABELS + 3);
+
+    int t = frames;
+    int c = SPECTROGRAM_BINS;
+    add_layer(model, t, c, CNN_CONV1D, 5, 2, 16, true);
+    add_layer(model, t, c, CNN_DEPTHWISE, 3, 1, 0, true);
+    add_layer(model, t, c, CNN_MAX_POOL, 2, 2, 0, false);
+    add_layer(model, t, c, CNN_CONV1D, 3, 1, 24, true);
+    add_layer(model, t, c, CNN_AVG_POOL, 0, 0, 0, false);
+    add_layer(model, t, c, CNN_DENSE, 0, 0, 3, false);
+    return model;
+}
+
+static void random_input(int8_t* input, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        input[i] = (int8_t)random_in(-128, 127);
+    }
+}
+
+// 24 KB of blob and arena; one instance for the whole run
+static CnnClassifier cnn;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_requantize_rounds_half_up() {
+    // Multiplier 2^30 at shift 0 halves the accumulator
+    TEST_ASSERT_EQUAL_INT32(2, Int8Kernels::requantize(3, 1 << 30, 0));
+    TEST_ASSERT_EQUAL_INT32(-1, Int8Kernels::requantize(-3, 1 << 30, 0));
+    TEST_ASSERT_EQUAL_INT32(-2, Int8Kernels::requantize(-5, 1 << 30, 0));
+    // Negative shift scales up; the largest accumulators stay exact in 64 bits
+    TEST_ASSERT_EQUAL_INT32(6, Int8Kernels::requantize(3, 1 << 30, -2));
+    for (int i = 0; i < 1000; i++) {
+        int32_t acc = (int32_t)(next_random() << 8);
+        int32_t multiplier = (int32_t)(0x40000000 + next_random() % 0x40000000);
+        int shift = random_in(-8, 31);
+        TEST_ASSERT_EQUAL_INT32(reference_requantize(acc, multiplier, shift),
+                                Int8Kernels::requantize(acc, multiplier, shift));
+    }
+}
+
+// Every output of several random networks must match the reference
+// bit for bit
+void test_network_matches_reference() {
+    static int8_t input[SPECTROGRAM_FRAMES * SPECTROGRAM_BINS];
+    int saturated = 0;
+    int outputs = 0;
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        RefModel model = make_model(seed, 20 + seed);
+        std::vector<uint8_t> blob = write_blob(model);
+        TEST_ASSERT_TRUE(cnn.load(blob.data(), blob.size()));
+        TEST_ASSERT_EQUAL(model.frames, cnn.get_input_frames());
+
+        for (int q = 0; q < 20; q++) {
+            random_input(input, model.frames * model.bins);
+            memcpy(cnn.input_tensor(), input, model.frames * model.bins);
+            const int8_t* actual = cnn.invoke();
+            std::vector<int8_t> expected = reference_run(model, input);
+            TEST_ASSERT_EQUAL(3, expected.size());
+            TEST_ASSERT_EQUAL_INT8_ARRAY(expected.data(), actual, expected.size());
+            for (int8_t v : expected) {
+                saturated += v == -128 || v == 127;
+                outputs++;
+            }
+        }
+    }
+    // The parameters exercise the arithmetic rather than clamping it away
+    TEST_ASSERT_TRUE(saturated < outputs / 4);
+}
+
+void test_rejects_malformed_blobs() {
+    RefModel model = make_model(3, SPECTROGRAM_FRAMES);
+    std::vector<uint8_t> blob = write_blob(model);
+    TEST_ASSERT_TRUE(cnn.load(blob.data(), blob.size()));
+
+    // Truncated, or with trailing bytes
+    TEST_ASSERT_FALSE(cnn.load(blob.data(), blob.size() - 4));
+    TEST_ASSERT_FALSE(cnn.is_loaded());
+    std::vector<uint8_t> longer = blob;
+    longer.resize(blob.size() + 4, 0);
+    TEST_ASSERT_FALSE(cnn.load(longer.data(), longer.size()));
+
+    std::vector<uint8_t> bad = blob;
+    bad[0] ^= 1;
+    TEST_ASSERT_FALSE(cnn.load(bad.data(), bad.size()));
+
+    // The last layer must produce one logit per label
+    RefModel wrong = model;
+    wrong.labels.push_back("extra");
+    bad = write_blob(wrong);
+    TEST_ASSERT_FALSE(cnn.load(bad.data(), bad.size()));
+
+    // Input must match the spectrogram
+    wrong = model;
+    wrong.frames = SPECTROGRAM_FRAMES + 1;
+    bad = write_blob(wrong);
+    TEST_ASSERT_FALSE(cnn.load(bad.data(), bad.size()));
+
+    // A network whose activations do not fit reports what it needs
+    int t = SPECTROGRAM_FRAMES, c = SPECTROGRAM_BINS;
+    RefModel big;
+    big.frames = t;
+    big.bins = c;
+    big.input_zero_point = 0;
+    big.output_scale = 0.05f;
+    big.labels.assign(CNN_LABELS, CNN_LABELS + 3);
+    rng_state = 5;
+    add_layer(big, t, c, CNN_CONV1D, 1, 1, 255, true);
+    add_layer(big, t, c, CNN_AVG_POOL, 0, 0, 0, false);
+    add_layer(big, t, c, CNN_DENSE, 0, 0, 3, false);
+    bad = write_blob(big);
+    CnnModel parsed;
+    TEST_ASSERT_FALSE(parsed.parse(bad.data(), bad.size(), CNN_ARENA_SIZE));
+    TEST_ASSERT_EQUAL(SPECTROGRAM_FRAMES * SPECTROGRAM_BINS + SPECTROGRAM_FRAMES * 255, parsed.get_arena_required());
+}
+
+void test_result_is_softmax_of_logits() {
+    RefModel model = make_model(4, 20);
+    std::vector<uint8_t> blob = write_blob(model);
+    TEST_ASSERT_TRUE(cnn.load(blob.data(), blob.size()));
+    TEST_ASSERT_EQUAL_STRING("vehicle", cnn.get_label_name(1));
+    TEST_ASSERT_EQUAL_STRING("unknown", cnn.get_label_name(3));
+
+    for (int q = 0; q < 20; q++) {
+        random_input(cnn.input_tensor(), model.frames * model.bins);
+        std::vector<int8_t> logits = reference_run(model, cnn.input_tensor());
+        KnnResult result;
+        int label_id = cnn.classify_input(result);
+
+        double total = 0.0;
+        for (int i = 0; i < 3; i++) {
+            total += exp(0.05 * logits[i]);
+        }
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)(exp(0.05 * logits[i]) / total), result.scores[i]);
+            TEST_ASSERT_TRUE(logits[i] <= logits[label_id]);
+        }
+        TEST_ASSERT_EQUAL(3, result.top_count);
+        TEST_ASSERT_EQUAL(label_id, result.top[0]);
+        TEST_ASSERT_TRUE(result.scores[result.top[1]] >= result.scores[result.top[2]]);
+        TEST_ASSERT_EQUAL_FLOAT(result.scores[label_id], result.confidence);
+    }
+}
+
+// Runs on the AudioProcessor spectrogram once enough frames are held
+void test_classifies_rolling_spectrogram() {
+    static AudioProcessor processor;
+    processor.initialize();
+    processor.set_spectrogram_enabled(true);
+
+    RefModel model = make_model(6, 24);
+    std::vector<uint8_t> blob = write_blob(model);
+    TEST_ASSERT_TRUE(cnn.load(blob.data(), blob.size()));
+
+    static int8_t window[SPECTROGRAM_FRAMES * SPECTROGRAM_BINS];
+    int16_t samples[AUDIO_HOP_SIZE];
+    AudioFeatures features;
+    KnnResult result;
+    int n = 0;
+    for (int frame = 0; frame < 40; frame++) {
+        while (!processor.is_frame_ready()) {
+            for (int i = 0; i < AUDIO_HOP_SIZE; i++, n++) {
+                samples[i] = (int16_t)(6000.0 * sin(2.0 * PI * 20.0 * n / SAMPLE_RATE) + (n * 7919 % 401) - 200);
+            }
+            processor.add_samples(samples, AUDIO_HOP_SIZE);
+        }
+        TEST_ASSERT_TRUE(processor.extract_features(features));
+
+        int label_id = cnn.classify(processor, result);
+        if (processor.get_spectrogram_frames() < (size_t)model.frames) {
+            TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, label_id);
+            continue;
+        }
+        TEST_ASSERT_TRUE(processor.copy_spectrogram(window, model.frames));
+        std::vector<int8_t> logits = reference_run(model, window);
+        TEST_ASSERT_TRUE(label_id >= 0);
+        TEST_ASSERT_EQUAL(logits[label_id], *std::max_element(logits.begin(), logits.end()));
+    }
+
+    // A skipped frame breaks the sequence
+    while (!processor.is_frame_ready()) {
+        processor.add_samples(samples, AUDIO_HOP_SIZE);
+    }
+    processor.skip_frame();
+    TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, cnn.classify(processor, result));
+}
+
+static const uint32_t CNN_GOLDEN_HASH = 1011441105UL;
+
+// Logits for fixed models and inputs must be bit-identical on every
+// target. The golden hash was recorded on the host build; running this
+// test on the ESP32 checks device parity. Also prints the latency.
+void test_output_is_bit_exact() {
+    static int8_t input[SPECTROGRAM_FRAMES * SPECTROGRAM_BINS];
+    RefModel model = make_model(42, SPECTROGRAM_FRAMES);
+    std::vector<uint8_t> blob = write_blob(model);
+    TEST_ASSERT_TRUE(cnn.load(blob.data(), blob.size()));
+
+    uint32_t hash = 2166136261UL;
+    const int runs = 200;
+    size_t before = heap_allocations;
+    clock_t start = clock();
+    for (int q = 0; q < runs; q++) {
+        random_input(input, SPECTROGRAM_FRAMES * SPECTROGRAM_BINS);
+        memcpy(cnn.input_tensor(), input, sizeof(input));
+        const int8_t* logits = cnn.invoke();
+        for (int i = 0; i < 3; i++) {
+            hash = (hash ^ (uint8_t)logits[i]) * 16777619UL;
+        }
+    }
+    double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / runs;
+    TEST_ASSERT_EQUAL(0, heap_allocations - before);
+
+    printf("CNN_BENCH: %dx%d input, arena %u of %u bytes, %.1f us per inference\n",
+           SPECTROGRAM_FRAMES, SPECTROGRAM_BINS, (unsigned)cnn.get_model().get_arena_required(),
+           (unsigned)CNN_ARENA_SIZE, us);
+    TEST_ASSERT_EQUAL_UINT32(CNN_GOLDEN_HASH, hash);
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_requantize_rounds_half_up);
+    RUN_TEST(test_network_matches_reference);
+    RUN_TEST(test_rejects_malformed_blobs);
+    RUN_TEST(test_result_is_softmax_of_logits);
+    RUN_TEST(test_classifies_rolling_spectrogram);
+    RUN_TEST(test_output_is_bit_exact);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
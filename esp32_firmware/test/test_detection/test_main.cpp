@@ -0,0 +1,227 @@
+#include <unity.h>
+#include <stdio.h>
+#include "DetectionDecoder.h"
+
+// One result per hop, as the linear engine produces them
+static const uint32_t HOP_MS = 128;
+
+// Two-label result: label wins with confidence, the other label has the rest
+static KnnResult make_result(int label, float confidence) {
+    KnnResult result;
+    clear_result(0, result);
+    result.label_id = label;
+    result.confidence = confidence;
+    result.scores[label] = confidence;
+    result.scores[1 - label] = 1.0f - confidence;
+    result.top[0] = (uint8_t)label;
+    result.top[1] = (uint8_t)(1 - label);
+    result.top_count = 2;
+    return result;
+}
+
+static uint32_t rng_state;
+
+static uint32_t next_random() {
+    rng_state = rng_state * 1664525UL + 1013904223UL;
+    return rng_state >> 8;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_flicker_is_debounced() {
+    DetectionDecoder decoder;
+    DetectionEvent events[DETECTION_MAX_EVENTS];
+    for (uint32_t i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL(0, decoder.update(make_result(i % 2, 0.9f), i * HOP_MS, events));
+    }
+    TEST_ASSERT_FALSE(decoder.is_active());
+}
+
+void test_event_has_onset_and_offset() {
+    DetectionDecoder decoder(0.6f, 0.4f, 500, 2000);
+    DetectionEvent events[DETECTION_MAX_EVENTS];
+    uint32_t now = 1000;
+
+    // Starts once the run has lasted the onset time; dated to its first result
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, decoder.update(make_result(0, 0.8f), now + i * HOP_MS, events));
+    }
+    TEST_ASSERT_EQUAL(1, decoder.update(make_result(0, 0.8f), now + 4 * HOP_MS, events));
+    TEST_ASSERT_EQUAL(DETECTION_START, events[0].type);
+    TEST_ASSERT_EQUAL(0, events[0].label_id);
+    TEST_ASSERT_EQUAL_UINT32(now, events[0].start_ms);
+    TEST_ASSERT_EQUAL_FLOAT(0.8f, events[0].confidence);
+    TEST_ASSERT_EQUAL(0, decoder.get_active_label());
+
+    // Scores between the two levels keep it going, and so does a brief drop
+    uint32_t t = now + 5 * HOP_MS;
+    for (int i = 0; i < 10; i++, t += HOP_MS) {
+        TEST_ASSERT_EQUAL(0, decoder.update(make_result(0, i == 3 ? 0.95f : 0.5f), t, events));
+    }
+    KnnResult rejected;
+    clear_result(KNN_REJECTED, rejected);
+    for (int i = 0; i < 5; i++, t += HOP_MS) {
+        TEST_ASSERT_EQUAL(0, decoder.update(rejected, t, events));
+    }
+    uint32_t last_support = t;
+    TEST_ASSERT_EQUAL(0, decoder.update(make_result(0, 0.45f), t, events));
+    t += HOP_MS;
+
+    // Ends after the hold, dated to the last supporting result
+    while (t - last_support <= 2000) {
+        TEST_ASSERT_EQUAL(0, decoder.update(rejected, t, events));
+        t += HOP_MS;
+    }
+    TEST_ASSERT_EQUAL(1, decoder.update(rejected, t, events));
+    TEST_ASSERT_EQUAL(DETECTION_END, events[0].type);
+    TEST_ASSERT_EQUAL(0, events[0].label_id);
+    TEST_ASSERT_EQUAL_UINT32(now, events[0].start_ms);
+    TEST_ASSERT_EQUAL_UINT32(last_support, events[0].end_ms);
+    TEST_ASSERT_EQUAL_FLOAT(0.95f, events[0].confidence);
+    TEST_ASSERT_FALSE(decoder.is_active());
+}
+
+// A confident new label ends the current event and starts its own in one update
+void test_label_switch_ends_then_starts() {
+    DetectionDecoder decoder(0.6f, 0.4f, 300, 2000);
+    DetectionEvent events[DETECTION_MAX_EVENTS];
+    uint32_t t = 0;
+    for (int i = 0; i < 5; i++, t += HOP_MS) {
+        decoder.update(make_result(0, 0.9f), t, events);
+    }
+    TEST_ASSERT_EQUAL(0, decoder.get_active_label());
+    uint32_t last_support = t - HOP_MS;
+
+    uint32_t switch_start = t;
+    size_t count = 0;
+    while (count == 0) {
+        count = decoder.update(make_result(1, 0.9f), t, events);
+        t += HOP_MS;
+    }
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(DETECTION_END, events[0].type);
+    TEST_ASSERT_EQUAL(0, events[0].label_id);
+    TEST_ASSERT_EQUAL_UINT32(last_support, events[0].end_ms);
+    TEST_ASSERT_EQUAL(DETECTION_START, events[1].type);
+    TEST_ASSERT_EQUAL(1, events[1].label_id);
+    TEST_ASSERT_EQUAL_UINT32(switch_start, events[1].start_ms);
+    TEST_ASSERT_TRUE(t - HOP_MS - switch_start >= 300);
+}
+
+// Only the winner's confidence, calibrated for k-NN, supports the event and
+// sets its peak; the raw vote shares in scores do not
+void test_event_follows_calibrated_confidence() {
+    DetectionDecoder decoder(0.6f, 0.4f, 0, 1000);
+    DetectionEvent events[DETECTION_MAX_EVENTS];
+    TEST_ASSERT_EQUAL(1, decoder.update(make_result(0, 0.8f), 0, events));
+
+    KnnResult result = make_result(0, 0.5f);
+    result.scores[0] = 0.99f;
+    TEST_ASSERT_EQUAL(0, decoder.update(result, 500, events));
+    result.confidence = 0.3f;
+    TEST_ASSERT_EQUAL(0, decoder.update(result, 1000, events));
+
+    // Runner-up with a raw share above the close level
+    result = make_result(1, 0.55f);
+    result.scores[0] = 0.45f;
+    TEST_ASSERT_EQUAL(0, decoder.update(result, 1400, events));
+
+    TEST_ASSERT_EQUAL(1, decoder.tick(1501, events));
+    TEST_ASSERT_EQUAL(DETECTION_END, events[0].type);
+    TEST_ASSERT_EQUAL_UINT32(500, events[0].end_ms);
+    TEST_ASSERT_EQUAL_FLOAT(0.8f, events[0].confidence);
+}
+
+// Results stop when the cascade gates frames out; tick() still ends the event
+void test_tick_and_finish_end_events() {
+    DetectionDecoder decoder(0.6f, 0.4f, 0, 1000);
+    DetectionEvent events[DETECTION_MAX_EVENTS];
+    TEST_ASSERT_EQUAL(1, decoder.update(make_result(1, 0.7f), 5000, events));
+    TEST_ASSERT_EQUAL(0, decoder.tick(6000, events));
+    TEST_ASSERT_EQUAL(1, decoder.tick(6001, events));
+    TEST_ASSERT_EQUAL(DETECTION_END, events[0].type);
+    TEST_ASSERT_EQUAL_UINT32(5000, events[0].end_ms);
+    TEST_ASSERT_EQUAL(0, decoder.tick(9000, events));
+
+    // Rejected results give no support and no onset
+    KnnResult rejected;
+    clear_result(KNN_REJECTED, rejected);
+    TEST_ASSERT_EQUAL(0, decoder.update(rejected, 9000, events));
+
+    TEST_ASSERT_EQUAL(1, decoder.update(make_result(0, 0.7f), 10000, events));
+    TEST_ASSERT_EQUAL(1, decoder.finish(events));
+    TEST_ASSERT_EQUAL(DETECTION_END, events[0].type);
+    TEST_ASSERT_EQUAL(0, decoder.finish(events));
+
+    // The close level never exceeds the open level; open 0 disables
+    decoder.configure(0.5f, 0.9f, 0, 1000);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, decoder.get_close_level());
+    TEST_ASSERT_TRUE(decoder.enabled());
+    decoder.configure(0.0f, 0.0f, 0, 0);
+    TEST_ASSERT_FALSE(decoder.enabled());
+}
+
+// 10 s of label 0 then 10 s of label 1, with a quarter of the results
+// flipped: every raw change would be a message, the decoder sends four
+void test_noisy_stream_gives_one_event_per_segment() {
+    DetectionDecoder decoder;
+    DetectionEvent events[DETECTION_MAX_EVENTS];
+    rng_state = 42;
+    int raw_changes = 0;
+    int previous = -1;
+    int starts[2] = {0, 0};
+    int ends = 0;
+    uint32_t t = 0;
+    for (int segment = 0; segment < 2; segment++) {
+        for (uint32_t end = t + 10000; t < end; t += HOP_MS) {
+            bool flipped = next_random() % 4 == 0;
+            int label = flipped ? 1 - segment : segment;
+            float confidence = 0.6f + (float)(next_random() % 35) / 100.0f;
+            raw_changes += label != previous;
+            previous = label;
+            size_t count = decoder.update(make_result(label, confidence), t, events);
+            for (size_t i = 0; i < count; i++) {
+                if (events[i].type == DETECTION_START) {
+                    starts[events[i].label_id]++;
+                } else {
+                    ends++;
+                }
+            }
+        }
+    }
+    ends += (int)decoder.finish(events);
+    printf("DETECTION_BENCH: %d raw label changes, %d events (%d start, %d end)\n", raw_changes,
+           starts[0] + starts[1] + ends, starts[0] + starts[1], ends);
+    TEST_ASSERT_EQUAL(1, starts[0]);
+    TEST_ASSERT_EQUAL(1, starts[1]);
+    TEST_ASSERT_EQUAL(2, ends);
+    TEST_ASSERT_TRUE(raw_changes > 20);
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_flicker_is_debounced);
+    RUN_TEST(test_event_has_onset_and_offset);
+    RUN_TEST(test_label_switch_ends_then_starts);
+    RUN_TEST(test_event_follows_calibrated_confidence);
+    RUN_TEST(test_tick_and_finish_end_events);
+    RUN_TEST(test_noisy_stream_gives_one_event_per_segment);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
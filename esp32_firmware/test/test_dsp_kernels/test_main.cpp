@@ -0,0 +1,412 @@
+#include <unity.h>
+#include <math.h>
+#include "DspKernels.h"
+#include "AudioProcessor.h"
+#include "ProcessingCascade.h"
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+void setUp() {
+    DspKernels::initialize(FFT_SIZE / 2);
+}
+
+void tearDown() {}
+
+void test_multiply_matches_scalar() {
+    float a[64], b[64], expected[64], actual[64];
+    for (int i = 0; i < 64; i++) {
+        a[i] = 0.1f * i - 3.0f;
+        b[i] = cosf(0.2f * i);
+    }
+    DspKernels::multiply_scalar(a, b, expected, 64);
+    DspKernels::multiply(a, b, actual, 64);
+    for (int i = 0; i < 64; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, a[i] * b[i], expected[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected[i], actual[i]);
+    }
+}
+
+void test_sum_squares_matches_scalar() {
+    float x[100];
+    float reference = 0.0f;
+    for (int i = 0; i < 100; i++) {
+        x[i] = sinf(0.37f * i);
+        reference += x[i] * x[i];
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, reference, DspKernels::sum_squares_scalar(x, 100));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, reference, DspKernels::sum_squares(x, 100));
+}
+
+void test_real_fft_matches_dft() {
+    const int n = FFT_SIZE;
+    static float data[FFT_SIZE];
+    static double input[FFT_SIZE];
+    for (int i = 0; i < n; i++) {
+        input[i] = 0.5 * sin(2.0 * PI * 20.0 * i / n) + 0.25 * cos(2.0 * PI * 3.0 * i / n) + 0.01 * (i % 7);
+        data[i] = (float)input[i];
+    }
+
+    DspKernels::real_fft<FFT_SIZE>(data);
+
+    for (int k = 0; k <= n / 2; k++) {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            re += input[i] * cos(2.0 * PI * k * i / n);
+            im -= input[i] * sin(2.0 * PI * k * i / n);
+        }
+        float expected = (float)(re * re + im * im);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f + expected * 1e-4f, expected, RealFFT<FFT_SIZE>::power(data, k));
+    }
+}
+
+void test_benchmark_reports_every_kernel() {
+    KernelTiming timings[DSP_KERNEL_COUNT];
+    size_t count = DspKernels::benchmark<FFT_SIZE>(timings);
+    TEST_ASSERT_EQUAL(DSP_KERNEL_COUNT, count);
+    TEST_ASSERT_EQUAL_STRING("window", timings[0].name);
+    TEST_ASSERT_EQUAL_STRING("fft", timings[1].name);
+    TEST_ASSERT_EQUAL_STRING("band_energy", timings[2].name);
+}
+
+void test_tone_lands_in_expected_bin() {
+    AudioProcessor processor;
+    processor.initialize();
+
+    // 20 Hz tone: bin 5 at 1 kHz / 256, inside the infrasound band
+    int16_t samples[AUDIO_BUFFER_SIZE];
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        samples[i] = (int16_t)(8000.0 * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE));
+    }
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE, processor.add_samples(samples, AUDIO_BUFFER_SIZE));
+
+    AudioFeatures features;
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+    TEST_ASSERT_FLOAT_WITHIN(4.0f, 20.0f, features.dominant_frequency);
+    TEST_ASSERT_TRUE(features.infrasound_energy > 100.0f * features.mid_band_energy);
+}
+
+// 20 Hz tone whose level changes every 40 samples, so a frame's spectrum
+// depends on where each part sits in the window
+static int16_t stepped_tone(int n) {
+    double amplitude = (n / 40) % 3 == 0 ? 8000.0 : 800.0;
+    return (int16_t)(amplitude * sin(2.0 * PI * 20.0 * n / SAMPLE_RATE));
+}
+
+// After the first full window a frame is ready every hop samples, and it
+// covers the latest AUDIO_BUFFER_SIZE samples oldest first wherever the
+// circular history wraps: the features match a fresh processor given the
+// same window in one unwrapped block
+void test_frames_follow_hop_and_history_order() {
+    AudioProcessor processor;
+    processor.initialize();
+    const size_t hop = 96;
+    TEST_ASSERT_FALSE(processor.set_hop_size(0));
+    TEST_ASSERT_FALSE(processor.set_hop_size(AUDIO_BUFFER_SIZE + 1));
+    TEST_ASSERT_TRUE(processor.set_hop_size(hop));
+    TEST_ASSERT_EQUAL(hop, processor.get_hop_size());
+
+    // Chunks that do not line up with the hop
+    const size_t CHUNK = 50;
+    int16_t chunk[CHUNK];
+    int n = 0;
+    for (size_t frame = 0; frame < 10; frame++) {
+        while (!processor.is_frame_ready()) {
+            for (size_t i = 0; i < CHUNK; i++) {
+                chunk[i] = stepped_tone(n + i);
+            }
+            size_t taken = processor.add_samples(chunk, CHUNK);
+            n += taken;
+            TEST_ASSERT_TRUE(taken == CHUNK || processor.is_frame_ready());
+        }
+        TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE + frame * hop, n);
+        TEST_ASSERT_EQUAL(0, processor.add_samples(chunk, CHUNK));
+
+        AudioFeatures features;
+        TEST_ASSERT_TRUE(processor.extract_features(features));
+        TEST_ASSERT_FALSE(processor.is_frame_ready());
+
+        static AudioProcessor reference;
+        reference.initialize();
+        int16_t window[AUDIO_BUFFER_SIZE];
+        for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+            window[i] = stepped_tone(n - AUDIO_BUFFER_SIZE + i);
+        }
+        TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE, reference.add_samples(window, AUDIO_BUFFER_SIZE));
+        AudioFeatures expected;
+        TEST_ASSERT_TRUE(reference.extract_features(expected));
+        TEST_ASSERT_EQUAL_FLOAT(expected.rms, features.rms);
+        TEST_ASSERT_EQUAL_FLOAT(expected.infrasound_energy, features.infrasound_energy);
+        TEST_ASSERT_EQUAL_FLOAT(expected.low_band_energy, features.low_band_energy);
+        TEST_ASSERT_EQUAL_FLOAT(expected.mid_band_energy, features.mid_band_energy);
+        TEST_ASSERT_EQUAL_FLOAT(expected.spectral_centroid, features.spectral_centroid);
+        TEST_ASSERT_EQUAL_FLOAT(expected.dominant_frequency, features.dominant_frequency);
+    }
+}
+
+// A reset drops the previous spectrum with the history: the first frame
+// after it has the flux of a fresh processor's first frame
+void test_reset_buffer_restarts_flux() {
+    AudioProcessor processor;
+    AudioProcessor reference;
+    processor.initialize();
+    reference.initialize();
+    int16_t window[AUDIO_BUFFER_SIZE];
+    AudioFeatures features;
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        window[i] = stepped_tone(i);
+    }
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE, processor.add_samples(window, AUDIO_BUFFER_SIZE));
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+
+    processor.reset_buffer();
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        window[i] = stepped_tone(1000 + i);
+    }
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE, processor.add_samples(window, AUDIO_BUFFER_SIZE));
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE, reference.add_samples(window, AUDIO_BUFFER_SIZE));
+    AudioFeatures expected;
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+    TEST_ASSERT_TRUE(reference.extract_features(expected));
+    TEST_ASSERT_EQUAL_FLOAT(expected.spectral_flux, features.spectral_flux);
+}
+
+void test_sliding_trace_tracks_frame_energy() {
+    AudioProcessor processor;
+    processor.initialize();
+
+    AudioFeatures features;
+    bool checked = false;
+    for (int i = 0; i < 4 * AUDIO_BUFFER_SIZE; i++) {
+        double amplitude = i < 2 * AUDIO_BUFFER_SIZE ? 300.0 : 6000.0;
+        processor.add_sample((int16_t)(amplitude * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE)));
+
+        float trace = processor.get_infrasound_trace();
+        if (processor.extract_features(features)) {
+            // Same Hann on both sides; the damping weights the oldest
+            // sample by r^N = 0.987, so the trace can read up to ~1.3% low
+            TEST_ASSERT_FLOAT_WITHIN(0.015f * features.infrasound_energy + 1e-6f,
+                                     features.infrasound_energy, trace);
+            checked = true;
+        }
+    }
+    TEST_ASSERT_TRUE(checked);
+}
+
+void test_energy_gate_skips_quiet_frames() {
+    AudioProcessor processor;
+    ProcessingCascade cascade;
+    processor.initialize();
+    cascade.energy_gate().set_levels(0.05f, 0.02f);
+
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        processor.add_sample((int16_t)(100.0 * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE)));
+    }
+    TEST_ASSERT_TRUE(processor.is_frame_ready());
+    TEST_ASSERT_FALSE(cascade.admit_frame(processor.get_infrasound_trace()));
+    processor.skip_frame();
+    TEST_ASSERT_FALSE(processor.is_frame_ready());
+
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        processor.add_sample((int16_t)(8000.0 * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE)));
+    }
+    TEST_ASSERT_TRUE(cascade.admit_frame(processor.get_infrasound_trace()));
+
+    AudioFeatures features;
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+    TEST_ASSERT_TRUE(cascade.admit_features(features));
+
+    CascadeStats stats = cascade.get_stats();
+    TEST_ASSERT_EQUAL(2, stats.frames);
+    TEST_ASSERT_EQUAL(1, stats.energy_rejected);
+    TEST_ASSERT_EQUAL(0, stats.spectral_rejected);
+    TEST_ASSERT_EQUAL(1, stats.spectral_passed);
+    TEST_ASSERT_EQUAL(stats.frames, stats.energy_rejected + stats.spectral_rejected + stats.spectral_passed);
+}
+
+void test_hysteresis_gate_holds_between_levels() {
+    HysteresisGate gate(1.0f, 0.5f);
+    TEST_ASSERT_FALSE(gate.update(0.8f));   // Below open level
+    TEST_ASSERT_TRUE(gate.update(1.0f));    // Opens
+    TEST_ASSERT_TRUE(gate.update(0.6f));    // Held open above close level
+    TEST_ASSERT_FALSE(gate.update(0.4f));   // Closes
+    TEST_ASSERT_FALSE(gate.update(0.8f));   // Stays closed until open level
+
+    HysteresisGate disabled;
+    TEST_ASSERT_TRUE(disabled.update(0.0f));
+}
+
+void test_spectral_gate_rejects_broadband_frames() {
+    ProcessingCascade cascade;
+    cascade.spectral_gate().set_levels(0.6f, 0.4f);
+
+    AudioFeatures features = {};
+    features.infrasound_energy = 1.0f;
+    features.low_band_energy = 1.0f;
+    features.mid_band_energy = 1.0f;
+    TEST_ASSERT_FALSE(cascade.admit_features(features));
+
+    features.low_band_energy = 0.1f;
+    features.mid_band_energy = 0.1f;
+    TEST_ASSERT_TRUE(cascade.admit_features(features));
+
+    // Share 0.5: below the open level but held open by hysteresis
+    features.low_band_energy = 0.5f;
+    features.mid_band_energy = 0.5f;
+    TEST_ASSERT_TRUE(cascade.admit_features(features));
+    TEST_ASSERT_EQUAL(1, cascade.get_stats().spectral_rejected);
+}
+
+// The classifier's mask may leave out the bands; the cascade's own needs
+// are ORed into the extraction mask so the spectral share is measured
+void test_spectral_gate_requires_band_features() {
+    ProcessingCascade cascade;
+    TEST_ASSERT_EQUAL(0, cascade.get_required_features());
+    cascade.spectral_gate().set_levels(0.6f, 0.4f);
+    TEST_ASSERT_EQUAL(FEATURE_MASK_BANDS, cascade.get_required_features());
+
+    AudioProcessor processor;
+    processor.initialize();
+    processor.set_feature_mask(FEATURE_SPECTRAL_CENTROID | cascade.get_required_features());
+    AudioFeatures features;
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        processor.add_sample((int16_t)(4000.0 * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE)));
+    }
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+    TEST_ASSERT_TRUE(ProcessingCascade::infrasound_share(features) > 0.6f);
+    TEST_ASSERT_TRUE(cascade.admit_features(features));
+
+    // Without them the share reads 0 and the gate closes for good
+    processor.set_feature_mask(FEATURE_SPECTRAL_CENTROID);
+    for (int i = AUDIO_BUFFER_SIZE; i < AUDIO_BUFFER_SIZE + AUDIO_HOP_SIZE; i++) {
+        processor.add_sample((int16_t)(4000.0 * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE)));
+    }
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, ProcessingCascade::infrasound_share(features));
+    TEST_ASSERT_FALSE(cascade.admit_features(features));
+
+    CascadeStats stats = cascade.get_stats();
+    TEST_ASSERT_EQUAL(1, stats.spectral_passed);
+    TEST_ASSERT_EQUAL(1, stats.spectral_rejected);
+}
+
+void test_feature_mask_skips_unused_features() {
+    AudioProcessor full;
+    AudioProcessor masked;
+    full.initialize();
+    masked.initialize();
+    masked.set_feature_mask(FEATURE_INFRASOUND_ENERGY | FEATURE_SPECTRAL_CENTROID | FEATURE_SPECTRAL_FLUX);
+    TEST_ASSERT_TRUE(masked.get_skipped_steps_per_frame() > 0);
+    TEST_ASSERT_EQUAL(0, full.get_skipped_steps_per_frame());
+
+    // Two frames so flux has a previous spectrum to diff against
+    AudioFeatures expected, actual;
+    int frames = 0;
+    for (int i = 0; i < 3 * AUDIO_BUFFER_SIZE; i++) {
+        double amplitude = i < AUDIO_BUFFER_SIZE ? 2000.0 : 6000.0;
+        int16_t sample = (int16_t)(amplitude * sin(2.0 * PI * 20.0 * i / SAMPLE_RATE) + 500.0 * sin(2.0 * PI * 120.0 * i / SAMPLE_RATE));
+        full.add_sample(sample);
+        masked.add_sample(sample);
+        if (full.extract_features(expected)) {
+            TEST_ASSERT_TRUE(masked.extract_features(actual));
+            frames++;
+        }
+    }
+    TEST_ASSERT_TRUE(frames >= 2);
+    TEST_ASSERT_TRUE(expected.spectral_flux > 0.0f);
+
+    TEST_ASSERT_EQUAL_FLOAT(expected.infrasound_energy, actual.infrasound_energy);
+    TEST_ASSERT_EQUAL_FLOAT(expected.spectral_centroid, actual.spectral_centroid);
+    TEST_ASSERT_EQUAL_FLOAT(expected.spectral_flux, actual.spectral_flux);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, actual.rms);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, actual.low_band_energy);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, actual.mid_band_energy);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, actual.dominant_frequency);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, actual.temporal_envelope);
+}
+
+// Peak bin of one spectrogram frame
+static int peak_bin(const int8_t* frame) {
+    int best = 0;
+    for (int k = 1; k < SPECTROGRAM_BINS; k++) {
+        best = frame[k] > frame[best] ? k : best;
+    }
+    return best;
+}
+
+void test_spectrogram_keeps_latest_frames() {
+    AudioProcessor processor;
+    processor.initialize();
+    // The spectrogram alone keeps the FFT running
+    processor.set_feature_mask(FEATURE_RMS);
+    uint32_t skipped_without = processor.get_skipped_steps_per_frame();
+    processor.set_spectrogram_enabled(true);
+    TEST_ASSERT_TRUE(processor.get_skipped_steps_per_frame() < skipped_without);
+
+    // 20 Hz tone at a quarter of the amplitude for the last two hops, so
+    // the last frame's window holds only the quiet part
+    const int frames = SPECTROGRAM_FRAMES + 4;
+    AudioFeatures features;
+    int n = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        double amplitude = frame < frames - 2 ? 8000.0 : 2000.0;
+        while (!processor.is_frame_ready()) {
+            processor.add_sample((int16_t)(amplitude * sin(2.0 * PI * 20.0 * n++ / SAMPLE_RATE)));
+        }
+        TEST_ASSERT_TRUE(processor.extract_features(features));
+    }
+    TEST_ASSERT_EQUAL(SPECTROGRAM_FRAMES, processor.get_spectrogram_frames());
+
+    static int8_t spectrogram[SPECTROGRAM_FRAMES][SPECTROGRAM_BINS];
+    TEST_ASSERT_FALSE(processor.copy_spectrogram(spectrogram[0], SPECTROGRAM_FRAMES + 1));
+    TEST_ASSERT_TRUE(processor.copy_spectrogram(spectrogram[0], SPECTROGRAM_FRAMES));
+
+    // Power of a 0.244 full-scale tone is about 0.95 (code 96); a quarter
+    // of the amplitude is 1/16 of the power, 4 octaves or 16 codes lower
+    for (int t = 0; t < SPECTROGRAM_FRAMES; t++) {
+        TEST_ASSERT_EQUAL(5, peak_bin(spectrogram[t]));
+        TEST_ASSERT_TRUE(spectrogram[t][40] < spectrogram[t][5] - 40);
+    }
+    int8_t loud = spectrogram[SPECTROGRAM_FRAMES - 3][5];
+    int8_t quiet = spectrogram[SPECTROGRAM_FRAMES - 1][5];
+    TEST_ASSERT_INT_WITHIN(2, 96, loud);
+    TEST_ASSERT_INT_WITHIN(2, loud - 4 * 4, quiet);
+
+    processor.set_spectrogram_enabled(false);
+    TEST_ASSERT_EQUAL(0, processor.get_spectrogram_frames());
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_multiply_matches_scalar);
+    RUN_TEST(test_sum_squares_matches_scalar);
+    RUN_TEST(test_real_fft_matches_dft);
+    RUN_TEST(test_benchmark_reports_every_kernel);
+    RUN_TEST(test_tone_lands_in_expected_bin);
+    RUN_TEST(test_frames_follow_hop_and_history_order);
+    RUN_TEST(test_reset_buffer_restarts_flux);
+    RUN_TEST(test_sliding_trace_tracks_frame_energy);
+    RUN_TEST(test_energy_gate_skips_quiet_frames);
+    RUN_TEST(test_hysteresis_gate_holds_between_levels);
+    RUN_TEST(test_spectral_gate_rejects_broadband_frames);
+    RUN_TEST(test_spectral_gate_requires_band_features);
+    RUN_TEST(test_feature_mask_skips_unused_features);
+    RUN_TEST(test_spectrogram_keeps_latest_frames);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -0,0 +1,234 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "AudioProcessor.h"
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+#if !AUDIO_FIXED_POINT
+#error "test_fixed_point must be built with -DAUDIO_FIXED_POINT=1 (pio test -e native_q15)"
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+// Deterministic integer-only test signal (libm may differ between targets):
+// 20 Hz triangle rumble, 125 Hz triangle, LCG noise
+static int triangle(int i, int period, int amplitude) {
+    int phase = i % period;
+    int half = period / 2;
+    int ramp = phase < half ? phase : period - phase;
+    return (4 * amplitude * ramp) / period - amplitude;
+}
+
+static void make_signal(int16_t* out, int count, uint32_t seed, int amplitude) {
+    uint32_t state = seed;
+    for (int i = 0; i < count; i++) {
+        state = state * 1664525UL + 1013904223UL;
+        int noise = (int)(state >> 24) - 128;
+        out[i] = (int16_t)(triangle(i, SAMPLE_RATE / 20, amplitude)
+                         + triangle(i, SAMPLE_RATE / 125, amplitude / 5)
+                         + noise * 4);
+    }
+}
+
+// Double-precision reference of the documented feature definitions
+static void reference_features(const int16_t* x, AudioFeatures& f) {
+    const int n = AUDIO_BUFFER_SIZE;
+    double sum = 0.0, peak = 0.0;
+    double re[n / 2 + 1], im[n / 2 + 1];
+    for (int i = 0; i < n; i++) {
+        double v = x[i] / 32768.0;
+        sum += v * v;
+        peak = fabs(v) > peak ? fabs(v) : peak;
+    }
+    for (int k = 0; k <= n / 2; k++) {
+        re[k] = im[k] = 0.0;
+        for (int i = 0; i < n; i++) {
+            double w = 0.5 * (1.0 - cos(2.0 * PI * i / n));
+            double v = x[i] / 32768.0 * w / sqrt((double)n);
+            re[k] += v * cos(2.0 * PI * k * i / n);
+            im[k] -= v * sin(2.0 * PI * k * i / n);
+        }
+    }
+    auto band = [&](int lo, int hi) {
+        int a = (lo * n + SAMPLE_RATE / 2) / SAMPLE_RATE;
+        int b = (hi * n + SAMPLE_RATE / 2) / SAMPLE_RATE;
+        double e = 0.0;
+        for (int k = a; k < b; k++) {
+            e += re[k] * re[k] + im[k] * im[k];
+        }
+        return (float)e;
+    };
+    f.rms = (float)sqrt(sum / n);
+    f.temporal_envelope = (float)peak;
+    f.infrasound_energy = band(INFRASOUND_LOW_HZ, INFRASOUND_HIGH_HZ);
+    f.low_band_energy = band(INFRASOUND_HIGH_HZ, LOW_BAND_HIGH_HZ);
+    f.mid_band_energy = band(LOW_BAND_HIGH_HZ, MID_BAND_HIGH_HZ);
+}
+
+static uint32_t hash_features(const AudioFeatures& f, uint32_t hash) {
+    const uint8_t* bytes = (const uint8_t*)&f;
+    for (size_t i = 0; i < sizeof(AudioFeatures); i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+void test_q15_features_match_reference() {
+    AudioProcessor processor;
+    processor.initialize();
+
+    int16_t samples[AUDIO_BUFFER_SIZE];
+    make_signal(samples, AUDIO_BUFFER_SIZE, 1, 6000);
+    processor.add_samples(samples, AUDIO_BUFFER_SIZE);
+
+    AudioFeatures actual, expected;
+    TEST_ASSERT_TRUE(processor.extract_features(actual));
+    reference_features(samples, expected);
+
+    TEST_ASSERT_FLOAT_WITHIN(expected.rms * 1e-4f, expected.rms, actual.rms);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.temporal_envelope, actual.temporal_envelope);
+    TEST_ASSERT_FLOAT_WITHIN(expected.infrasound_energy * 0.01f, expected.infrasound_energy, actual.infrasound_energy);
+    TEST_ASSERT_FLOAT_WITHIN(expected.low_band_energy * 0.02f, expected.low_band_energy, actual.low_band_energy);
+    TEST_ASSERT_FLOAT_WITHIN(expected.mid_band_energy * 0.02f, expected.mid_band_energy, actual.mid_band_energy);
+    TEST_ASSERT_FLOAT_WITHIN(4.0f, 20.0f, actual.dominant_frequency);
+}
+
+void test_q15_quiet_input_uses_block_exponent() {
+    AudioProcessor processor;
+    processor.initialize();
+
+    // Amplitude ~0.3% of full scale still resolves the rumble band
+    int16_t samples[AUDIO_BUFFER_SIZE];
+    make_signal(samples, AUDIO_BUFFER_SIZE, 7, 100);
+    processor.add_samples(samples, AUDIO_BUFFER_SIZE);
+
+    AudioFeatures actual, expected;
+    TEST_ASSERT_TRUE(processor.extract_features(actual));
+    reference_features(samples, expected);
+    TEST_ASSERT_FLOAT_WITHIN(expected.infrasound_energy * 0.05f, expected.infrasound_energy, actual.infrasound_energy);
+}
+
+// Spectrogram codes follow the reference power to the nearest quarter
+// octave; Q15 rounding can move a code by one
+void test_q15_spectrogram_matches_reference() {
+    AudioProcessor processor;
+    processor.initialize();
+    processor.set_spectrogram_enabled(true);
+
+    int16_t samples[AUDIO_BUFFER_SIZE];
+    make_signal(samples, AUDIO_BUFFER_SIZE, 3, 6000);
+    processor.add_samples(samples, AUDIO_BUFFER_SIZE);
+    AudioFeatures features;
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+
+    int8_t frame[SPECTROGRAM_BINS];
+    TEST_ASSERT_TRUE(processor.copy_spectrogram(frame, 1));
+
+    const int n = AUDIO_BUFFER_SIZE;
+    int compared = 0;
+    for (int k = 0; k < SPECTROGRAM_BINS; k++) {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double w = 0.5 * (1.0 - cos(2.0 * PI * i / n));
+            double v = samples[i] / 32768.0 * w / sqrt((double)n);
+            re += v * cos(2.0 * PI * k * i / n);
+            im -= v * sin(2.0 * PI * k * i / n);
+        }
+        double power = re * re + im * im;
+        // Bins far below the block's Q15 resolution are not comparable
+        if (power < 1e-6) {
+            continue;
+        }
+        long code = lround(SPECTROGRAM_STEPS_PER_OCTAVE * log2(power)) + SPECTROGRAM_CODE_OFFSET;
+        TEST_ASSERT_INT_WITHIN(1, code, frame[k]);
+        compared++;
+    }
+    TEST_ASSERT_TRUE(compared > SPECTROGRAM_BINS / 2);
+}
+
+static const uint32_t Q15_GOLDEN_HASH = 1379154634UL;
+
+// Features for a fixed input sequence must be bit-identical on every
+// target. The golden hash was recorded on the host build; running this
+// test on the ESP32 (pio test -e esp32dev with AUDIO_FIXED_POINT) checks
+// device parity.
+void test_q15_output_is_bit_exact() {
+    AudioProcessor processor;
+    processor.initialize();
+
+    int16_t samples[AUDIO_BUFFER_SIZE];
+    AudioFeatures features;
+    make_signal(samples, AUDIO_BUFFER_SIZE, 99, 400);
+    processor.add_samples(samples, AUDIO_BUFFER_SIZE);
+    TEST_ASSERT_TRUE(processor.extract_features(features));
+    uint32_t hash = hash_features(features, 2166136261UL);
+
+    for (uint32_t frame = 0; frame < 8; frame++) {
+        make_signal(samples, AUDIO_HOP_SIZE, 100 + frame, 500 * (frame + 1));
+        TEST_ASSERT_EQUAL(AUDIO_HOP_SIZE, processor.add_samples(samples, AUDIO_HOP_SIZE));
+        TEST_ASSERT_TRUE(processor.extract_features(features));
+        hash = hash_features(features, hash);
+    }
+    TEST_ASSERT_EQUAL_UINT32(Q15_GOLDEN_HASH, hash);
+}
+
+// The integer sliding DFT tracks the frame band energy, and a sample
+// leaving the history takes back exactly what it added: after a full
+// window of silence the trace is zero, however loud the input was
+void test_q15_sliding_trace_cancels_exactly() {
+    AudioProcessor processor;
+    processor.initialize();
+
+    int16_t samples[4 * AUDIO_BUFFER_SIZE];
+    AudioFeatures features;
+    make_signal(samples, 4 * AUDIO_BUFFER_SIZE, 7, 12000);
+    bool checked = false;
+    for (int i = 0; i < 4 * AUDIO_BUFFER_SIZE; i++) {
+        processor.add_sample(samples[i]);
+        float trace = processor.get_infrasound_trace();
+        if (processor.extract_features(features)) {
+            // Same periodic Hann as the frame; only Q15 rounding differs
+            TEST_ASSERT_FLOAT_WITHIN(0.001f * features.infrasound_energy + 1e-6f,
+                                     features.infrasound_energy, trace);
+            checked = true;
+        }
+    }
+    TEST_ASSERT_TRUE(checked);
+
+    const int16_t silence = 0;
+    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        processor.skip_frame();
+        TEST_ASSERT_EQUAL(1, processor.add_samples(&silence, 1));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, processor.get_infrasound_trace());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, processor.get_low_band_trace());
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_q15_features_match_reference);
+    RUN_TEST(test_q15_quiet_input_uses_block_exponent);
+    RUN_TEST(test_q15_spectrogram_matches_reference);
+    RUN_TEST(test_q15_output_is_bit_exact);
+    RUN_TEST(test_q15_sliding_trace_cancels_exactly);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
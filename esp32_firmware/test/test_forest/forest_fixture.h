@@ -0,0 +1,380 @@
+// Generated by tools/forest_trainer; do not edit.
+// 8 trees, 360 nodes, depth <= 6, trained on 1500 samples; held-out accuracy 0.982 on 500
+#ifndef FOREST_MODEL_H
+#define FOREST_MODEL_H
+
+#include "DecisionForest.h"
+
+// threshold, feature (-1 = leaf), label, right child offset
+static constexpr ForestNode FOREST_NODES[] = {
+    {3.099999949e-02f, 0, 1, 30},
+    {6.875000000e+01f, 5, 0, 20},
+    {6.500000134e-03f, 3, 0, 12},
+    {2.750000060e-01f, 6, 0, 6},
+    {1.299999952e+00f, 1, 0, 4},
+    {8.249999583e-02f, 2, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.225000000e+02f, 4, 2, 4},
+    {2.300000004e-02f, 0, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.900000125e-02f, 0, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.749999776e-02f, 2, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {8.000000119e-01f, 1, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.900000125e-02f, 0, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.499999642e-03f, 3, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.062500000e+02f, 5, 1, 4},
+    {1.500000000e+00f, 1, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.250000000e-01f, 6, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.125000000e+01f, 5, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.000000477e-01f, 1, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.749999776e-02f, 2, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.899999976e-01f, 7, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.250000000e-01f, 6, 1, 12},
+    {8.249999583e-02f, 2, 0, 10},
+    {6.500000134e-03f, 3, 0, 8},
+    {6.875000000e+01f, 5, 0, 6},
+    {3.099999949e-02f, 0, 0, 4},
+    {1.299999952e+00f, 1, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.900000125e-02f, 0, 1, 10},
+    {1.299999952e+00f, 1, 2, 8},
+    {6.999999285e-03f, 0, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {9.625000000e+01f, 4, 2, 4},
+    {2.750000060e-01f, 6, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.375000000e+01f, 4, 1, 12},
+    {2.300000004e-02f, 0, 2, 6},
+    {8.249999583e-02f, 2, 0, 4},
+    {3.100000024e-01f, 7, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.099999949e-02f, 0, 2, 4},
+    {4.750000000e+01f, 4, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.749999776e-02f, 2, 1, 6},
+    {8.875000000e+01f, 4, 2, 4},
+    {2.750000060e-01f, 6, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.499999642e-03f, 3, 1, 4},
+    {-5.000003148e-04f, 3, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.000000477e-01f, 1, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {3.100000024e-01f, 7, 1, 30},
+    {2.750000060e-01f, 6, 0, 20},
+    {6.500000134e-03f, 3, 0, 12},
+    {9.625000000e+01f, 4, 0, 6},
+    {8.249999583e-02f, 2, 0, 4},
+    {3.099999949e-02f, 0, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.424999982e-01f, 2, 2, 4},
+    {1.062500000e+02f, 5, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.187500000e+02f, 4, 2, 6},
+    {1.899999976e+00f, 1, 2, 4},
+    {9.499999695e-03f, 3, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {4.250000119e-01f, 6, 2, 8},
+    {1.062500000e+02f, 5, 2, 6},
+    {1.187500000e+02f, 4, 2, 4},
+    {9.499999695e-03f, 3, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.900000125e-02f, 0, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.499999642e-03f, 3, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.250000000e-01f, 6, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.375000000e+01f, 4, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.125000000e+01f, 5, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {3.125000000e+01f, 5, 1, 12},
+    {1.299999952e+00f, 1, 0, 10},
+    {2.750000060e-01f, 6, 0, 8},
+    {8.249999583e-02f, 2, 0, 6},
+    {3.099999949e-02f, 0, 0, 4},
+    {6.500000134e-03f, 3, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.000000477e-01f, 1, 1, 12},
+    {6.875000000e+01f, 5, 2, 10},
+    {3.099999949e-02f, 0, 0, 8},
+    {2.249999940e-01f, 6, 0, 4},
+    {3.299999833e-01f, 7, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {9.999996983e-04f, 3, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.899999976e-01f, 7, 1, 8},
+    {6.999999285e-03f, 0, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {7.000000775e-02f, 7, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {1.100000024e+00f, 1, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.250000000e-01f, 6, 1, 6},
+    {-2.499999851e-02f, 6, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {6.999999285e-03f, 0, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.499999642e-03f, 3, 1, 4},
+    {-1.499999873e-02f, 2, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.749999776e-02f, 2, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {7.375000000e+01f, 4, 1, 12},
+    {1.299999952e+00f, 1, 0, 10},
+    {8.249999583e-02f, 2, 0, 8},
+    {2.750000060e-01f, 6, 0, 6},
+    {5.125000000e+01f, 4, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-2.499999851e-02f, 6, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.900000125e-02f, 0, 1, 10},
+    {-6.250000000e+00f, 5, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {7.000000775e-02f, 7, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {4.999996163e-04f, 3, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {6.999999285e-03f, 0, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.749999776e-02f, 2, 1, 8},
+    {-2.499999851e-02f, 6, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-1.499999873e-02f, 2, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-1.250000000e+01f, 5, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.125000000e+01f, 5, 1, 6},
+    {3.000000119e-02f, 7, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-9.999999404e-02f, 1, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.899999976e-01f, 7, 1, 4},
+    {5.625000000e+01f, 5, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.250000000e-01f, 6, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {7.375000000e+01f, 4, 2, 12},
+    {6.875000000e+01f, 5, 0, 10},
+    {3.099999949e-02f, 0, 0, 8},
+    {6.500000134e-03f, 3, 0, 6},
+    {2.750000060e-01f, 6, 0, 4},
+    {6.625000000e+01f, 4, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.125000000e+01f, 5, 1, 10},
+    {9.999999404e-02f, 1, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-6.250000000e+00f, 5, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-7.499998435e-03f, 2, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {9.625000000e+01f, 4, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.899999976e-01f, 7, 1, 10},
+    {-2.499999851e-02f, 6, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {5.625000000e+01f, 5, 2, 4},
+    {1.499999780e-03f, 3, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, 1, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.749999776e-02f, 2, 1, 6},
+    {-7.499998435e-03f, 2, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-5.000003148e-04f, 3, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.250000000e-01f, 6, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.900000125e-02f, 0, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {2.750000060e-01f, 6, 2, 38},
+    {6.875000000e+01f, 5, 0, 26},
+    {6.500000134e-03f, 3, 0, 14},
+    {3.099999949e-02f, 0, 0, 8},
+    {3.100000024e-01f, 7, 0, 4},
+    {1.299999952e+00f, 1, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {2.249999940e-01f, 6, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {4.300000072e-01f, 7, 2, 4},
+    {1.424999982e-01f, 2, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {8.249999583e-02f, 2, 2, 6},
+    {5.249999836e-02f, 2, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.112500000e+02f, 4, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.250000000e-01f, 6, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.900000125e-02f, 0, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {3.499999642e-03f, 3, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.000000477e-01f, 1, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.099999949e-02f, 0, 1, 4},
+    {4.300000072e-01f, 7, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {2.300000042e-01f, 7, 1, 2},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {1.900000125e-02f, 0, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.499999642e-03f, 3, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.375000000e+01f, 4, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.125000000e+01f, 5, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {6.000000238e-01f, 1, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {7.375000000e+01f, 4, 1, 22},
+    {5.125000000e+01f, 4, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {1.750000119e-01f, 6, 0, 8},
+    {6.500000134e-03f, 3, 0, 6},
+    {6.875000000e+01f, 5, 0, 4},
+    {3.099999949e-02f, 0, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.499999780e-03f, 3, 2, 6},
+    {3.100000024e-01f, 7, 0, 4},
+    {5.000000000e-01f, 1, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {6.999999285e-03f, 0, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-1.250000000e+01f, 5, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.900000125e-02f, 0, 1, 10},
+    {1.299999952e+00f, 1, 2, 8},
+    {9.625000000e+01f, 4, 0, 6},
+    {6.999999285e-03f, 0, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {2.750000060e-01f, 6, 0, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {3.499999642e-03f, 3, 1, 8},
+    {-2.499999851e-02f, 6, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {7.000000775e-02f, 7, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {-1.499999873e-02f, 2, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {7.000000477e-01f, 1, 1, 6},
+    {-2.499999851e-02f, 6, 2, 2},
+    {0.000000000e+00f, -1, 0, 0},
+    {7.500000298e-03f, 2, 2, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 2, 0},
+    {1.899999976e+00f, 1, 1, 4},
+    {3.125000000e+01f, 5, 1, 2},
+    {0.000000000e+00f, -1, 2, 0},
+    {0.000000000e+00f, -1, 1, 0},
+    {0.000000000e+00f, -1, 1, 0},
+};
+
+static constexpr uint32_t FOREST_TREE_START[] = {0, 41, 88, 129, 174, 217, 260, 309};
+
+static constexpr const char* FOREST_LABELS[] = {"elephant", "vehicle", "not_elephant"};
+
+static constexpr ForestModel FOREST_MODEL = {
+    FOREST_NODES, FOREST_TREE_START, 8, FOREST_LABELS, 3, 0xFF
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "KNNClassifier.h"
+#include "../support/test_fixture.h"
+
+// 8 trees of depth <= 6, from `forest_trainer --trees 8 --depth 6` on the
+// samples fill() produces
+#include "forest_fixture.h"
+
+// Queries the forest was not trained on
+static const uint32_t QUERY_SEED = 777;
+static const int QUERIES = 600;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_engine_needs_a_forest() {
+    KNNClassifier classifier;
+    classifier.initialize();
+    TEST_ASSERT_FALSE(classifier.set_engine(ENGINE_FOREST));
+    TEST_ASSERT_EQUAL(ENGINE_KNN, classifier.get_engine());
+    TEST_ASSERT_FALSE(classifier.load_forest(nullptr));
+
+    TEST_ASSERT_TRUE(classifier.load_forest(&FOREST_MODEL));
+    TEST_ASSERT_TRUE(classifier.set_engine(ENGINE_FOREST));
+    TEST_ASSERT_EQUAL(FOREST_MODEL.feature_mask, classifier.get_required_features());
+
+    // The forest answers without any training samples
+    KnnResult result;
+    TEST_ASSERT_TRUE(classifier.classify(make_features(0), result) >= 0);
+
+    // Names come from the forest's own table
+    for (int i = 0; i < FOREST_MODEL.label_count; i++) {
+        TEST_ASSERT_EQUAL_STRING(FOREST_LABELS[i], classifier.get_label_name(i));
+    }
+    TEST_ASSERT_EQUAL_STRING("unknown", classifier.get_label_name(FOREST_MODEL.label_count));
+
+    TEST_ASSERT_TRUE(classifier.set_engine(ENGINE_KNN));
+    TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, classifier.classify(make_features(0), result));
+}
+
+// Scores are the fraction of trees voting for each label, ranked in top
+void test_result_counts_tree_votes() {
+    DecisionForest forest;
+    TEST_ASSERT_TRUE(forest.load(&FOREST_MODEL));
+
+    rng_state = QUERY_SEED;
+    for (int q = 0; q < 100; q++) {
+        AudioFeatures query = make_features(q % 3);
+        const float values[NUM_FEATURES] = {
+            query.rms, query.infrasound_energy, query.low_band_energy, query.mid_band_energy,
+            query.spectral_centroid, query.dominant_frequency, query.spectral_flux, query.temporal_envelope
+        };
+        int votes[MAX_LABELS] = {0};
+        for (uint16_t t = 0; t < FOREST_MODEL.tree_count; t++) {
+            votes[DecisionForest::evaluate_tree(FOREST_NODES + FOREST_TREE_START[t], values)]++;
+        }
+
+        KnnResult result;
+        int label_id = forest.classify(query, result);
+        float total = 0.0f;
+        for (int i = 0; i < MAX_LABELS; i++) {
+            TEST_ASSERT_EQUAL_FLOAT((float)votes[i] / FOREST_MODEL.tree_count, result.scores[i]);
+            TEST_ASSERT_TRUE(votes[i] <= votes[label_id]);
+            total += result.scores[i];
+        }
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, total);
+        TEST_ASSERT_EQUAL(label_id, result.top[0]);
+        TEST_ASSERT_EQUAL_FLOAT(result.scores[label_id], result.confidence);
+        for (size_t i = 1; i < result.top_count; i++) {
+            TEST_ASSERT_TRUE(result.scores[result.top[i]] <= result.scores[result.top[i - 1]]);
+            TEST_ASSERT_TRUE(result.scores[result.top[i]] > 0.0f);
+        }
+    }
+}
+
+// Runs both engines over the same fresh queries; prints accuracy, latency
+// and the confusion matrices (rows true, columns predicted, in LABELS order)
+void test_forest_accuracy_and_latency() {
+    static const char* ENGINES[2] = {"knn", "forest"};
+    KNNClassifier classifier;
+    fill(classifier, 1500);
+    classifier.rebuild_index();
+    TEST_ASSERT_TRUE(classifier.load_forest(&FOREST_MODEL));
+
+    for (int e = 0; e < 2; e++) {
+        TEST_ASSERT_TRUE(classifier.set_engine(e == 0 ? ENGINE_KNN : ENGINE_FOREST));
+        int confusion[3][3] = {{0}};
+        int correct = 0;
+        KnnResult result;
+
+        rng_state = QUERY_SEED;
+        clock_t start = clock();
+        for (int q = 0; q < QUERIES; q++) {
+            int cluster = next_random() % 3;
+            int label_id = classifier.classify(make_features(cluster), result);
+            const char* name = classifier.get_label_name(label_id);
+            for (int p = 0; p < 3; p++) {
+                if (strcmp(name, LABELS[p]) == 0) {
+                    confusion[cluster][p]++;
+                    correct += p == cluster;
+                }
+            }
+        }
+        double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / QUERIES;
+
+        float accuracy = (float)correct / QUERIES;
+        printf("FOREST_BENCH: %-6s accuracy %.3f, %.2f us per classify\n", ENGINES[e], accuracy, us);
+        for (int t = 0; t < 3; t++) {
+            printf("FOREST_BENCH: %-6s %-13s %4d %4d %4d\n", ENGINES[e], LABELS[t],
+                   confusion[t][0], confusion[t][1], confusion[t][2]);
+        }
+        TEST_ASSERT_TRUE(accuracy > 0.9f);
+    }
+}
+
+void test_forest_does_not_allocate() {
+    KNNClassifier classifier;
+    classifier.initialize();
+    TEST_ASSERT_TRUE(classifier.load_forest(&FOREST_MODEL));
+    TEST_ASSERT_TRUE(classifier.set_engine(ENGINE_FOREST));
+
+    rng_state = QUERY_SEED;
+    float confidence;
+    size_t before = heap_allocations;
+    for (int q = 0; q < 200; q++) {
+        AudioFeatures query = make_features(q % 3);
+        KnnResult result;
+        classifier.classify(query, result);
+        classifier.get_label_name(classifier.classify_id(query, confidence));
+    }
+    TEST_ASSERT_EQUAL(0, heap_allocations - before);
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_engine_needs_a_forest);
+    RUN_TEST(test_result_counts_tree_votes);
+    RUN_TEST(test_forest_accuracy_and_latency);
+    RUN_TEST(test_forest_does_not_allocate);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -0,0 +1,562 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "KNNClassifier.h"
+#include "CrossValidation.h"
+#include "DspKernels.h"
+#include "../support/test_fixture.h"
+
+#if MAX_TRAINING_SAMPLES < 10000
+#error "test_knn_classifier needs -DMAX_TRAINING_SAMPLES=10000 (see [env:native])"
+#endif
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_insufficient_data() {
+    KNNClassifier classifier;
+    fill(classifier, MIN_TRAINING_SAMPLES - 1);
+    float confidence = 1.0f;
+    TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, classifier.classify_id(make_features(0), confidence));
+    TEST_ASSERT_EQUAL_STRING("insufficient_data", classifier.get_label_name(KNN_INSUFFICIENT_DATA));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, confidence);
+    KnnResult result;
+    TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, classifier.classify(make_features(0), result));
+    TEST_ASSERT_EQUAL(0, result.top_count);
+}
+
+void test_labels_map_to_ids() {
+    KNNClassifier classifier;
+    fill(classifier, 100);
+    TEST_ASSERT_EQUAL(3, classifier.get_label_count());
+    for (size_t i = 0; i < classifier.get_sample_count(); i++) {
+        TEST_ASSERT_TRUE(classifier.get_sample_label(i) < 3);
+    }
+    TEST_ASSERT_EQUAL_STRING("unknown", classifier.get_label_name(KNN_REJECTED));
+    TEST_ASSERT_FALSE(classifier.add_sample(make_features(0), "sixteen_chars_xx"));
+    TEST_ASSERT_FALSE(classifier.add_sample(make_features(0), ""));
+
+    // Each new label takes a slot; existing labels never fail for that reason
+    for (int i = 3; i < MAX_LABELS; i++) {
+        char label[16];
+        snprintf(label, sizeof(label), "class_%d", i);
+        TEST_ASSERT_TRUE(classifier.add_sample(make_features(0), label));
+        TEST_ASSERT_EQUAL_STRING(label, classifier.get_label_name(i));
+    }
+    TEST_ASSERT_FALSE(classifier.add_sample(make_features(0), "one_too_many"));
+    TEST_ASSERT_TRUE(classifier.add_sample(make_features(0), LABELS[0]));
+}
+
+// classify() agrees with classify_id() and reports every label's weighted
+// vote share, with the top labels ranked from the winner down
+void test_result_ranks_labels() {
+    KNNClassifier classifier;
+    fill(classifier, 1000);
+
+    rng_state = 55;
+    for (int q = 0; q < 100; q++) {
+        AudioFeatures query = make_features(q % 3);
+        KnnResult result;
+        int label_id = classifier.classify(query, result);
+        float confidence;
+        TEST_ASSERT_EQUAL(classifier.classify_id(query, confidence), label_id);
+        TEST_ASSERT_TRUE(confidence == result.confidence);
+
+        // Scores are inverse-distance weighted vote shares that sum to 1;
+        // the ranking is by score and starts with the winner
+        Neighbor nearest[K_NEIGHBORS];
+        size_t k = classifier.find_neighbors(query, nearest);
+        float weights[MAX_LABELS] = {0};
+        float weight_total = 0.0f;
+        for (size_t i = 0; i < k; i++) {
+            float weight = 1.0f / (sqrtf(nearest[i].distance) + KNN_WEIGHT_EPSILON);
+            weights[classifier.get_sample_label(nearest[i].index)] += weight;
+            weight_total += weight;
+        }
+        float total = 0.0f;
+        size_t voted = 0;
+        for (size_t l = 0; l < MAX_LABELS; l++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, weights[l] / weight_total, result.scores[l]);
+            total += result.scores[l];
+            voted += result.scores[l] > 0.0f;
+        }
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, total);
+        TEST_ASSERT_EQUAL(voted < KNN_TOP_LABELS ? voted : KNN_TOP_LABELS, result.top_count);
+        TEST_ASSERT_EQUAL(label_id, result.top[0]);
+        TEST_ASSERT_TRUE(result.confidence == result.scores[label_id]);
+        for (size_t i = 1; i < result.top_count; i++) {
+            TEST_ASSERT_TRUE(result.scores[result.top[i]] > 0.0f);
+            TEST_ASSERT_TRUE(result.scores[result.top[i]] <= result.scores[result.top[i - 1]]);
+        }
+    }
+}
+
+// The table maps the winner's share to a probability without changing
+// the ranking; bad tables are refused and clear_data() drops the table
+void test_calibration_maps_confidence() {
+    KNNClassifier classifier;
+    fill(classifier, 1000);
+    KnnCalibration table;
+    table.count = 3;
+    table.share[0] = 0.4f;
+    table.probability[0] = 0.2f;
+    table.share[1] = 0.7f;
+    table.probability[1] = 0.5f;
+    table.share[2] = 0.9f;
+    table.probability[2] = 0.95f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.2f, table.apply(0.1f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.35f, table.apply(0.55f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.95f, table.apply(1.0f));
+    TEST_ASSERT_TRUE(classifier.set_calibration(table));
+
+    rng_state = 77;
+    for (int q = 0; q < 50; q++) {
+        AudioFeatures query = make_features(q % 3);
+        KnnResult result;
+        int label_id = classifier.classify(query, result);
+        TEST_ASSERT_EQUAL(label_id, result.top[0]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, table.apply(result.scores[label_id]), result.confidence);
+    }
+
+    KnnCalibration bad = table;
+    bad.probability[2] = 0.4f;      // Not monotonic
+    TEST_ASSERT_FALSE(classifier.set_calibration(bad));
+    bad = table;
+    bad.share[1] = NAN;
+    TEST_ASSERT_FALSE(classifier.set_calibration(bad));
+    bad = table;
+    bad.probability[1] = NAN;
+    TEST_ASSERT_FALSE(classifier.set_calibration(bad));
+    bad = table;
+    bad.count = KNN_CALIBRATION_POINTS + 1;
+    TEST_ASSERT_FALSE(classifier.set_calibration(bad));
+    TEST_ASSERT_EQUAL(3, classifier.get_calibration().count);
+
+    classifier.clear_data();
+    TEST_ASSERT_EQUAL(0, classifier.get_calibration().count);
+}
+
+// Every search mode (KD-tree on/off, early abandon on/off) must return the
+// full linear scan's neighbours exactly
+static void check_index_matches_linear(size_t samples, FeatureMask mask) {
+    KNNClassifier classifier;
+    fill(classifier, samples);
+    classifier.set_feature_mask(mask);
+
+    for (int q = 0; q < 200; q++) {
+        AudioFeatures query = make_features(q % 3);
+        Neighbor linear[K_NEIGHBORS];
+        classifier.set_use_index(false);
+        classifier.set_early_abandon(false);
+        size_t linear_count = classifier.find_neighbors(query, linear);
+        float linear_confidence;
+        int linear_label = classifier.classify_id(query, linear_confidence);
+
+        for (int mode = 1; mode < 4; mode++) {
+            Neighbor other[K_NEIGHBORS];
+            classifier.set_use_index(mode & 1);
+            classifier.set_early_abandon(mode & 2);
+            size_t other_count = classifier.find_neighbors(query, other);
+            float other_confidence;
+            int other_label = classifier.classify_id(query, other_confidence);
+
+            TEST_ASSERT_EQUAL(linear_count, other_count);
+            for (size_t i = 0; i < linear_count; i++) {
+                TEST_ASSERT_EQUAL(linear[i].index, other[i].index);
+                TEST_ASSERT_TRUE(linear[i].distance == other[i].distance);
+            }
+            TEST_ASSERT_EQUAL(linear_label, other_label);
+            TEST_ASSERT_TRUE(linear_confidence == other_confidence);
+        }
+    }
+}
+
+void test_index_matches_linear_scan() {
+    check_index_matches_linear(100, FEATURE_MASK_ALL);
+    check_index_matches_linear(1000, FEATURE_MASK_ALL);
+    check_index_matches_linear(10000, FEATURE_MASK_ALL);
+}
+
+void test_index_matches_linear_scan_with_mask() {
+    check_index_matches_linear(1000, FEATURE_INFRASOUND_ENERGY | FEATURE_SPECTRAL_CENTROID | FEATURE_SPECTRAL_FLUX);
+}
+
+void test_early_abandon_prunes_work() {
+    KNNClassifier classifier;
+    fill(classifier, 1000);
+    classifier.set_use_index(false);
+
+    classifier.set_early_abandon(false);
+    classifier.reset_search_stats();
+    rng_state = 99;
+    Neighbor nearest[K_NEIGHBORS];
+    for (int q = 0; q < 100; q++) {
+        classifier.find_neighbors(make_features(q % 3), nearest);
+    }
+    KnnSearchStats full = classifier.get_search_stats();
+    TEST_ASSERT_EQUAL(100, full.queries);
+    TEST_ASSERT_EQUAL(100 * 1000, full.candidates);
+    TEST_ASSERT_EQUAL(100 * 1000 * NUM_FEATURES, full.dims_evaluated);
+
+    classifier.set_early_abandon(true);
+    classifier.reset_search_stats();
+    rng_state = 99;
+    for (int q = 0; q < 100; q++) {
+        classifier.find_neighbors(make_features(q % 3), nearest);
+    }
+    KnnSearchStats pruned = classifier.get_search_stats();
+    TEST_ASSERT_TRUE(pruned.dims_evaluated < pruned.candidates * (NUM_FEATURES / 2));
+
+    // A label far from the query is skipped without touching its samples
+    AudioFeatures far = make_features(2);
+    far.infrasound_energy += 40.0f;
+    far.spectral_centroid += 1500.0f;
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(classifier.add_sample(far, "far"));
+    }
+    classifier.reset_search_stats();
+    classifier.find_neighbors(make_features(0), nearest);
+    TEST_ASSERT_TRUE(classifier.get_search_stats().labels_skipped >= 1);
+    TEST_ASSERT_TRUE(classifier.get_search_stats().candidates <= 1000);
+}
+
+void test_index_rebuilt_after_labelling() {
+    KNNClassifier classifier;
+    fill(classifier, 50);
+    Neighbor nearest[K_NEIGHBORS];
+    AudioFeatures query = make_features(2);
+    classifier.find_neighbors(query, nearest);
+
+    // A new sample identical to the query must become the nearest
+    classifier.add_sample(query, "probe");
+    classifier.find_neighbors(query, nearest);
+    TEST_ASSERT_EQUAL(50, nearest[0].index);
+
+    // int8 storage keeps each value to within half a code step
+    float stored[NUM_FEATURES];
+    classifier.get_sample_features(50, stored);
+#if KNN_QUANTIZED
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.0f, nearest[0].distance);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, query.spectral_centroid, stored[4]);
+#else
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, nearest[0].distance);
+    TEST_ASSERT_EQUAL_FLOAT(query.spectral_centroid, stored[4]);
+#endif
+    TEST_ASSERT_EQUAL_STRING("probe", classifier.get_label_name(classifier.get_sample_label(50)));
+}
+
+void test_normalization_follows_training_data() {
+    KNNClassifier classifier;
+    classifier.initialize();
+    rng_state = 4242;
+
+    // Every feature scaled to 3x the reference values, far outside the
+    // documented statistics
+    const size_t count = 1000;
+    AudioFeatures first = make_features(1);
+    for (size_t i = 0; i < count; i++) {
+        AudioFeatures f = i == 0 ? first : make_features(next_random() % 3);
+        AudioFeatures scaled = {f.rms * 3, f.infrasound_energy * 3, f.low_band_energy * 3, f.mid_band_energy * 3,
+                                f.spectral_centroid * 3, f.dominant_frequency * 3, f.spectral_flux * 3,
+                                f.temporal_envelope * 3};
+        if (i == 0) {
+            first = scaled;
+        }
+        TEST_ASSERT_TRUE(classifier.add_sample(scaled, LABELS[i % 3]));
+    }
+
+    // Renormalized in a few one-shot passes, not per sample
+    uint32_t passes = classifier.get_renormalization_count();
+    TEST_ASSERT_TRUE(passes >= 1);
+    TEST_ASSERT_TRUE(passes <= 20);
+
+    const FeatureStats& stats = classifier.get_running_stats();
+    TEST_ASSERT_EQUAL(count, stats.count);
+    float mean[NUM_FEATURES];
+    float std_dev[NUM_FEATURES];
+    classifier.get_normalization(mean, std_dev);
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        TEST_ASSERT_TRUE(fabsf(mean[f] - stats.mean[f]) <= KNN_RENORMALIZE_DRIFT * std_dev[f]);
+    }
+
+    // The first sample survived every pass, although it was far outside the
+    // reference range. int8 codes are re-encoded from its raw values on the
+    // first pass, then re-rounded by up to half a step on each later one.
+    float stored[NUM_FEATURES];
+    classifier.get_sample_features(0, stored);
+#if KNN_QUANTIZED
+    float half_step = 0.5f * KNN_QUANT_RANGE / 127.0f * std_dev[4];
+    TEST_ASSERT_FLOAT_WITHIN(passes * half_step * 1.01f, first.spectral_centroid, stored[4]);
+#else
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f * first.spectral_centroid, first.spectral_centroid, stored[4]);
+#endif
+}
+
+void test_prototype_reduction_bounds_the_set() {
+    static const ReductionMethod METHODS[3] = {REDUCE_CONDENSED, REDUCE_EDITED, REDUCE_KMEANS};
+    const size_t per_class = 16;
+
+    for (int m = 0; m < 3; m++) {
+        KNNClassifier classifier;
+        fill(classifier, 1000);
+        ReductionReport report;
+        TEST_ASSERT_TRUE(classifier.reduce_prototypes(METHODS[m], per_class, report));
+
+        char message[128];
+        snprintf(message, sizeof(message), "KNN_REDUCE:%s 1000 -> %u samples, accuracy %.3f -> %.3f",
+                 reduction_method_name(METHODS[m]), (unsigned)report.samples_after, report.accuracy_before,
+                 report.accuracy_after);
+        TEST_MESSAGE(message);
+
+        TEST_ASSERT_EQUAL(1000, report.samples_before);
+        TEST_ASSERT_EQUAL(report.samples_after, classifier.get_sample_count());
+        TEST_ASSERT_TRUE(report.samples_after <= 3 * per_class);
+        TEST_ASSERT_EQUAL(3, classifier.get_label_count());
+        TEST_ASSERT_TRUE(report.accuracy_after >= 0.75f);
+        if (METHODS[m] == REDUCE_KMEANS) {
+            TEST_ASSERT_TRUE(report.accuracy_after >= report.accuracy_before - 0.05f);
+        }
+
+        float confidence;
+        TEST_ASSERT_TRUE(classifier.classify_id(make_features(0), confidence) >= 0);
+    }
+
+    // Too small a budget leaves the set alone
+    KNNClassifier classifier;
+    fill(classifier, 100);
+    ReductionReport report;
+    TEST_ASSERT_FALSE(classifier.reduce_prototypes(REDUCE_KMEANS, 2, report));
+    TEST_ASSERT_EQUAL(100, classifier.get_sample_count());
+}
+
+void test_classify_does_not_allocate() {
+    KNNClassifier classifier;
+    fill(classifier, 1000);
+    classifier.rebuild_index();
+
+    for (int mode = 0; mode < 2; mode++) {
+        classifier.set_use_index(mode == 1);
+        rng_state = 99;
+        Neighbor nearest[K_NEIGHBORS];
+        float confidence;
+        size_t before = heap_allocations;
+        for (int q = 0; q < 200; q++) {
+            AudioFeatures query = make_features(q % 3);
+            classifier.find_neighbors(query, nearest);
+            classifier.classify_id(query, confidence);
+            classifier.get_label_name(classifier.classify_id(query, confidence));
+            KnnResult result;
+            classifier.classify(query, result);
+        }
+        TEST_ASSERT_EQUAL(0, heap_allocations - before);
+    }
+}
+
+static void count_held(const KNNClassifier& classifier, uint32_t* held) {
+    for (size_t l = 0; l < MAX_LABELS; l++) {
+        held[l] = 0;
+    }
+    for (size_t i = 0; i < classifier.get_sample_count(); i++) {
+        held[classifier.get_sample_label(i)]++;
+    }
+}
+
+// A skewed stream far longer than the budget: every label ends at its
+// quota, holding a uniform sample of its whole stream, and shrinking the
+// budget or adding a label evicts from the largest labels
+void test_memory_budget_keeps_class_reservoirs() {
+    KNNClassifier classifier;
+    classifier.initialize();
+    TEST_ASSERT_FALSE(classifier.set_memory_budget(MIN_TRAINING_SAMPLES - 1, 0));
+    TEST_ASSERT_FALSE(classifier.set_memory_budget(MAX_TRAINING_SAMPLES + 1, 0));
+    TEST_ASSERT_TRUE(classifier.set_memory_budget(300, 0));
+
+    // Label 0 arrives four times as often; the RMS carries the arrival order
+    const int STREAM = 6000;
+    int admissions[3] = {0, 0, 0};
+    rng_state = 99;
+    for (int i = 0; i < STREAM; i++) {
+        int draw = next_random() % 6;
+        int cluster = draw < 4 ? 0 : draw - 3;
+        AudioFeatures features = make_features(cluster);
+        features.rms = (float)i;
+        TEST_ASSERT_TRUE(classifier.add_sample(features, LABELS[cluster]));
+        admissions[classifier.get_last_admission()]++;
+    }
+    TEST_ASSERT_EQUAL(300, classifier.get_sample_count());
+    TEST_ASSERT_EQUAL(300, admissions[SAMPLE_APPENDED]);
+    TEST_ASSERT_EQUAL(STREAM, (int)(classifier.get_label_seen(0) + classifier.get_label_seen(1) +
+                                    classifier.get_label_seen(2)));
+
+    uint32_t held[MAX_LABELS];
+    count_held(classifier, held);
+    double arrival[3] = {0, 0, 0};
+    for (size_t i = 0; i < classifier.get_sample_count(); i++) {
+        float values[NUM_FEATURES];
+        classifier.get_sample_features(i, values);
+        arrival[classifier.get_sample_label(i)] += values[0];
+    }
+    for (int l = 0; l < 3; l++) {
+        TEST_ASSERT_EQUAL(100, held[l]);
+        // Uniform over the stream: the mean arrival is near the middle
+        TEST_ASSERT_FLOAT_WITHIN(STREAM * 0.1f, STREAM / 2.0f, (float)(arrival[l] / held[l]));
+    }
+
+    // A fourth label shares the budget: each new sample takes a row from
+    // the largest label
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(classifier.add_sample(make_features(1), "fourth"));
+        TEST_ASSERT_EQUAL(SAMPLE_REPLACED, classifier.get_last_admission());
+    }
+    count_held(classifier, held);
+    TEST_ASSERT_EQUAL(300, classifier.get_sample_count());
+    TEST_ASSERT_EQUAL(10, held[3]);
+    TEST_ASSERT_EQUAL(290, held[0] + held[1] + held[2]);
+
+    // Shrinking evicts at once, down to the explicit quota
+    uint32_t revision = classifier.get_revision();
+    TEST_ASSERT_TRUE(classifier.set_memory_budget(100, 20));
+    count_held(classifier, held);
+    TEST_ASSERT_EQUAL(70, classifier.get_sample_count());
+    TEST_ASSERT_EQUAL(20, held[0]);
+    TEST_ASSERT_EQUAL(10, held[3]);
+    TEST_ASSERT_TRUE(classifier.get_revision() != revision);
+    KnnResult result;
+    TEST_ASSERT_TRUE(classifier.classify(make_features(0), result) >= 0);
+}
+
+// Leave-one-out with every search method, a slice at a time, agrees with
+// the brute-force pass of reduce_prototypes(), and a new sample cancels it
+void test_cross_validation_matches_brute_force() {
+    KNNClassifier classifier;
+    fill(classifier, 1000);
+    CrossValidation cv;
+    float accuracy[3];
+    for (int mode = 0; mode < 3; mode++) {
+        classifier.set_use_index(mode == 0);
+        classifier.set_early_abandon(mode == 1);
+        TEST_ASSERT_TRUE(cv.start(classifier));
+        while (cv.step(classifier, 100)) {
+        }
+        accuracy[mode] = cv.get_accuracy();
+    }
+    classifier.set_use_index(KNN_USE_KDTREE);
+    classifier.set_early_abandon(KNN_EARLY_ABANDON);
+    TEST_ASSERT_EQUAL_FLOAT(accuracy[0], accuracy[1]);
+    TEST_ASSERT_EQUAL_FLOAT(accuracy[0], accuracy[2]);
+
+    TEST_ASSERT_TRUE(cv.start(classifier));
+    size_t steps = 1;
+    uint32_t start = DspKernels::cycle_count();
+    while (cv.step(classifier, 64)) {
+        steps++;
+    }
+    uint32_t elapsed = DspKernels::cycle_count() - start;
+    TEST_ASSERT_EQUAL(CV_DONE, cv.get_state());
+    TEST_ASSERT_EQUAL(16, steps);
+    TEST_ASSERT_EQUAL(1000, cv.get_evaluated());
+
+    size_t support = 0;
+    uint32_t diagonal = 0;
+    for (size_t l = 0; l < cv.get_label_count(); l++) {
+        support += cv.get_support(l);
+        diagonal += cv.get_count(l, l);
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, (float)cv.get_count(l, l) / cv.get_support(l), cv.get_recall(l));
+    }
+    TEST_ASSERT_EQUAL(1000, support);
+    TEST_ASSERT_EQUAL(cv.get_correct(), diagonal);
+
+    KNNClassifier reference;
+    fill(reference, 1000);
+    ReductionReport report;
+    TEST_ASSERT_TRUE(reference.reduce_prototypes(REDUCE_CONDENSED, 32, report));
+#if KNN_QUANTIZED
+    // Re-ranking only the int8 candidates may order far ties differently
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, report.accuracy_before, cv.get_accuracy());
+#else
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, report.accuracy_before, cv.get_accuracy());
+#endif
+    char message[128];
+    snprintf(message, sizeof(message), "CV_BENCH:1000 samples, accuracy %.3f, %lu per held-out sample",
+             (double)cv.get_accuracy(), (unsigned long)(elapsed / 1000));
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_TRUE(cv.start(classifier));
+    TEST_ASSERT_TRUE(cv.step(classifier, 10));
+    TEST_ASSERT_TRUE(classifier.add_sample(make_features(0), LABELS[0]));
+    TEST_ASSERT_FALSE(cv.step(classifier, 10));
+    TEST_ASSERT_EQUAL(CV_CANCELLED, cv.get_state());
+    cv.clear();
+    TEST_ASSERT_EQUAL(CV_IDLE, cv.get_state());
+}
+
+// Prints classify latency and dimensions summed per candidate for the
+// linear scan, the KD-tree and the linear scan with early abandoning
+void test_benchmark_classify_latency() {
+    static const size_t SIZES[3] = {100, 1000, 10000};
+    static const char* MODES[3] = {"linear", "kdtree", "linear+abandon"};
+    const int queries = 200;
+    KNNClassifier classifier;
+
+    for (int s = 0; s < 3; s++) {
+        fill(classifier, SIZES[s]);
+        classifier.rebuild_index();
+
+        for (int mode = 0; mode < 3; mode++) {
+            classifier.set_use_index(mode == 1);
+            classifier.set_early_abandon(mode == 2);
+            classifier.reset_search_stats();
+            rng_state = 777;
+            float confidence;
+            uint32_t start = DspKernels::cycle_count();
+            for (int q = 0; q < queries; q++) {
+                classifier.classify_id(make_features(q % 3), confidence);
+            }
+            uint32_t elapsed = (DspKernels::cycle_count() - start) / queries;
+            const KnnSearchStats& stats = classifier.get_search_stats();
+
+            char message[128];
+            snprintf(message, sizeof(message),
+                     "KNN_BENCH:%u samples, %s %lu per classify, %.0f candidates, %.2f dims per candidate",
+                     (unsigned)SIZES[s], MODES[mode], (unsigned long)elapsed,
+                     (double)stats.candidates / stats.queries, (double)stats.dims_evaluated / stats.candidates);
+            TEST_MESSAGE(message);
+        }
+    }
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_insufficient_data);
+    RUN_TEST(test_labels_map_to_ids);
+    RUN_TEST(test_result_ranks_labels);
+    RUN_TEST(test_calibration_maps_confidence);
+    RUN_TEST(test_index_matches_linear_scan);
+    RUN_TEST(test_index_matches_linear_scan_with_mask);
+    RUN_TEST(test_early_abandon_prunes_work);
+    RUN_TEST(test_index_rebuilt_after_labelling);
+    RUN_TEST(test_normalization_follows_training_data);
+    RUN_TEST(test_prototype_reduction_bounds_the_set);
+    RUN_TEST(test_classify_does_not_allocate);
+    RUN_TEST(test_cross_validation_matches_brute_force);
+    RUN_TEST(test_memory_budget_keeps_class_reservoirs);
+    RUN_TEST(test_benchmark_classify_latency);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -0,0 +1,199 @@
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "KNNClassifier.h"
+
+#if !KNN_QUANTIZED
+#error "test_knn_quantized needs -DKNN_QUANTIZED=1 (see [env:native_knn_q8])"
+#endif
+
+// Documented feature statistics (docs/TECHNICAL_DEEP_DIVE.md), used to
+// generate the data
+static const float MEAN[NUM_FEATURES] = {0.025f, 1.0f, 0.06f, 0.005f, 85.0f, 50.0f, 0.2f, 0.25f};
+static const float STD[NUM_FEATURES] = {0.008f, 0.4f, 0.03f, 0.002f, 15.0f, 25.0f, 0.1f, 0.08f};
+
+static const char* LABELS[3] = {"elephant", "not_elephant", "vehicle"};
+
+static uint32_t rng_state;
+
+static float next_uniform() {
+    rng_state = rng_state * 1664525UL + 1013904223UL;
+    return (rng_state >> 8) / 16777216.0f;
+}
+
+// Continuous values around a per-class centre, +-2.5 std per feature
+static void make_values(int cluster, float* v) {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        float centre = MEAN[f] + (cluster - 1) * 1.2f * STD[f];
+        v[f] = centre + (next_uniform() * 5.0f - 2.5f) * STD[f];
+    }
+}
+
+static AudioFeatures to_features(const float* v) {
+    AudioFeatures features = {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]};
+    return features;
+}
+
+struct ReferenceSet {
+    float values[1000][NUM_FEATURES];
+    int labels[1000];
+    size_t count;
+};
+
+static ReferenceSet reference;
+
+// The classifier's own normalization, which the reference distance follows
+static float model_mean[NUM_FEATURES];
+static float model_std[NUM_FEATURES];
+
+static void fill(KNNClassifier& classifier, size_t count) {
+    classifier.initialize();
+    rng_state = 2024;
+    reference.count = count;
+    for (size_t i = 0; i < count; i++) {
+        int cluster = (int)(next_uniform() * 3.0f);
+        make_values(cluster, reference.values[i]);
+        reference.labels[i] = cluster;
+        TEST_ASSERT_TRUE(classifier.add_sample(to_features(reference.values[i]), LABELS[cluster]));
+    }
+    classifier.get_normalization(model_mean, model_std);
+}
+
+// Float brute force with the classifier's ordering and vote rules
+static int reference_classify(const float* query, Neighbor* nearest) {
+    size_t k = 0;
+    for (size_t i = 0; i < reference.count; i++) {
+        float sum = 0.0f;
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            float d = (query[f] - reference.values[i][f]) / model_std[f];
+            sum += d * d;
+        }
+        if (k < K_NEIGHBORS) {
+            k++;
+        } else if (!neighbor_before(sum, i, nearest[K_NEIGHBORS - 1])) {
+            continue;
+        }
+        size_t pos = k - 1;
+        while (pos > 0 && neighbor_before(sum, i, nearest[pos - 1])) {
+            nearest[pos] = nearest[pos - 1];
+            pos--;
+        }
+        nearest[pos].distance = sum;
+        nearest[pos].index = (uint32_t)i;
+    }
+
+    int votes[3] = {0, 0, 0};
+    for (size_t i = 0; i < k; i++) {
+        votes[reference.labels[nearest[i].index]]++;
+    }
+    int prediction = reference.labels[nearest[0].index];
+    for (size_t i = 1; i < k; i++) {
+        if (votes[reference.labels[nearest[i].index]] > votes[prediction]) {
+            prediction = reference.labels[nearest[i].index];
+        }
+    }
+    return prediction;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Each renormalization pass re-rounds the codes, adding up to half a step
+void test_codes_round_trip_within_rounding() {
+    KNNClassifier classifier;
+    fill(classifier, 200);
+    uint32_t roundings = classifier.get_renormalization_count() + 1;
+    for (size_t i = 0; i < reference.count; i++) {
+        float decoded[NUM_FEATURES];
+        classifier.get_sample_features(i, decoded);
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            float half_step = 0.5f * KNN_QUANT_RANGE / 127.0f * model_std[f];
+            TEST_ASSERT_FLOAT_WITHIN(roundings * half_step * 1.5f, reference.values[i][f], decoded[f]);
+        }
+    }
+}
+
+void test_out_of_range_values_saturate() {
+    KNNClassifier classifier;
+    classifier.initialize();
+    float v[NUM_FEATURES];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        v[f] = MEAN[f] + 100.0f * STD[f];
+    }
+    classifier.add_sample(to_features(v), "loud");
+    float decoded[NUM_FEATURES];
+    classifier.get_sample_features(0, decoded);
+    classifier.get_normalization(model_mean, model_std);
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        TEST_ASSERT_TRUE(decoded[f] > model_mean[f] + (KNN_QUANT_RANGE - 0.5f) * model_std[f]);
+        TEST_ASSERT_TRUE(decoded[f] < model_mean[f] + (KNN_QUANT_RANGE + 0.5f) * model_std[f]);
+    }
+}
+
+// Labels, neighbour sets and distances against a float brute force. The
+// measured figures are printed; the asserts hold the tolerance.
+void test_matches_float_reference() {
+    KNNClassifier classifier;
+    fill(classifier, 1000);
+    const int queries = 1000;
+    int label_matches = 0;
+    int neighbour_matches = 0;
+    float worst_error = 0.0f;
+
+    rng_state = 99;
+    for (int q = 0; q < queries; q++) {
+        float query[NUM_FEATURES];
+        make_values(q % 3, query);
+
+        Neighbor expected[K_NEIGHBORS];
+        int expected_label = reference_classify(query, expected);
+
+        Neighbor nearest[K_NEIGHBORS];
+        float confidence;
+        classifier.find_neighbors(to_features(query), nearest);
+        int label = classifier.classify_id(to_features(query), confidence);
+
+        label_matches += strcmp(classifier.get_label_name(label), LABELS[expected_label]) == 0;
+        for (int i = 0; i < K_NEIGHBORS; i++) {
+            for (int j = 0; j < K_NEIGHBORS; j++) {
+                neighbour_matches += nearest[i].index == expected[j].index;
+            }
+            float error = fabsf(sqrtf(nearest[i].distance) - sqrtf(expected[i].distance));
+            worst_error = error > worst_error ? error : worst_error;
+        }
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "KNN_Q8:label agreement %.1f%%, neighbour recall %.1f%%, max distance error %.3f std",
+             100.0f * label_matches / queries, 100.0f * neighbour_matches / (queries * K_NEIGHBORS), worst_error);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_TRUE(label_matches >= queries * 98 / 100);
+    TEST_ASSERT_TRUE(neighbour_matches >= queries * K_NEIGHBORS * 97 / 100);
+    TEST_ASSERT_TRUE(worst_error < 0.1f);
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_codes_round_trip_within_rounding);
+    RUN_TEST(test_out_of_range_values_saturate);
+    RUN_TEST(test_matches_float_reference);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -0,0 +1,263 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "KNNClassifier.h"
+#include "../support/test_fixture.h"
+
+static void to_values(const AudioFeatures& features, float* v) {
+    v[0] = features.rms;
+    v[1] = features.infrasound_energy;
+    v[2] = features.low_band_energy;
+    v[3] = features.mid_band_energy;
+    v[4] = features.spectral_centroid;
+    v[5] = features.dominant_frequency;
+    v[6] = features.spectral_flux;
+    v[7] = features.temporal_envelope;
+}
+
+static const uint32_t QUERY_SEED = 777;
+static const int QUERIES = 600;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_needs_training_samples() {
+    KNNClassifier classifier;
+    classifier.initialize();
+    TEST_ASSERT_TRUE(classifier.set_engine(ENGINE_LINEAR));
+    TEST_ASSERT_EQUAL(classifier.get_feature_mask(), classifier.get_required_features());
+
+    KnnResult result;
+    rng_state = 1;
+    for (int i = 0; i < MIN_TRAINING_SAMPLES; i++) {
+        TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, classifier.classify(make_features(0), result));
+        TEST_ASSERT_TRUE(classifier.add_sample(make_features(i % 3), LABELS[i % 3]));
+    }
+    TEST_ASSERT_EQUAL(MIN_TRAINING_SAMPLES, classifier.get_linear().get_sample_count());
+    TEST_ASSERT_TRUE(classifier.classify(make_features(0), result) >= 0);
+
+    classifier.clear_data();
+    TEST_ASSERT_EQUAL(0, classifier.get_linear().get_sample_count());
+    TEST_ASSERT_EQUAL(KNN_INSUFFICIENT_DATA, classifier.classify(make_features(0), result));
+}
+
+// Scores are the softmax of w . z + b over the normalized query, ranked in top
+void test_scores_are_softmax_of_logits() {
+    KNNClassifier classifier;
+    fill(classifier, 300);
+    TEST_ASSERT_TRUE(classifier.set_engine(ENGINE_LINEAR));
+    const LinearState& state = classifier.get_linear().get_state();
+    float mean[NUM_FEATURES];
+    float std_dev[NUM_FEATURES];
+    classifier.get_normalization(mean, std_dev);
+
+    rng_state = QUERY_SEED;
+    for (int q = 0; q < 100; q++) {
+        AudioFeatures query = make_features(q % 3);
+        float v[NUM_FEATURES];
+        to_values(query, v);
+        double logits[3];
+        double largest = -INFINITY;
+        for (int label = 0; label < 3; label++) {
+            logits[label] = state.bias[label];
+            for (int f = 0; f < NUM_FEATURES; f++) {
+                logits[label] += state.weights[label][f] * (v[f] - mean[f]) / std_dev[f];
+            }
+            largest = logits[label] > largest ? logits[label] : largest;
+        }
+        double total = 0.0;
+        for (int label = 0; label < 3; label++) {
+            total += exp(logits[label] - largest);
+        }
+
+        KnnResult result;
+        int label_id = classifier.classify(query, result);
+        float sum = 0.0f;
+        for (int label = 0; label < 3; label++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)(exp(logits[label] - largest) / total), result.scores[label]);
+            sum += result.scores[label];
+        }
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, sum);
+        TEST_ASSERT_EQUAL(3, result.top_count);
+        TEST_ASSERT_EQUAL(label_id, result.top[0]);
+        TEST_ASSERT_EQUAL_FLOAT(result.scores[label_id], result.confidence);
+        for (size_t i = 1; i < result.top_count; i++) {
+            TEST_ASSERT_TRUE(result.scores[result.top[i]] <= result.scores[result.top[i - 1]]);
+        }
+    }
+}
+
+// Renormalizing the training set must not change what the engine predicts
+void test_rebase_keeps_logits() {
+    LinearClassifier linear;
+    rng_state = 99;
+    float old_mean[NUM_FEATURES], old_inv_std[NUM_FEATURES], mean[NUM_FEATURES], inv_std[NUM_FEATURES];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        old_mean[f] = (float)(next_random() % 200) / 100.0f;
+        old_inv_std[f] = 0.5f + (float)(next_random() % 100) / 50.0f;
+        mean[f] = old_mean[f] + (float)((int)(next_random() % 100) - 50) / 100.0f;
+        inv_std[f] = old_inv_std[f] * (0.7f + (float)(next_random() % 60) / 100.0f);
+    }
+    for (int i = 0; i < 200; i++) {
+        float z[NUM_FEATURES];
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            z[f] = (float)((int)(next_random() % 400) - 200) / 100.0f;
+        }
+        linear.train(z, (uint8_t)(i % 4), 4);
+    }
+
+    for (int q = 0; q < 50; q++) {
+        float x[NUM_FEATURES], z_old[NUM_FEATURES], z_new[NUM_FEATURES];
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            x[f] = (float)(next_random() % 400) / 100.0f;
+            z_old[f] = (x[f] - old_mean[f]) * old_inv_std[f];
+            z_new[f] = (x[f] - mean[f]) * inv_std[f];
+        }
+        LinearClassifier rebased = linear;
+        rebased.rebase(old_mean, old_inv_std, mean, inv_std);
+        float before[4], after[4];
+        linear.logits(z_old, 4, before);
+        rebased.logits(z_new, 4, after);
+        for (int label = 0; label < 4; label++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3f * (1.0f + fabsf(before[label])), before[label], after[label]);
+        }
+    }
+
+    // Features outside the mask lose their weights
+    linear.restrict_features(0x0F);
+    for (int label = 0; label < 4; label++) {
+        for (int f = 4; f < NUM_FEATURES; f++) {
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, linear.get_state().weights[label][f]);
+        }
+    }
+}
+
+// Weights exported in raw units (as tools/linear_trainer writes them) give
+// the same answers on a classifier with other statistics and label order
+void test_offline_model_round_trip() {
+    KNNClassifier trained;
+    fill(trained, 600);
+    float mean[NUM_FEATURES], std_dev[NUM_FEATURES], inv_std[NUM_FEATURES];
+    trained.get_normalization(mean, std_dev);
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        inv_std[f] = 1.0f / std_dev[f];
+    }
+    static float weights[3 * NUM_FEATURES];
+    static float bias[3];
+    static const char* names[3];
+    for (uint8_t label = 0; label < 3; label++) {
+        trained.get_linear().get_raw(label, mean, inv_std, weights + label * NUM_FEATURES, bias[label]);
+        names[label] = trained.get_label_name(label);
+    }
+    LinearModel model = {weights, bias, names, 3, FEATURE_MASK_ALL, 600};
+
+    KNNClassifier loaded;
+    loaded.initialize();
+    TEST_ASSERT_FALSE(loaded.load_linear(nullptr));
+    static const char* too_long[1] = {"a_label_that_is_too_long"};
+    LinearModel bad = {weights, bias, too_long, 1, FEATURE_MASK_ALL, 600};
+    TEST_ASSERT_FALSE(loaded.load_linear(&bad));
+    TEST_ASSERT_EQUAL(0, loaded.get_label_count());
+
+    TEST_ASSERT_TRUE(loaded.load_linear(&model));
+    TEST_ASSERT_TRUE(loaded.set_engine(ENGINE_LINEAR));
+    TEST_ASSERT_TRUE(trained.set_engine(ENGINE_LINEAR));
+    TEST_ASSERT_EQUAL(3, loaded.get_label_count());
+
+    rng_state = QUERY_SEED;
+    for (int q = 0; q < 200; q++) {
+        AudioFeatures query = make_features(q % 3);
+        KnnResult a, b;
+        int id_a = trained.classify(query, a);
+        int id_b = loaded.classify(query, b);
+        TEST_ASSERT_EQUAL_STRING(trained.get_label_name(id_a), loaded.get_label_name(id_b));
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, a.confidence, b.confidence);
+    }
+}
+
+// Both engines over the same fresh queries after one online pass; prints
+// accuracy, latency and the linear confusion matrix (rows true, columns
+// predicted, in LABELS order)
+void test_linear_accuracy_and_latency() {
+    static const char* ENGINES[2] = {"knn", "linear"};
+    KNNClassifier classifier;
+    fill(classifier, 1500);
+    classifier.rebuild_index();
+
+    for (int e = 0; e < 2; e++) {
+        TEST_ASSERT_TRUE(classifier.set_engine(e == 0 ? ENGINE_KNN : ENGINE_LINEAR));
+        int confusion[3][3] = {{0}};
+        int correct = 0;
+        KnnResult result;
+
+        rng_state = QUERY_SEED;
+        clock_t start = clock();
+        for (int q = 0; q < QUERIES; q++) {
+            int cluster = next_random() % 3;
+            int label_id = classifier.classify(make_features(cluster), result);
+            const char* name = classifier.get_label_name(label_id);
+            for (int p = 0; p < 3; p++) {
+                if (strcmp(name, LABELS[p]) == 0) {
+                    confusion[cluster][p]++;
+                    correct += p == cluster;
+                }
+            }
+        }
+        double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / QUERIES;
+
+        float accuracy = (float)correct / QUERIES;
+        printf("LINEAR_BENCH: %-6s accuracy %.3f, %.2f us per classify\n", ENGINES[e], accuracy, us);
+        for (int t = 0; t < 3 && e == 1; t++) {
+            printf("LINEAR_BENCH: %-6s %-13s %4d %4d %4d\n", ENGINES[e], LABELS[t],
+                   confusion[t][0], confusion[t][1], confusion[t][2]);
+        }
+        TEST_ASSERT_TRUE(accuracy > 0.9f);
+    }
+}
+
+void test_linear_does_not_allocate() {
+    KNNClassifier classifier;
+    fill(classifier, 100);
+    TEST_ASSERT_TRUE(classifier.set_engine(ENGINE_LINEAR));
+
+    rng_state = QUERY_SEED;
+    float confidence;
+    size_t before = heap_allocations;
+    for (int q = 0; q < 200; q++) {
+        AudioFeatures query = make_features(q % 3);
+        KnnResult result;
+        classifier.classify(query, result);
+        classifier.get_label_name(classifier.classify_id(query, confidence));
+    }
+    TEST_ASSERT_EQUAL(0, heap_allocations - before);
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_needs_training_samples);
+    RUN_TEST(test_scores_are_softmax_of_logits);
+    RUN_TEST(test_rebase_keeps_logits);
+    RUN_TEST(test_offline_model_round_trip);
+    RUN_TEST(test_linear_accuracy_and_latency);
+    RUN_TEST(test_linear_does_not_allocate);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -0,0 +1,149 @@
+#include <unity.h>
+#include "SpscRingBuffer.h"
+
+typedef SpscRingBuffer<int16_t, 8> SmallRing;
+
+// Pushes count consecutive values starting at *next
+static bool push_run(SmallRing& ring, int16_t* next, size_t count) {
+    int16_t values[8];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int16_t)(*next + i);
+    }
+    bool pushed = ring.push(values, count);
+    if (pushed) {
+        *next += (int16_t)count;
+    }
+    return pushed;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Head and tail run freely; a block that crosses the end of the storage is
+// split between its last and first slots and pops back in order
+void test_push_wraps_around() {
+    SmallRing ring;
+    int16_t next = 0;
+    int16_t out[8];
+    for (int round = 0; round < 5; round++) {
+        int16_t first = next;
+        TEST_ASSERT_TRUE(push_run(ring, &next, 5));
+        TEST_ASSERT_EQUAL(5, ring.size());
+        TEST_ASSERT_EQUAL(5, ring.pop(out, 8));
+        for (int i = 0; i < 5; i++) {
+            TEST_ASSERT_EQUAL_INT16(first + i, out[i]);
+        }
+        TEST_ASSERT_EQUAL(0, ring.size());
+    }
+    TEST_ASSERT_EQUAL(0, ring.get_overrun_count());
+}
+
+// peek() stops at the end of the storage; the rest of the block is the
+// next peek, from slot 0
+void test_peek_and_consume_across_the_wrap() {
+    SmallRing ring;
+    int16_t next = 0;
+    int16_t out[8];
+    TEST_ASSERT_TRUE(push_run(ring, &next, 6));
+    TEST_ASSERT_EQUAL(6, ring.pop(out, 6));
+    TEST_ASSERT_TRUE(push_run(ring, &next, 5));
+
+    const int16_t* data;
+    TEST_ASSERT_EQUAL(2, ring.peek(data));
+    TEST_ASSERT_EQUAL_INT16(6, data[0]);
+    TEST_ASSERT_EQUAL_INT16(7, data[1]);
+    ring.consume(1);
+    TEST_ASSERT_EQUAL(4, ring.size());
+    TEST_ASSERT_EQUAL(1, ring.peek(data));
+    TEST_ASSERT_EQUAL_INT16(7, data[0]);
+    ring.consume(1);
+
+    TEST_ASSERT_EQUAL(3, ring.peek(data));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT16(8 + i, data[i]);
+    }
+    ring.consume(3);
+    TEST_ASSERT_EQUAL(0, ring.peek(data));
+    TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+// A block that does not fit is rejected whole: nothing of it is written,
+// and it counts as one overrun of count elements
+void test_overrun_is_all_or_nothing() {
+    SmallRing ring;
+    int16_t next = 0;
+    int16_t out[8];
+    TEST_ASSERT_TRUE(push_run(ring, &next, 5));
+    TEST_ASSERT_FALSE(push_run(ring, &next, 4));
+    TEST_ASSERT_EQUAL(5, ring.size());
+    TEST_ASSERT_EQUAL(1, ring.get_overrun_count());
+    TEST_ASSERT_EQUAL(4, ring.get_dropped_count());
+
+    TEST_ASSERT_TRUE(push_run(ring, &next, 3));
+    TEST_ASSERT_EQUAL(8, ring.size());
+    TEST_ASSERT_FALSE(push_run(ring, &next, 1));
+    TEST_ASSERT_EQUAL(2, ring.get_overrun_count());
+    TEST_ASSERT_EQUAL(5, ring.get_dropped_count());
+
+    TEST_ASSERT_EQUAL(8, ring.pop(out, 8));
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL_INT16(i, out[i]);
+    }
+}
+
+// The mark is the peak fill, not the current one. A reset reads as the
+// current fill at once and is applied by the producer at its next push.
+void test_high_water_mark_and_reset() {
+    SmallRing ring;
+    int16_t next = 0;
+    int16_t out[8];
+    TEST_ASSERT_TRUE(push_run(ring, &next, 3));
+    TEST_ASSERT_EQUAL(3, ring.pop(out, 8));
+    TEST_ASSERT_TRUE(push_run(ring, &next, 2));
+    TEST_ASSERT_EQUAL(3, ring.get_high_water_mark());
+    TEST_ASSERT_TRUE(push_run(ring, &next, 5));
+    TEST_ASSERT_EQUAL(7, ring.get_high_water_mark());
+    TEST_ASSERT_FALSE(push_run(ring, &next, 2));
+
+    TEST_ASSERT_EQUAL(4, ring.pop(out, 4));
+    ring.reset_stats();
+    TEST_ASSERT_EQUAL(3, ring.get_high_water_mark());
+    TEST_ASSERT_EQUAL(0, ring.get_overrun_count());
+    TEST_ASSERT_EQUAL(0, ring.get_dropped_count());
+    TEST_ASSERT_EQUAL(1, ring.pop(out, 1));
+    TEST_ASSERT_EQUAL(2, ring.get_high_water_mark());
+
+    TEST_ASSERT_TRUE(push_run(ring, &next, 1));
+    TEST_ASSERT_EQUAL(3, ring.get_high_water_mark());
+    TEST_ASSERT_EQUAL(3, ring.pop(out, 8));
+    TEST_ASSERT_EQUAL(3, ring.get_high_water_mark());
+
+    ring.clear();
+    TEST_ASSERT_EQUAL(0, ring.get_high_water_mark());
+    TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+int run_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(test_push_wraps_around);
+    RUN_TEST(test_peek_and_consume_across_the_wrap);
+    RUN_TEST(test_overrun_is_all_or_nothing);
+    RUN_TEST(test_high_water_mark_and_reset);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+void setup() {
+    delay(2000);
+    run_tests();
+}
+
+void loop() {}
+#else
+int main() {
+    return run_tests();
+}
+#endif
@@ -21,6 +21,11 @@ import pandas as pd
 from collections import deque
 import math
 
+# Labels counted as an elephant detection; the firmware accepts any label
+# of up to 15 characters without commas, MAX_LABELS (32) in total
+ELEPHANT_LABELS = ("elephant", "rumble", "trumpet")
+FIELD_LABELS = ["rumble", "trumpet", "vehicle", "wind", "rain", "human", "cattle"]
+
 class AdvancedElephantGUI:
     def __init__(self, root):
         self.root = root
@@ -39,6 +44,11 @@ class AdvancedElephantGUI:
         self.current_features = {}
         self.current_classification = "not_elephant"
         self.current_confidence = 0.0
+        self.runner_ups = []  # (label, score) after the winner
+        # Smoothed detection events (DETECTION: lines); the ESP32 sends them
+        # instead of every CLASSIFICATION unless SMOOTHING is off
+        self.event_mode = False
+        self.active_event = None  # Label of the event in progress
         self.feature_history = deque(maxlen=1000)  # Store last 1000 samples
         self.classification_history = deque(maxlen=1000)
         self.training_data = []
@@ -285,6 +295,17 @@ class AdvancedElephantGUI:
                                          padx=15, pady=5, state='disabled')
         self.not_elephant_btn.pack(side='left', padx=3)
         
+        # Any other class, picked from the list or typed in
+        self.custom_label = ttk.Combobox(label_frame, values=FIELD_LABELS, width=10)
+        self.custom_label.set(FIELD_LABELS[0])
+        self.custom_label.pack(side='left', padx=(3, 0))
+        
+        self.custom_label_btn = tk.Button(label_frame, text="LABEL", 
+                                         command=lambda: self.start_labeling(self.custom_label.get().strip()),
+                                         font=('Arial', 10, 'bold'), bg='#3F51B5', fg='white',
+                                         padx=15, pady=5, state='disabled')
+        self.custom_label_btn.pack(side='left', padx=3)
+        
         # Progress indicator
         self.progress_label = tk.Label(label_frame, text="Ready", 
                                       font=('Arial', 9), fg='#4CAF50', bg='#2b2b2b')
@@ -505,6 +526,7 @@ class AdvancedElephantGUI:
             self.disconnect_btn.config(state='normal')
             self.elephant_btn.config(state='normal')
             self.not_elephant_btn.config(state='normal')
+            self.custom_label_btn.config(state='normal')
             self.save_btn.config(state='normal')
             self.clear_btn.config(state='normal')
             self.analyze_btn.config(state='normal')
@@ -533,6 +555,7 @@ class AdvancedElephantGUI:
             self.disconnect_btn.config(state='disabled')
             self.elephant_btn.config(state='disabled')
             self.not_elephant_btn.config(state='disabled')
+            self.custom_label_btn.config(state='disabled')
             self.save_btn.config(state='disabled')
             self.clear_btn.config(state='disabled')
             self.analyze_btn.config(state='disabled')
@@ -583,6 +606,8 @@ class AdvancedElephantGUI:
                 self.parse_features(line)
             elif line.startswith("CLASSIFICATION:"):
                 self.parse_classification(line)
+            elif line.startswith("DETECTION:"):
+                self.parse_detection(line)
             elif line.startswith("STATUS:"):
                 self.parse_status(line)
             elif line.startswith("ERROR:"):
@@ -621,9 +646,17 @@ class AdvancedElephantGUI:
             if len(parts) >= 2:  # Changed from >= 3 to >= 2
                 self.current_classification = parts[0].strip()
                 self.current_confidence = float(parts[1].strip())
+                # With smoothing on, a CLASSIFICATION only follows a
+                # DETECTION:start for the same label; any other means it is off
+                if self.event_mode and self.current_classification != self.active_event:
+                    self.event_mode = False
+                    self.active_event = None
+                # Optional runner-up label,score pairs after the level
+                self.runner_ups = [(parts[i].strip(), float(parts[i + 1]))
+                                   for i in range(3, len(parts) - 1, 2)]
                 
                 # Track sample counts based on classification
-                if self.current_classification.lower() == 'elephant':
+                if self.current_classification.lower() in ELEPHANT_LABELS:
                     self.stats['elephant_samples'] += 1
                 else:
                     self.stats['other_samples'] += 1
@@ -638,6 +671,30 @@ class AdvancedElephantGUI:
         except Exception as e:
             self.log_message(f"❌ Classification parsing error: {str(e)} for line: {line}")
     
+    def parse_detection(self, line):
+        """Parse a smoothed detection event: start,label,start_ms,confidence
+        or end,label,start_ms,end_ms,peak_confidence"""
+        try:
+            parts = line[10:].split(",")  # Remove "DETECTION:" prefix
+            if parts[0] == "start" and len(parts) >= 4:
+                self.event_mode = True
+                self.active_event = parts[1].strip()
+                self.current_classification = self.active_event
+                self.current_confidence = float(parts[3])
+                self.runner_ups = []
+                self.log_message(f"🎯 Detection started: {self.active_event}, Confidence: {self.current_confidence}")
+            elif parts[0] == "end" and len(parts) >= 5:
+                self.event_mode = True
+                self.active_event = None
+                duration = (int(parts[3]) - int(parts[2])) / 1000.0
+                self.log_message(f"🎯 Detection ended: {parts[1].strip()} after {duration:.1f}s, peak confidence {float(parts[4])}")
+            else:
+                self.log_message(f"⚠️ Invalid detection format: {line}")
+                return
+            self.update_detection_display()
+        except Exception as e:
+            self.log_message(f"❌ Detection parsing error: {str(e)} for line: {line}")
+    
     def parse_status(self, line):
         """Parse status data"""
         try:
@@ -667,7 +724,19 @@ class AdvancedElephantGUI:
         current_time = time.time()
         
         # Determine current detection state
-        if self.current_classification == "elephant" and self.current_confidence == 1.0:
+        if self.event_mode:
+            # The ESP32 has already debounced: an event lasts from its
+            # DETECTION:start to its DETECTION:end, with no timer
+            if self.active_event in ELEPHANT_LABELS:
+                new_detection_state = "elephant_high"
+            else:
+                new_detection_state = "no_elephant"
+            self.detection_locked = False
+            if new_detection_state == self.last_detection_state == "elephant_high":
+                # Same event, already shown and counted
+                self.detection_locked = True
+                self.detection_timer_start = current_time
+        elif self.current_classification in ELEPHANT_LABELS and self.current_confidence == 1.0:
             new_detection_state = "elephant_high"
         else:
             new_detection_state = "no_elephant"
@@ -715,11 +784,16 @@ class AdvancedElephantGUI:
             self.last_detection_state = "no_elephant"
         
         # Update classification labels
-        self.classification_label.config(text=f"Classification: {self.current_classification}")
+        text = f"Classification: {self.current_classification}"
+        if self.runner_ups:
+            text += " (" + ", ".join(f"{label} {score:.2f}" for label, score in self.runner_ups) + ")"
+        self.classification_label.config(text=text)
         self.confidence_label.config(text=f"Confidence: {self.current_confidence*100:.1f}%")
         
-        # Update timer display
-        if self.detection_locked and self.last_detection_state != "no_elephant":
+        # Update timer display; an event has no timer, it lasts until its end
+        if self.event_mode and self.active_event is not None:
+            self.timer_label.config(text=f"Detection active: {self.active_event}")
+        elif self.detection_locked and self.last_detection_state != "no_elephant":
             remaining = max(0, self.detection_timer_duration - (current_time - self.detection_timer_start))
             self.timer_label.config(text=f"Detection active: {remaining:.1f}s remaining")
         else:
@@ -769,6 +843,10 @@ class AdvancedElephantGUI:
         if self.is_labeling:
             self.log_message("❌ Already labeling, please wait...")
             return
+        
+        if not label or len(label) > 15 or ',' in label:
+            self.log_message("❌ Labels must be 1-15 characters without commas")
+            return
             
         # Start labeling process
         self.is_labeling = True
@@ -780,6 +858,7 @@ class AdvancedElephantGUI:
         # Update UI
         self.elephant_btn.config(state='disabled')
         self.not_elephant_btn.config(state='disabled')
+        self.custom_label_btn.config(state='disabled')
         self.progress_label.config(text=f"Recording {label}...", fg='#FF9800')
         
         self.log_message(f"🎬 Started recording {label} for 5 seconds...")
@@ -857,6 +936,7 @@ class AdvancedElephantGUI:
         # Update UI
         self.elephant_btn.config(state='normal')
         self.not_elephant_btn.config(state='normal')
+        self.custom_label_btn.config(state='normal')
         self.progress_label.config(text="Ready", fg='#4CAF50')
         self.progress_fill.config(width=0)  # Reset progress bar
     
@@ -931,9 +1011,17 @@ class AdvancedElephantGUI:
 • {'✅ Balanced dataset!' if abs(elephant_count - not_elephant_count) <= 2 else '⚠️ Try to balance elephant vs not-elephant samples'}
 • {'✅ Ready for training!' if total_samples >= 10 else '📝 Collect more labeled data for better training'}
 
-📋 RECENT LABELING SESSIONS:
 """
         
+        # Sessions per label, for classes beyond elephant / not elephant
+        label_counts = {}
+        for session in self.training_data:
+            label_counts[session['label']] = label_counts.get(session['label'], 0) + 1
+        stats_text += "🏷️ SESSIONS PER LABEL:\n"
+        for label, count in sorted(label_counts.items(), key=lambda item: -item[1]):
+            stats_text += f"• {label}: {count}\n"
+        stats_text += "\n📋 RECENT LABELING SESSIONS:\n"
+        
         # Add recent sessions
         for i, session in enumerate(self.training_data[-5:], 1):
             timestamp = time.strftime('%H:%M:%S', time.localtime(session['timestamp']))
@@ -14,6 +14,11 @@ from datetime import datetime
 import json
 import os
 
+# Labels counted as an elephant detection; the firmware accepts any label
+# of up to 15 characters without commas, MAX_LABELS (32) in total
+ELEPHANT_LABELS = ("elephant", "rumble", "trumpet")
+FIELD_LABELS = ["rumble", "trumpet", "vehicle", "wind", "rain", "human", "cattle"]
+
 class SimpleElephantGUI:
     def __init__(self, root):
         self.root = root
@@ -32,6 +37,11 @@ class SimpleElephantGUI:
         self.current_features = {}
         self.current_classification = "not_elephant"
         self.current_confidence = 0.0
+        self.runner_ups = []  # (label, score) after the winner
+        # Smoothed detection events (DETECTION: lines); the ESP32 sends them
+        # instead of every CLASSIFICATION unless SMOOTHING is off
+        self.event_mode = False
+        self.active_event = None  # Label of the event in progress
         self.feature_history = []
         
         # Statistics tracking
@@ -234,6 +244,17 @@ class SimpleElephantGUI:
                                          padx=15, pady=5, state='disabled')
         self.not_elephant_btn.pack(side='left', padx=5)
         
+        # Any other class, picked from the list or typed in
+        self.custom_label = ttk.Combobox(btn_frame, values=FIELD_LABELS, width=12)
+        self.custom_label.set(FIELD_LABELS[0])
+        self.custom_label.pack(side='left', padx=(5, 0))
+        
+        self.custom_label_btn = tk.Button(btn_frame, text="🏷️ Label", 
+                                         command=lambda: self.send_label(self.custom_label.get().strip()),
+                                         font=('Arial', 10, 'bold'), bg='#3F51B5', fg='white',
+                                         padx=15, pady=5, state='disabled')
+        self.custom_label_btn.pack(side='left', padx=5)
+        
         # Data buttons
         self.save_btn = tk.Button(btn_frame, text="💾 Save Data", 
                                  command=self.save_data,
@@ -335,6 +356,7 @@ class SimpleElephantGUI:
             self.disconnect_btn.config(state='normal')
             self.elephant_btn.config(state='normal')
             self.not_elephant_btn.config(state='normal')
+            self.custom_label_btn.config(state='normal')
             self.save_btn.config(state='normal')
             self.clear_btn.config(state='normal')
             
@@ -362,6 +384,7 @@ class SimpleElephantGUI:
             self.disconnect_btn.config(state='disabled')
             self.elephant_btn.config(state='disabled')
             self.not_elephant_btn.config(state='disabled')
+            self.custom_label_btn.config(state='disabled')
             self.save_btn.config(state='disabled')
             self.clear_btn.config(state='disabled')
             
@@ -412,6 +435,8 @@ class SimpleElephantGUI:
                 self.parse_features(line)
             elif line.startswith("CLASSIFICATION:"):
                 self.parse_classification(line)
+            elif line.startswith("DETECTION:"):
+                self.parse_detection(line)
             elif line.startswith("STATUS:"):
                 self.parse_status(line)
             elif line.startswith("ERROR:"):
@@ -453,9 +478,17 @@ class SimpleElephantGUI:
             if len(parts) >= 2:  # Changed from >= 3 to >= 2
                 self.current_classification = parts[0].strip()
                 self.current_confidence = float(parts[1].strip())
+                # With smoothing on, a CLASSIFICATION only follows a
+                # DETECTION:start for the same label; any other means it is off
+                if self.event_mode and self.current_classification != self.active_event:
+                    self.event_mode = False
+                    self.active_event = None
+                # Optional runner-up label,score pairs after the level
+                self.runner_ups = [(parts[i].strip(), float(parts[i + 1]))
+                                   for i in range(3, len(parts) - 1, 2)]
                 
                 # Increment live detections counter only for 100% confidence elephant classifications
-                if self.current_classification == "elephant" and self.current_confidence == 1.0:
+                if self.current_classification in ELEPHANT_LABELS and self.current_confidence == 1.0:
                     self.live_detections += 1
                     self.update_statistics_display()
                 
@@ -466,6 +499,30 @@ class SimpleElephantGUI:
         except Exception as e:
             self.log_message(f"❌ Classification parsing error: {str(e)} for line: {line}")
     
+    def parse_detection(self, line):
+        """Parse a smoothed detection event: start,label,start_ms,confidence
+        or end,label,start_ms,end_ms,peak_confidence"""
+        try:
+            parts = line[10:].split(",")  # Remove "DETECTION:" prefix
+            if parts[0] == "start" and len(parts) >= 4:
+                self.event_mode = True
+                self.active_event = parts[1].strip()
+                self.current_classification = self.active_event
+                self.current_confidence = float(parts[3])
+                self.runner_ups = []
+                self.log_message(f"🎯 Detection started: {self.active_event}, Confidence: {self.current_confidence}")
+            elif parts[0] == "end" and len(parts) >= 5:
+                self.event_mode = True
+                self.active_event = None
+                duration = (int(parts[3]) - int(parts[2])) / 1000.0
+                self.log_message(f"🎯 Detection ended: {parts[1].strip()} after {duration:.1f}s, peak confidence {float(parts[4])}")
+            else:
+                self.log_message(f"⚠️ Invalid detection format: {line}")
+                return
+            self.update_detection_display()
+        except Exception as e:
+            self.log_message(f"❌ Detection parsing error: {str(e)} for line: {line}")
+    
     def parse_status(self, line):
         """Parse status data"""
         try:
@@ -501,7 +558,19 @@ class SimpleElephantGUI:
         current_time = time.time()
         
         # Determine current detection state (only 100% confidence shows elephant detection)
-        if self.current_classification == "elephant" and self.current_confidence == 1.0:
+        if self.event_mode:
+            # The ESP32 has already debounced: an event lasts from its
+            # DETECTION:start to its DETECTION:end, with no timer
+            if self.active_event in ELEPHANT_LABELS:
+                new_detection_state = "elephant_high"
+            else:
+                new_detection_state = "no_elephant"
+            self.detection_locked = False
+            if new_detection_state == self.last_detection_state == "elephant_high":
+                # Same event, already shown and counted
+                self.detection_locked = True
+                self.detection_timer_start = current_time
+        elif self.current_classification in ELEPHANT_LABELS and self.current_confidence == 1.0:
             new_detection_state = "elephant_high"
         else:
             new_detection_state = "no_elephant"
@@ -542,11 +611,16 @@ class SimpleElephantGUI:
             self.last_detection_state = "no_elephant"
         
         # Update classification labels
-        self.classification_label.config(text=f"Classification: {self.current_classification}")
+        text = f"Classification: {self.current_classification}"
+        if self.runner_ups:
+            text += " (" + ", ".join(f"{label} {score:.2f}" for label, score in self.runner_ups) + ")"
+        self.classification_label.config(text=text)
         self.confidence_label.config(text=f"Confidence: {self.current_confidence*100:.1f}%")
         
-        # Update timer display
-        if self.detection_locked and self.last_detection_state != "no_elephant":
+        # Update timer display; an event has no timer, it lasts until its end
+        if self.event_mode and self.active_event is not None:
+            self.timer_label.config(text=f"Detection active: {self.active_event}")
+        elif self.detection_locked and self.last_detection_state != "no_elephant":
             remaining = max(0, self.detection_timer_duration - (current_time - self.detection_timer_start))
             self.timer_label.config(text=f"Detection active: {remaining:.1f}s remaining")
         else:
@@ -554,12 +628,15 @@ class SimpleElephantGUI:
     
     def send_label(self, label):
         """Send label to ESP32"""
+        if not label or len(label) > 15 or ',' in label:
+            self.log_message("❌ Labels must be 1-15 characters without commas")
+            return
         if self.connected:
             try:
                 self.serial_connection.write(f"LABEL:{label}\n".encode())
                 
                 # Update counters based on label
-                if label == "elephant":
+                if label in ELEPHANT_LABELS:
                     self.elephant_samples += 1
                 else:
                     self.other_samples += 1
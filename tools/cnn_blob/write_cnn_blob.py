@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Quantize a float 1D-CNN and write the firmware's weight blob.
+
+The input is a JSON description of a network trained elsewhere (float
+weights plus the activation scale and zero point of every layer output):
+
+    {
+      "labels": ["rumble", "vehicle", "background"],
+      "input": {"frames": 32, "scale": 0.1, "zero_point": 0},
+      "layers": [
+        {"type": "conv1d", "kernel": 5, "stride": 2, "relu": true,
+         "weights": [[[...in channels...] x kernel] x out], "bias": [...],
+         "output_scale": 0.05, "output_zero_point": -10},
+        {"type": "depthwise", "kernel": 3, "weights": [[...channels...] x kernel], ...},
+        {"type": "max_pool", "kernel": 2, "stride": 2},
+        {"type": "avg_pool", "kernel": 0},
+        {"type": "dense", "weights": [[...inputs...] x out], "bias": [...],
+         "output_scale": 0.1, "output_zero_point": 0}
+      ]
+    }
+
+Weights are quantized per output channel (symmetric int8), biases to int32
+at input * weight scale, and each channel's rescale to a Q31 multiplier and
+shift, as Int8Kernels expects. The input scale is that of the spectrogram
+codes the network was trained on (see SPECTROGRAM_CODE_OFFSET).
+
+Usage: write_cnn_blob.py model.json esp32_firmware/data/cnn_model.bin
+Upload the data directory with `pio run --target uploadfs`.
+"""
+
+import json
+import math
+import struct
+import sys
+
+MAGIC = 0x314E4345  # "ECN1"
+VERSION = 1
+LABEL_BYTES = 16
+LAYER_TYPES = {"conv1d": 1, "depthwise": 2, "max_pool": 3, "avg_pool": 4, "dense": 5}
+
+
+def pad4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def flatten(values):
+    if isinstance(values, list):
+        return [x for v in values for x in flatten(v)]
+    return [values]
+
+
+def quantize_multiplier(scale):
+    """scale = multiplier * 2^-(31 + shift), multiplier in [2^30, 2^31)"""
+    mantissa, exponent = math.frexp(scale)  # scale = mantissa * 2^exponent
+    multiplier = round(mantissa * (1 << 31))
+    if multiplier == 1 << 31:
+        multiplier //= 2
+        exponent += 1
+    shift = -exponent
+    if not -30 <= shift <= 31:
+        raise ValueError("rescale %g out of range" % scale)
+    return multiplier, shift
+
+
+def quantize_layer(layer, frames, channels, in_scale, in_zero_point):
+    kind = layer["type"]
+    kernel = layer.get("kernel", 1)
+    stride = layer.get("stride", 1)
+    if kind in ("max_pool", "avg_pool"):
+        if kernel == 0:
+            kernel, stride = frames, 1
+        header = struct.pack("<BBBBHHbbbB", LAYER_TYPES[kind], layer.get("kernel", 1), layer.get("stride", 1),
+                             0, 0, 0, in_zero_point, -128, 127, 0)
+        return header, (frames - kernel) // stride + 1, channels, in_scale, in_zero_point
+
+    weights = layer["weights"]
+    if kind == "conv1d":
+        rows = [flatten(w) for w in weights]                    # [out][kernel * in]
+        out_channels = len(rows)
+        out_frames = (frames - kernel) // stride + 1
+    elif kind == "depthwise":
+        # Stored [kernel][channel]; quantized per channel (column)
+        rows = [[weights[k][c] for k in range(kernel)] for c in range(channels)]
+        out_channels = channels
+        out_frames = (frames - kernel) // stride + 1
+    elif kind == "dense":
+        rows = [flatten(w) for w in weights]                    # [out][frames * channels]
+        out_channels = len(rows)
+        out_frames = 1
+        kernel, stride = frames, 1
+    else:
+        raise ValueError("unknown layer type " + kind)
+
+    out_scale = layer["output_scale"]
+    out_zero_point = layer["output_zero_point"]
+    quantized, biases, multipliers, shifts = [], [], [], []
+    for row, bias in zip(rows, layer["bias"]):
+        weight_scale = max(max(abs(w) for w in row), 1e-12) / 127.0
+        quantized.append([max(-127, min(127, round(w / weight_scale))) for w in row])
+        biases.append(round(bias / (in_scale * weight_scale)))
+        multiplier, shift = quantize_multiplier(in_scale * weight_scale / out_scale)
+        multipliers.append(multiplier)
+        shifts.append(shift)
+
+    if kind == "depthwise":
+        weight_bytes = [quantized[c][k] for k in range(kernel) for c in range(channels)]
+    else:
+        weight_bytes = [w for row in quantized for w in row]
+
+    act_min = out_zero_point if layer.get("relu") else -128
+    header = struct.pack("<BBBBHHbbbB", LAYER_TYPES[kind], layer.get("kernel", 0), layer.get("stride", 1),
+                         0, out_channels if kind in ("conv1d", "dense") else 0, 0, out_zero_point, act_min, 127, 0)
+    body = (pad4(struct.pack("<%db" % len(weight_bytes), *weight_bytes)) +
+            struct.pack("<%di" % len(biases), *biases) +
+            struct.pack("<%di" % len(multipliers), *multipliers) +
+            pad4(struct.pack("<%db" % len(shifts), *shifts)))
+    return header + body, out_frames, out_channels, out_scale, out_zero_point
+
+
+def write_blob(model, bins=64):
+    labels = model["labels"]
+    source = model["input"]
+    frames, channels = source["frames"], bins
+    scale, zero_point = source["scale"], source.get("zero_point", 0)
+
+    layers = b""
+    for layer in model["layers"]:
+        data, frames, channels, scale, zero_point = quantize_layer(layer, frames, channels, scale, zero_point)
+        layers += data
+    if frames * channels != len(labels):
+        raise ValueError("last layer has %d outputs for %d labels" % (frames * channels, len(labels)))
+
+    header = struct.pack("<IBBBBBbHf", MAGIC, VERSION, len(model["layers"]), len(labels),
+                         source["frames"], bins, source.get("zero_point", 0), 0, scale)
+    names = b"".join(name.encode()[:LABEL_BYTES - 1].ljust(LABEL_BYTES, b"\0") for name in labels)
+    return header + names + layers
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: write_cnn_blob.py model.json cnn_model.bin")
+    with open(sys.argv[1]) as f:
+        blob = write_blob(json.load(f))
+    with open(sys.argv[2], "wb") as f:
+        f.write(blob)
+    print("Wrote %d bytes to %s" % (len(blob), sys.argv[2]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+// Labelled AudioFeatures logs and command lines for the host tools
+// ================================================================
+//
+// Shared by tools/forest_trainer, tools/linear_trainer and
+// tools/knn_calibrator. Header-only, so each tool still builds with one
+// g++ command.
+//
+// Input lines are label,rms,infrasound,low_band,mid_band,centroid,dominant,flux,envelope,
+// optionally prefixed with SAMPLE: as in the EXPORT_DATA reply, so a
+// captured serial log can be used as is. Lines starting with # and lines
+// that are not samples (other serial messages, CSV headers, short records)
+// are skipped. Labels are numbered in order of first appearance.
+
+#ifndef TOOLS_SAMPLE_LOG_H
+#define TOOLS_SAMPLE_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "KNNClassifier.h"
+
+struct Sample {
+    float values[NUM_FEATURES];
+    uint8_t label;
+};
+
+static const char* const FEATURE_NAMES[NUM_FEATURES] = {
+    "rms", "infrasound_energy", "low_band_energy", "mid_band_energy",
+    "spectral_centroid", "dominant_frequency", "spectral_flux", "temporal_envelope"
+};
+
+static inline AudioFeatures to_features(const Sample& sample) {
+    const float* v = sample.values;
+    AudioFeatures features = {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]};
+    return features;
+}
+
+// False for a line that is not a sample. Exits if a new label would not
+// fit the firmware's label table.
+static inline bool parse_line(const char* line, std::vector<std::string>& labels, Sample& sample) {
+    if (strncmp(line, "SAMPLE:", 7) == 0) {
+        line += 7;
+    }
+    const char* comma = strchr(line, ',');
+    if (!comma || comma == line) {
+        return false;
+    }
+    std::string label(line, comma - line);
+    if (label.find(':') != std::string::npos) {
+        return false;   // Another serial message
+    }
+
+    const char* p = comma + 1;
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        char* end;
+        sample.values[f] = strtof(p, &end);
+        if (end == p || (f < NUM_FEATURES - 1 && *end != ',')) {
+            return false;   // Header line or short record
+        }
+        p = end + 1;
+    }
+
+    size_t id = std::find(labels.begin(), labels.end(), label) - labels.begin();
+    if (id == labels.size()) {
+        if (labels.size() >= MAX_LABELS || label.size() > KNN_LABEL_LENGTH) {
+            fprintf(stderr, "Label '%s' exceeds the firmware's %d labels of %d characters\n",
+                    label.c_str(), MAX_LABELS, KNN_LABEL_LENGTH);
+            exit(1);
+        }
+        labels.push_back(label);
+    }
+    sample.label = (uint8_t)id;
+    return true;
+}
+
+// Appends the file's samples; exits if it cannot be opened
+static inline void load_log(const char* path, std::vector<std::string>& labels, std::vector<Sample>& samples) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        exit(1);
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        Sample sample;
+        if (line[0] != '#' && parse_line(line, labels, sample)) {
+            samples.push_back(sample);
+        }
+    }
+    fclose(file);
+}
+
+// Every argument starting with '-' takes the next one as its value and is
+// passed to option(name, value), which returns false for a name it does
+// not know; the other arguments are input logs. An unknown option or one
+// without a value calls usage(), which must not return.
+template <typename OptionHandler>
+static void parse_arguments(int argc, char** argv, std::vector<const char*>& inputs, void (*usage)(),
+                            OptionHandler option) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-') {
+            inputs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc || !option(arg, argv[i + 1])) {
+            usage();
+        }
+        i++;
+    }
+}
+
+// --mask value: decimal or 0x hex, limited to the firmware's features
+static inline unsigned parse_feature_mask(const char* value) {
+    return (unsigned)strtoul(value, nullptr, 0) & FEATURE_MASK_ALL;
+}
+
+#endif
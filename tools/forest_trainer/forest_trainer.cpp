@@ -0,0 +1,395 @@
+// Forest Trainer for the Elephant Detection System
+// ================================================
+//
+// Trains a random forest on labelled AudioFeatures logs and writes it as a
+// header of constexpr flat arrays for the firmware's DecisionForest engine
+// (build the firmware with -DCLASSIFIER_FOREST=1, or switch at run time
+// with ENGINE:forest). The held-out split is classified by the firmware's
+// own DecisionForest and KNNClassifier code, so the confusion matrices and
+// latencies printed here compare the two engines on equal terms.
+//
+// Build, from the repository root (one command):
+//   g++ -O2 -std=gnu++17 -DMAX_TRAINING_SAMPLES=100000
+//       -Iesp32_firmware/lib/KNNClassifier -Iesp32_firmware/lib/AudioProcessor
+//       tools/forest_trainer/forest_trainer.cpp esp32_firmware/lib/KNNClassifier/*.cpp
+//       -o forest_trainer
+//
+// Usage:
+//   forest_trainer [options] log.txt [more logs ...]
+//
+// Input: labelled feature logs or EXPORT_DATA captures (tools/common/sample_log.h).
+//
+// Options:
+//   --trees N           Trees in the forest (default 16)
+//   --depth N           Maximum tree depth (default 8)
+//   --min-leaf N        Minimum training samples per leaf (default 2)
+//   --split-features N  Features tried at each split (default 3)
+//   --mask M            Features the trees may split on (default 0xFF)
+//   --test-fraction F   Share of samples held out for the reports (default 0.25)
+//   --seed N            Shuffle, bootstrap and feature sampling seed (default 1)
+//   --output PATH       Header to write (default esp32_firmware/lib/KNNClassifier/ForestModel.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "DecisionForest.h"
+#include "KNNClassifier.h"
+#include "../common/sample_log.h"
+
+struct Options {
+    int trees = 16;
+    int depth = 8;
+    int min_leaf = 2;
+    int split_features = 3;
+    unsigned mask = FEATURE_MASK_ALL;
+    double test_fraction = 0.25;
+    unsigned seed = 1;
+    std::string output = "esp32_firmware/lib/KNNClassifier/ForestModel.h";
+};
+
+// ---------------------------------------------------------------------------
+// Training: CART trees on Gini impurity, each grown on a bootstrap sample
+// with a random subset of features tried at every split
+
+class TreeBuilder {
+public:
+    TreeBuilder(const std::vector<Sample>& samples, size_t label_count, const Options& options,
+                std::mt19937& rng, std::vector<ForestNode>& nodes)
+        : samples(samples), label_count(label_count), options(options), rng(rng), nodes(nodes), used_mask(0) {}
+
+    void build(std::vector<uint32_t>& members, int depth) {
+        std::vector<uint32_t> counts(label_count);
+        for (uint32_t i : members) {
+            counts[samples[i].label]++;
+        }
+        size_t majority = std::max_element(counts.begin(), counts.end()) - counts.begin();
+
+        size_t self = nodes.size();
+        nodes.push_back(ForestNode{0.0f, -1, (uint8_t)majority, 0});
+        if (depth >= options.depth || counts[majority] == members.size() ||
+            members.size() < 2 * (size_t)options.min_leaf) {
+            return;
+        }
+
+        int feature;
+        float threshold;
+        if (!find_split(members, counts, feature, threshold)) {
+            return;
+        }
+        std::vector<uint32_t> left, right;
+        for (uint32_t i : members) {
+            (samples[i].values[feature] <= threshold ? left : right).push_back(i);
+        }
+
+        nodes[self].feature = (int8_t)feature;
+        nodes[self].threshold = threshold;
+        used_mask |= 1 << feature;
+        build(left, depth + 1);
+        size_t offset = nodes.size() - self;
+        if (offset > UINT16_MAX) {
+            fprintf(stderr, "Tree too large for 16-bit child offsets; lower --depth\n");
+            exit(1);
+        }
+        nodes[self].right = (uint16_t)offset;
+        build(right, depth + 1);
+    }
+
+    unsigned get_used_mask() const { return used_mask; }
+
+private:
+    const std::vector<Sample>& samples;
+    size_t label_count;
+    const Options& options;
+    std::mt19937& rng;
+    std::vector<ForestNode>& nodes;
+    unsigned used_mask;
+
+    static double gini(const std::vector<uint32_t>& counts, size_t total) {
+        double sum = 0.0;
+        for (uint32_t c : counts) {
+            double p = (double)c / total;
+            sum += p * p;
+        }
+        return 1.0 - sum;
+    }
+
+    bool find_split(std::vector<uint32_t>& members, const std::vector<uint32_t>& counts,
+                    int& best_feature, float& best_threshold) {
+        std::vector<int> candidates;
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            if (options.mask & (1 << f)) {
+                candidates.push_back(f);
+            }
+        }
+        std::shuffle(candidates.begin(), candidates.end(), rng);
+        if ((int)candidates.size() > options.split_features) {
+            candidates.resize(options.split_features);
+        }
+
+        size_t n = members.size();
+        double best = gini(counts, n) * n;
+        bool found = false;
+        for (int f : candidates) {
+            std::sort(members.begin(), members.end(), [&](uint32_t a, uint32_t b) {
+                return samples[a].values[f] < samples[b].values[f];
+            });
+            std::vector<uint32_t> left(label_count), right = counts;
+            for (size_t i = 0; i + 1 < n; i++) {
+                uint8_t label = samples[members[i]].label;
+                left[label]++;
+                right[label]--;
+                float a = samples[members[i]].values[f];
+                float b = samples[members[i + 1]].values[f];
+                size_t nl = i + 1, nr = n - nl;
+                if (a == b || nl < (size_t)options.min_leaf || nr < (size_t)options.min_leaf) {
+                    continue;
+                }
+                double impurity = gini(left, nl) * nl + gini(right, nr) * nr;
+                if (impurity < best) {
+                    best = impurity;
+                    best_feature = f;
+                    // Midpoint, kept inside [a, b) after float rounding
+                    float mid = a + (b - a) / 2;
+                    best_threshold = mid < b ? mid : a;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+};
+
+struct TrainedForest {
+    std::vector<ForestNode> nodes;
+    std::vector<uint32_t> tree_start;
+    std::vector<const char*> label_names;
+    unsigned used_mask = 0;
+    ForestModel model;
+};
+
+static void train_forest(const std::vector<Sample>& train, const std::vector<std::string>& labels,
+                         const Options& options, std::mt19937& rng, TrainedForest& forest) {
+    std::uniform_int_distribution<size_t> pick(0, train.size() - 1);
+    for (int t = 0; t < options.trees; t++) {
+        std::vector<uint32_t> bootstrap(train.size());
+        for (uint32_t& i : bootstrap) {
+            i = (uint32_t)pick(rng);
+        }
+        forest.tree_start.push_back((uint32_t)forest.nodes.size());
+        TreeBuilder builder(train, labels.size(), options, rng, forest.nodes);
+        builder.build(bootstrap, 0);
+        forest.used_mask |= builder.get_used_mask();
+    }
+    for (const std::string& label : labels) {
+        forest.label_names.push_back(label.c_str());
+    }
+    forest.model = ForestModel{forest.nodes.data(), forest.tree_start.data(), (uint16_t)options.trees,
+                               forest.label_names.data(), (uint8_t)labels.size(), (FeatureMask)forest.used_mask};
+}
+
+// ---------------------------------------------------------------------------
+// Reports
+
+struct EngineReport {
+    const char* name;
+    std::vector<uint32_t> confusion;    // [true * labels + predicted]
+    uint32_t correct = 0;
+    uint32_t unclassified = 0;          // KNN_REJECTED / KNN_INSUFFICIENT_DATA
+    double latency_us = 0.0;
+};
+
+// Classifies the held-out samples through the engine's classify() and
+// times a repeated pass
+static void evaluate(KNNClassifier& engine, const std::vector<Sample>& test,
+                     const std::vector<std::string>& labels, EngineReport& report) {
+    report.confusion.assign(labels.size() * labels.size(), 0);
+    KnnResult result;
+    for (const Sample& sample : test) {
+        int id = engine.classify(to_features(sample), result);
+        if (id < 0) {
+            report.unclassified++;
+            continue;
+        }
+        // The k-NN dictionary numbers labels in its own order
+        const char* name = engine.get_label_name(id);
+        size_t predicted = std::find(labels.begin(), labels.end(), name) - labels.begin();
+        report.confusion[sample.label * labels.size() + predicted]++;
+        report.correct += predicted == sample.label;
+    }
+
+    size_t queries = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < 0.05 || queries < test.size()) {
+        for (const Sample& sample : test) {
+            engine.classify(to_features(sample), result);
+        }
+        queries += test.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    report.latency_us = elapsed * 1e6 / queries;
+}
+
+static void print_confusion(const EngineReport& report, const std::vector<std::string>& labels) {
+    printf("\nConfusion matrix, %s (rows: true label, columns: predicted)\n", report.name);
+    printf("%-16s", "");
+    for (const std::string& label : labels) {
+        printf(" %15s", label.c_str());
+    }
+    printf("\n");
+    for (size_t t = 0; t < labels.size(); t++) {
+        printf("%-16s", labels[t].c_str());
+        for (size_t p = 0; p < labels.size(); p++) {
+            printf(" %15u", report.confusion[t * labels.size() + p]);
+        }
+        printf("\n");
+    }
+    if (report.unclassified) {
+        printf("(%u held-out samples rejected or unclassified)\n", report.unclassified);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Header output
+
+static void write_header(const Options& options, const TrainedForest& forest, const std::vector<std::string>& labels,
+                         size_t train_count, const EngineReport& report, size_t test_count) {
+    FILE* out = fopen(options.output.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", options.output.c_str());
+        exit(1);
+    }
+    fprintf(out, "// Generated by tools/forest_trainer; do not edit.\n");
+    fprintf(out, "// %d trees, %zu nodes, depth <= %d, trained on %zu samples", options.trees,
+            forest.nodes.size(), options.depth, train_count);
+    if (test_count) {
+        fprintf(out, "; held-out accuracy %.3f on %zu", (double)report.correct / test_count, test_count);
+    }
+    fprintf(out, "\n#ifndef FOREST_MODEL_H\n#define FOREST_MODEL_H\n\n#include \"DecisionForest.h\"\n\n");
+
+    fprintf(out, "// threshold, feature (-1 = leaf), label, right child offset\n");
+    fprintf(out, "static constexpr ForestNode FOREST_NODES[] = {\n");
+    for (const ForestNode& node : forest.nodes) {
+        fprintf(out, "    {%.9ef, %d, %u, %u},\n", node.threshold, node.feature, node.label, node.right);
+    }
+    fprintf(out, "};\n\nstatic constexpr uint32_t FOREST_TREE_START[] = {");
+    for (size_t t = 0; t < forest.tree_start.size(); t++) {
+        fprintf(out, "%s%u", t ? ", " : "", forest.tree_start[t]);
+    }
+    fprintf(out, "};\n\nstatic constexpr const char* FOREST_LABELS[] = {");
+    for (size_t l = 0; l < labels.size(); l++) {
+        fprintf(out, "%s\"%s\"", l ? ", " : "", labels[l].c_str());
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "static constexpr ForestModel FOREST_MODEL = {\n");
+    fprintf(out, "    FOREST_NODES, FOREST_TREE_START, %d, FOREST_LABELS, %zu, 0x%02X\n", options.trees,
+            labels.size(), forest.used_mask);
+    fprintf(out, "};\n\n#endif\n");
+    fclose(out);
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage() {
+    fprintf(stderr,
+            "usage: forest_trainer [--trees N] [--depth N] [--min-leaf N] [--split-features N]\n"
+            "                      [--mask M] [--test-fraction F] [--seed N] [--output PATH] log ...\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<const char*> inputs;
+    parse_arguments(argc, argv, inputs, usage, [&](const char* name, const char* value) {
+        if (strcmp(name, "--trees") == 0) {
+            options.trees = atoi(value);
+        } else if (strcmp(name, "--depth") == 0) {
+            options.depth = atoi(value);
+        } else if (strcmp(name, "--min-leaf") == 0) {
+            options.min_leaf = atoi(value);
+        } else if (strcmp(name, "--split-features") == 0) {
+            options.split_features = atoi(value);
+        } else if (strcmp(name, "--mask") == 0) {
+            options.mask = parse_feature_mask(value);
+        } else if (strcmp(name, "--test-fraction") == 0) {
+            options.test_fraction = atof(value);
+        } else if (strcmp(name, "--seed") == 0) {
+            options.seed = (unsigned)strtoul(value, nullptr, 0);
+        } else if (strcmp(name, "--output") == 0) {
+            options.output = value;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (inputs.empty() || options.trees < 1 || options.trees > UINT16_MAX || options.depth < 1 ||
+        options.min_leaf < 1 || options.split_features < 1 || options.mask == 0 ||
+        options.test_fraction < 0.0 || options.test_fraction >= 1.0) {
+        usage();
+    }
+
+    std::vector<std::string> labels;
+    std::vector<Sample> samples;
+    for (const char* path : inputs) {
+        load_log(path, labels, samples);
+    }
+    if (samples.size() < MIN_TRAINING_SAMPLES || labels.size() < 2) {
+        fprintf(stderr, "Need at least %d samples of 2 labels, got %zu of %zu\n", MIN_TRAINING_SAMPLES,
+                samples.size(), labels.size());
+        return 1;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::shuffle(samples.begin(), samples.end(), rng);
+    size_t test_count = (size_t)(samples.size() * options.test_fraction);
+    std::vector<Sample> test(samples.begin(), samples.begin() + test_count);
+    std::vector<Sample> train(samples.begin() + test_count, samples.end());
+    printf("Loaded %zu samples, %zu labels from %zu file(s); %zu train, %zu held out\n", samples.size(),
+           labels.size(), inputs.size(), train.size(), test.size());
+
+    TrainedForest forest;
+    train_forest(train, labels, options, rng, forest);
+    printf("Forest: %d trees, %zu nodes (%zu bytes of flash), splits on features 0x%02X\n", options.trees,
+           forest.nodes.size(), forest.nodes.size() * sizeof(ForestNode), forest.used_mask);
+
+    EngineReport reports[2];
+    reports[0].name = "forest";
+    reports[1].name = "knn";
+    if (!test.empty()) {
+        KNNClassifier engine;
+        engine.initialize();
+        engine.set_feature_mask((FeatureMask)options.mask);
+        for (const Sample& sample : train) {
+            engine.add_sample(to_features(sample), labels[sample.label].c_str());
+        }
+        engine.load_forest(&forest.model);
+
+        engine.set_engine(ENGINE_FOREST);
+        evaluate(engine, test, labels, reports[0]);
+        engine.set_engine(ENGINE_KNN);
+        evaluate(engine, test, labels, reports[1]);
+
+        printf("\n%-8s %10s %12s\n", "engine", "accuracy", "latency_us");
+        for (const EngineReport& report : reports) {
+            printf("%-8s %10.4f %12.2f\n", report.name, (double)report.correct / test.size(), report.latency_us);
+        }
+        for (const EngineReport& report : reports) {
+            print_confusion(report, labels);
+        }
+    }
+
+    write_header(options, forest, labels, train.size(), reports[0], test.size());
+    printf("\nWrote %s (features used:", options.output.c_str());
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        if (forest.used_mask & (1 << f)) {
+            printf(" %s", FEATURE_NAMES[f]);
+        }
+    }
+    printf(")\n");
+    return 0;
+}
@@ -0,0 +1,268 @@
+// k-NN Confidence Calibrator for the Elephant Detection System
+// ============================================================
+//
+// Fits the firmware's k-NN calibration table (KnnCalibration) on labelled
+// AudioFeatures logs. Every sample is classified by a KNNClassifier trained
+// on the other folds, which gives the winner's distance-weighted vote share
+// and whether the winner was right. Isotonic regression (pool adjacent
+// violators) turns share into probability of being right; the blocks are
+// merged down to KNN_CALIBRATION_POINTS knots and printed as the
+// CALIBRATION command to send to the device, which saves it with the
+// training data.
+//
+// Fit on an export of the device's own training set (EXPORT_DATA): the
+// table describes that model's vote shares, and CLEAR_DATA or REDUCE drop
+// it on the device.
+//
+// Build, from the repository root (one command):
+//   g++ -O2 -std=gnu++17 -DMAX_TRAINING_SAMPLES=100000
+//       -Iesp32_firmware/lib/KNNClassifier -Iesp32_firmware/lib/AudioProcessor
+//       tools/knn_calibrator/knn_calibrator.cpp esp32_firmware/lib/KNNClassifier/*.cpp
+//       -o knn_calibrator
+//
+// Usage:
+//   knn_calibrator [options] log.txt [more logs ...]
+//
+// Input: labelled feature logs or EXPORT_DATA captures (tools/common/sample_log.h).
+//
+// Options:
+//   --folds N           Cross-validation folds (default 5)
+//   --points N          Knots in the table, at most KNN_CALIBRATION_POINTS (default 8)
+//   --mask M            Feature mask the device uses (default 0xFF)
+//   --seed N            Fold assignment seed (default 1)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "KNNClassifier.h"
+#include "../common/sample_log.h"
+
+struct Options {
+    int folds = 5;
+    int points = KNN_CALIBRATION_POINTS;
+    unsigned mask = FEATURE_MASK_ALL;
+    unsigned seed = 1;
+};
+
+// ---------------------------------------------------------------------------
+// Cross-validated predictions
+
+struct Prediction {
+    float share;        // Winner's weighted vote share, uncalibrated
+    bool correct;
+};
+
+// Classifies every sample with a model built from the other folds. Rejected
+// samples get no prediction: the device sends no confidence for them.
+static void cross_validate(const std::vector<Sample>& samples, const std::vector<std::string>& labels,
+                           const Options& options, std::vector<Prediction>& predictions) {
+    KNNClassifier engine;
+    for (int fold = 0; fold < options.folds; fold++) {
+        engine.initialize();
+        engine.set_feature_mask((FeatureMask)options.mask);
+        for (size_t i = 0; i < samples.size(); i++) {
+            if ((int)(i % options.folds) != fold) {
+                engine.add_sample(to_features(samples[i]), labels[samples[i].label].c_str());
+            }
+        }
+        KnnResult result;
+        for (size_t i = fold; i < samples.size(); i += options.folds) {
+            int id = engine.classify(to_features(samples[i]), result);
+            if (id < 0) {
+                continue;
+            }
+            // The k-NN dictionary numbers labels in its own order
+            bool correct = labels[samples[i].label] == engine.get_label_name(id);
+            predictions.push_back(Prediction{result.confidence, correct});
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Isotonic fit
+
+struct Block {
+    double share_sum;
+    double correct;
+    double count;
+    float last_share;       // Highest share in the block
+
+    double share() const { return share_sum / count; }
+    double accuracy() const { return correct / count; }
+    void merge(const Block& other) {
+        share_sum += other.share_sum;
+        correct += other.correct;
+        count += other.count;
+        last_share = other.last_share;
+    }
+};
+
+// Pool adjacent violators over the predictions sorted by share, then merge
+// neighbouring blocks into at most options.points of about equal count.
+// Merging adjacent blocks of a non-decreasing sequence keeps it so.
+static KnnCalibration fit(std::vector<Prediction> predictions, const Options& options) {
+    std::sort(predictions.begin(), predictions.end(),
+              [](const Prediction& a, const Prediction& b) { return a.share < b.share; });
+    std::vector<Block> blocks;
+    for (const Prediction& p : predictions) {
+        Block block{p.share, p.correct ? 1.0 : 0.0, 1.0, p.share};
+        if (!blocks.empty() && blocks.back().last_share == p.share) {
+            blocks.back().merge(block);     // Equal shares must map to one value
+        } else {
+            blocks.push_back(block);
+        }
+        while (blocks.size() > 1 && blocks[blocks.size() - 2].accuracy() >= blocks.back().accuracy()) {
+            blocks[blocks.size() - 2].merge(blocks.back());
+            blocks.pop_back();
+        }
+    }
+
+    // A block goes to the knot its middle prediction falls in, so a large
+    // block (all neighbours agree) does not swallow its neighbours
+    std::vector<Block> knots;
+    double per_knot = (double)predictions.size() / options.points;
+    double before = 0.0;
+    int previous = -1;
+    for (const Block& block : blocks) {
+        int knot = (int)((before + block.count / 2) / per_knot);
+        if (knot != previous) {
+            knots.push_back(block);
+        } else {
+            knots.back().merge(block);
+        }
+        previous = knot;
+        before += block.count;
+    }
+
+    // Knots go over the serial line with three decimals; knots that round
+    // to the same share are merged so the device accepts the table
+    KnnCalibration table;
+    table.clear();
+    for (const Block& knot : knots) {
+        float share = roundf((float)knot.share() * 1000.0f) / 1000.0f;
+        float probability = roundf((float)knot.accuracy() * 1000.0f) / 1000.0f;
+        if (table.count > 0 && share <= table.share[table.count - 1]) {
+            continue;
+        }
+        if (table.count > 0 && probability < table.probability[table.count - 1]) {
+            probability = table.probability[table.count - 1];
+        }
+        table.share[table.count] = share;
+        table.probability[table.count] = probability;
+        table.count++;
+    }
+    return table;
+}
+
+// ---------------------------------------------------------------------------
+// Reports
+
+// Expected calibration error over ten equal-width confidence bins, with an
+// optional reliability table
+static double calibration_error(const std::vector<Prediction>& predictions, const KnnCalibration& table,
+                                bool print) {
+    const int BINS = 10;
+    double confidence[BINS] = {0};
+    double correct[BINS] = {0};
+    double count[BINS] = {0};
+    for (const Prediction& p : predictions) {
+        float c = table.apply(p.share);
+        int bin = std::min((int)(c * BINS), BINS - 1);
+        confidence[bin] += c;
+        correct[bin] += p.correct;
+        count[bin]++;
+    }
+    double error = 0.0;
+    for (int b = 0; b < BINS; b++) {
+        if (count[b] == 0) {
+            continue;
+        }
+        error += fabs(correct[b] - confidence[b]) / predictions.size();
+        if (print) {
+            printf("  %.1f-%.1f %8.0f %12.3f %10.3f\n", (double)b / BINS, (double)(b + 1) / BINS, count[b],
+                   confidence[b] / count[b], correct[b] / count[b]);
+        }
+    }
+    return error;
+}
+
+static void print_reliability(const char* name, const std::vector<Prediction>& predictions,
+                              const KnnCalibration& table) {
+    printf("\nReliability, %s\n  %-7s %8s %12s %10s\n", name, "bin", "count", "confidence", "accuracy");
+    double error = calibration_error(predictions, table, true);
+    printf("  expected calibration error %.4f\n", error);
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage() {
+    fprintf(stderr, "usage: knn_calibrator [--folds N] [--points N] [--mask M] [--seed N] log ...\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<const char*> inputs;
+    parse_arguments(argc, argv, inputs, usage, [&](const char* name, const char* value) {
+        if (strcmp(name, "--folds") == 0) {
+            options.folds = atoi(value);
+        } else if (strcmp(name, "--points") == 0) {
+            options.points = atoi(value);
+        } else if (strcmp(name, "--mask") == 0) {
+            options.mask = parse_feature_mask(value);
+        } else if (strcmp(name, "--seed") == 0) {
+            options.seed = (unsigned)strtoul(value, nullptr, 0);
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (inputs.empty() || options.folds < 2 || options.points < 2 || options.points > KNN_CALIBRATION_POINTS ||
+        options.mask == 0) {
+        usage();
+    }
+
+    std::vector<std::string> labels;
+    std::vector<Sample> samples;
+    for (const char* path : inputs) {
+        load_log(path, labels, samples);
+    }
+    if (samples.size() < (size_t)MIN_TRAINING_SAMPLES * options.folds || labels.size() < 2) {
+        fprintf(stderr, "Need at least %d samples of 2 labels for %d folds, got %zu of %zu\n",
+                MIN_TRAINING_SAMPLES * options.folds, options.folds, samples.size(), labels.size());
+        return 1;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::shuffle(samples.begin(), samples.end(), rng);
+    std::vector<Prediction> predictions;
+    cross_validate(samples, labels, options, predictions);
+    size_t correct = 0;
+    for (const Prediction& p : predictions) {
+        correct += p.correct;
+    }
+    printf("Loaded %zu samples, %zu labels from %zu file(s); %d-fold accuracy %.4f (%zu rejected)\n",
+           samples.size(), labels.size(), inputs.size(), options.folds,
+           predictions.empty() ? 0.0 : (double)correct / predictions.size(), samples.size() - predictions.size());
+    if (predictions.empty()) {
+        return 1;
+    }
+
+    KnnCalibration identity;
+    identity.clear();
+    KnnCalibration table = fit(predictions, options);
+    print_reliability("raw vote share", predictions, identity);
+    print_reliability("calibrated (in-sample)", predictions, table);
+
+    printf("\nSend to the device:\nCALIBRATION:");
+    for (uint8_t i = 0; i < table.count; i++) {
+        printf("%s%.3f:%.3f", i ? "," : "", table.share[i], table.probability[i]);
+    }
+    printf("\n");
+    return table.valid() ? 0 : 1;
+}
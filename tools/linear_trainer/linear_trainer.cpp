@@ -0,0 +1,305 @@
+// Linear Trainer for the Elephant Detection System
+// ================================================
+//
+// Trains the firmware's linear (multinomial logistic) engine on labelled
+// AudioFeatures logs and writes the weights, in raw feature units, as a
+// header for LinearClassifier (build the firmware with
+// -DCLASSIFIER_LINEAR=1). Training runs several shuffled SGD epochs of the
+// firmware's own LinearClassifier::train() instead of the single pass a
+// device makes, one step per LABEL. The held-out split is classified
+// through KNNClassifier, so the report compares the offline model, the
+// single online pass and k-NN on equal terms.
+//
+// Build, from the repository root (one command):
+//   g++ -O2 -std=gnu++17 -DMAX_TRAINING_SAMPLES=100000
+//       -Iesp32_firmware/lib/KNNClassifier -Iesp32_firmware/lib/AudioProcessor
+//       tools/linear_trainer/linear_trainer.cpp esp32_firmware/lib/KNNClassifier/*.cpp
+//       -o linear_trainer
+//
+// Usage:
+//   linear_trainer [options] log.txt [more logs ...]
+//
+// Input: labelled feature logs or EXPORT_DATA captures (tools/common/sample_log.h).
+//
+// Options:
+//   --epochs N          Passes over the training split (default 20)
+//   --rate F            Initial SGD step, decayed linearly to a tenth (default 0.05)
+//   --mask M            Features the model may use (default 0xFF)
+//   --test-fraction F   Share of samples held out for the reports (default 0.25)
+//   --seed N            Shuffle seed (default 1)
+//   --output PATH       Header to write (default esp32_firmware/lib/KNNClassifier/LinearWeights.h)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "KNNClassifier.h"
+#include "LinearClassifier.h"
+#include "../common/sample_log.h"
+
+struct Options {
+    int epochs = 20;
+    double rate = 0.05;
+    unsigned mask = FEATURE_MASK_ALL;
+    double test_fraction = 0.25;
+    unsigned seed = 1;
+    std::string output = "esp32_firmware/lib/KNNClassifier/LinearWeights.h";
+};
+
+// ---------------------------------------------------------------------------
+// Training: SGD epochs over the standardized training split, then the
+// weights are converted back to raw feature units
+
+struct TrainedLinear {
+    std::vector<float> weights;         // [label][feature], raw units
+    std::vector<float> bias;
+    std::vector<const char*> label_names;
+    LinearModel model;
+};
+
+static void train_linear(std::vector<Sample> train, const std::vector<std::string>& labels, const Options& options,
+                         std::mt19937& rng, TrainedLinear& trained) {
+    float mean[NUM_FEATURES];
+    float inv_std[NUM_FEATURES];
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        double sum = 0.0, squares = 0.0;
+        for (const Sample& sample : train) {
+            sum += sample.values[f];
+            squares += (double)sample.values[f] * sample.values[f];
+        }
+        double m = sum / train.size();
+        double variance = squares / train.size() - m * m;
+        mean[f] = (float)m;
+        inv_std[f] = variance > 1e-20 ? (float)(1.0 / sqrt(variance)) : 1.0f;
+    }
+
+    LinearClassifier linear;
+    for (int epoch = 0; epoch < options.epochs; epoch++) {
+        std::shuffle(train.begin(), train.end(), rng);
+        float rate = (float)(options.rate * (1.0 - 0.9 * epoch / std::max(options.epochs - 1, 1)));
+        for (const Sample& sample : train) {
+            float z[NUM_FEATURES];
+            for (int f = 0; f < NUM_FEATURES; f++) {
+                z[f] = (options.mask & (1 << f)) ? (sample.values[f] - mean[f]) * inv_std[f] : 0.0f;
+            }
+            linear.train(z, sample.label, labels.size(), rate);
+        }
+    }
+
+    trained.weights.resize(labels.size() * NUM_FEATURES);
+    trained.bias.resize(labels.size());
+    for (size_t l = 0; l < labels.size(); l++) {
+        linear.get_raw((uint8_t)l, mean, inv_std, &trained.weights[l * NUM_FEATURES], trained.bias[l]);
+        trained.label_names.push_back(labels[l].c_str());
+    }
+    trained.model = LinearModel{trained.weights.data(), trained.bias.data(), trained.label_names.data(),
+                                (uint8_t)labels.size(), (FeatureMask)options.mask, (uint32_t)train.size()};
+}
+
+// ---------------------------------------------------------------------------
+// Reports
+
+struct EngineReport {
+    const char* name;
+    std::vector<uint32_t> confusion;    // [true * labels + predicted]
+    uint32_t correct = 0;
+    uint32_t unclassified = 0;          // KNN_REJECTED / KNN_INSUFFICIENT_DATA
+    double latency_us = 0.0;
+};
+
+// Classifies the held-out samples through the engine's classify() and
+// times a repeated pass
+static void evaluate(KNNClassifier& engine, const std::vector<Sample>& test,
+                     const std::vector<std::string>& labels, EngineReport& report) {
+    report.confusion.assign(labels.size() * labels.size(), 0);
+    KnnResult result;
+    for (const Sample& sample : test) {
+        int id = engine.classify(to_features(sample), result);
+        if (id < 0) {
+            report.unclassified++;
+            continue;
+        }
+        // The k-NN dictionary numbers labels in its own order
+        const char* name = engine.get_label_name(id);
+        size_t predicted = std::find(labels.begin(), labels.end(), name) - labels.begin();
+        report.confusion[sample.label * labels.size() + predicted]++;
+        report.correct += predicted == sample.label;
+    }
+
+    size_t queries = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < 0.05 || queries < test.size()) {
+        for (const Sample& sample : test) {
+            engine.classify(to_features(sample), result);
+        }
+        queries += test.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    report.latency_us = elapsed * 1e6 / queries;
+}
+
+static void print_confusion(const EngineReport& report, const std::vector<std::string>& labels) {
+    printf("\nConfusion matrix, %s (rows: true label, columns: predicted)\n", report.name);
+    printf("%-16s", "");
+    for (const std::string& label : labels) {
+        printf(" %15s", label.c_str());
+    }
+    printf("\n");
+    for (size_t t = 0; t < labels.size(); t++) {
+        printf("%-16s", labels[t].c_str());
+        for (size_t p = 0; p < labels.size(); p++) {
+            printf(" %15u", report.confusion[t * labels.size() + p]);
+        }
+        printf("\n");
+    }
+    if (report.unclassified) {
+        printf("(%u held-out samples rejected or unclassified)\n", report.unclassified);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Header output
+
+static void write_header(const Options& options, const TrainedLinear& trained, const std::vector<std::string>& labels,
+                         size_t train_count, const EngineReport& report, size_t test_count) {
+    FILE* out = fopen(options.output.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", options.output.c_str());
+        exit(1);
+    }
+    fprintf(out, "// Generated by tools/linear_trainer; do not edit.\n");
+    fprintf(out, "// %zu labels, %d epochs on %zu samples", labels.size(), options.epochs, train_count);
+    if (test_count) {
+        fprintf(out, "; held-out accuracy %.3f on %zu", (double)report.correct / test_count, test_count);
+    }
+    fprintf(out, "\n#ifndef LINEAR_WEIGHTS_H\n#define LINEAR_WEIGHTS_H\n\n#include \"LinearClassifier.h\"\n\n");
+
+    fprintf(out, "// [label][feature] in raw feature units\n");
+    fprintf(out, "static constexpr float LINEAR_WEIGHTS[] = {\n");
+    for (size_t l = 0; l < labels.size(); l++) {
+        fprintf(out, "   ");
+        for (int f = 0; f < NUM_FEATURES; f++) {
+            fprintf(out, " %.9ef,", trained.weights[l * NUM_FEATURES + f]);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "};\n\nstatic constexpr float LINEAR_BIAS[] = {");
+    for (size_t l = 0; l < labels.size(); l++) {
+        fprintf(out, "%s%.9ef", l ? ", " : "", trained.bias[l]);
+    }
+    fprintf(out, "};\n\nstatic constexpr const char* LINEAR_LABELS[] = {");
+    for (size_t l = 0; l < labels.size(); l++) {
+        fprintf(out, "%s\"%s\"", l ? ", " : "", labels[l].c_str());
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "static constexpr LinearModel LINEAR_MODEL = {\n");
+    fprintf(out, "    LINEAR_WEIGHTS, LINEAR_BIAS, LINEAR_LABELS, %zu, 0x%02X, %zu\n", labels.size(), options.mask,
+            train_count);
+    fprintf(out, "};\n\n#endif\n");
+    fclose(out);
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage() {
+    fprintf(stderr,
+            "usage: linear_trainer [--epochs N] [--rate F] [--mask M] [--test-fraction F] [--seed N]\n"
+            "                      [--output PATH] log ...\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<const char*> inputs;
+    parse_arguments(argc, argv, inputs, usage, [&](const char* name, const char* value) {
+        if (strcmp(name, "--epochs") == 0) {
+            options.epochs = atoi(value);
+        } else if (strcmp(name, "--rate") == 0) {
+            options.rate = atof(value);
+        } else if (strcmp(name, "--mask") == 0) {
+            options.mask = parse_feature_mask(value);
+        } else if (strcmp(name, "--test-fraction") == 0) {
+            options.test_fraction = atof(value);
+        } else if (strcmp(name, "--seed") == 0) {
+            options.seed = (unsigned)strtoul(value, nullptr, 0);
+        } else if (strcmp(name, "--output") == 0) {
+            options.output = value;
+        } else {
+            return false;
+        }
+        return true;
+    });
+    if (inputs.empty() || options.epochs < 1 || options.rate <= 0.0 || options.mask == 0 ||
+        options.test_fraction < 0.0 || options.test_fraction >= 1.0) {
+        usage();
+    }
+
+    std::vector<std::string> labels;
+    std::vector<Sample> samples;
+    for (const char* path : inputs) {
+        load_log(path, labels, samples);
+    }
+    if (samples.size() < MIN_TRAINING_SAMPLES || labels.size() < 2) {
+        fprintf(stderr, "Need at least %d samples of 2 labels, got %zu of %zu\n", MIN_TRAINING_SAMPLES,
+                samples.size(), labels.size());
+        return 1;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::shuffle(samples.begin(), samples.end(), rng);
+    size_t test_count = (size_t)(samples.size() * options.test_fraction);
+    std::vector<Sample> test(samples.begin(), samples.begin() + test_count);
+    std::vector<Sample> train(samples.begin() + test_count, samples.end());
+    printf("Loaded %zu samples, %zu labels from %zu file(s); %zu train, %zu held out\n", samples.size(),
+           labels.size(), inputs.size(), train.size(), test.size());
+
+    TrainedLinear trained;
+    train_linear(train, labels, options, rng, trained);
+    printf("Linear: %zu labels x %d features (%zu bytes of flash), %d epochs\n", labels.size(), NUM_FEATURES,
+           (trained.weights.size() + trained.bias.size()) * sizeof(float), options.epochs);
+
+    EngineReport reports[3];
+    reports[0].name = "linear";
+    reports[1].name = "linear-sgd";    // One pass, as the device trains
+    reports[2].name = "knn";
+    if (!test.empty()) {
+        KNNClassifier engine;
+        engine.initialize();
+        engine.set_feature_mask((FeatureMask)options.mask);
+        for (const Sample& sample : train) {
+            engine.add_sample(to_features(sample), labels[sample.label].c_str());
+        }
+
+        engine.set_engine(ENGINE_LINEAR);
+        evaluate(engine, test, labels, reports[1]);
+        engine.set_engine(ENGINE_KNN);
+        evaluate(engine, test, labels, reports[2]);
+        engine.load_linear(&trained.model);
+        engine.set_engine(ENGINE_LINEAR);
+        evaluate(engine, test, labels, reports[0]);
+
+        printf("\n%-10s %10s %12s\n", "engine", "accuracy", "latency_us");
+        for (const EngineReport& report : reports) {
+            printf("%-10s %10.4f %12.2f\n", report.name, (double)report.correct / test.size(), report.latency_us);
+        }
+        for (const EngineReport& report : reports) {
+            print_confusion(report, labels);
+        }
+    }
+
+    write_header(options, trained, labels, train.size(), reports[0], test.size());
+    printf("\nWrote %s (features used:", options.output.c_str());
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        if (options.mask & (1 << f)) {
+            printf(" %s", FEATURE_NAMES[f]);
+        }
+    }
+    printf(")\n");
+    return 0;
+}